@@ -61,6 +61,14 @@ const heightIsValid = (position) => {
   return position >= 500 && position <= 6000;
 };
 
+const I2C_CMD_MOVE_STOP = 1;
+const I2C_CMD_MOVE_UP = 2;
+const I2C_CMD_MOVE_DOWN = 3;
+const I2C_CMD_MOVE_HEIGHT = 4;
+const I2C_CMD_MOVE_POSITION = 5;
+
+let commandSequence = Math.floor(Math.random() * 256);
+
 const iotData = new AWS.IotData({
   endpoint: config.iotEndpoint,
   region: config.iotRegion,
@@ -81,26 +89,58 @@ const updateSmarkantShadow = (state, callback) => {
   });
 };
 
+const commandFromState = (state) => {
+  switch (state.move) {
+    case 'stop': return [I2C_CMD_MOVE_STOP, 0];
+    case 'up': return [I2C_CMD_MOVE_UP, 0];
+    case 'down': return [I2C_CMD_MOVE_DOWN, 0];
+    case 'height': return [I2C_CMD_MOVE_HEIGHT, state.height];
+    case 'position': return [I2C_CMD_MOVE_POSITION, state.position];
+  }
+};
+
+// Sends the state as a binary command (opcode, argument, sequence) directly to the
+// command topic of the device, which reports it to the shadow itself
+const sendSmarkantCommand = (state, callback) => {
+  const [opcode, argument] = commandFromState(state);
+  commandSequence = (commandSequence + 1) & 0xff;
+  iotData.publish({
+    topic: config.iotCommandTopic,
+    payload: Buffer.from([opcode, argument & 0xff, argument >> 8, commandSequence]),
+    qos: 0
+  }, (_err, _data) => {
+    callback();
+  });
+};
+
+const moveSmarkant = (state, callback) => {
+  if (config.iotCommandTopic) {
+    sendSmarkantCommand(state, callback);
+  } else {
+    updateSmarkantShadow(state, callback);
+  }
+};
+
 const handlers = {
   'StopIntent': function() {
-    updateSmarkantShadow({move: 'stop'}, () => {
+    moveSmarkant({move: 'stop'}, () => {
       this.emit(':tell', i18n(this, 'smarkant_stops'));
     });
   },
   'MoveUpIntent': function() {
-    updateSmarkantShadow({move: 'position', position: 2}, () => {
+    moveSmarkant({move: 'position', position: 2}, () => {
       this.emit(':tell', i18n(this, 'smarkant_moves_up'));
     });
   },
   'MoveDownIntent': function() {
-    updateSmarkantShadow({move: 'position', position: 1}, () => {
+    moveSmarkant({move: 'position', position: 1}, () => {
       this.emit(':tell', i18n(this, 'smarkant_moves_down'));
     });
   },
   'MoveToPositionIntent': function() {
     const position = positionFromIntent(this);
     if (positionIsValid(position)) {
-      updateSmarkantShadow({move: 'position', position: position}, () => {
+      moveSmarkant({move: 'position', position: position}, () => {
         this.emit(':tell', i18n(this, 'smarkant_moves_to_position', {position: position}));
       });
     } else {
@@ -110,7 +150,7 @@ const handlers = {
   'MoveToHeightIntent': function() {
     const height = heightFromIntent(this);
     if (heightIsValid(height)) {
-      updateSmarkantShadow({move: 'height', height: height}, () => {
+      moveSmarkant({move: 'height', height: height}, () => {
         this.emit(':tell', i18n(this, 'smarkant_moves_to_height', {height: height}));
       });
     } else {
@@ -0,0 +1,411 @@
+/*
+ * This file is part of Smarkant project
+ *
+ * (C) 2017 Dirk Grappendorf, www.grappendorf.net
+ */
+
+#include "LoopbackBroker.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+extern "C" {
+#include <libb64/cencode_inc.h>
+#include <libsha1/libsha1.h>
+#include "MQTTPacket.h"
+}
+
+static const int POLL_INTERVAL_MS = 20;
+static const int MAX_FILTERS = 8;
+static const unsigned char MQTT_PINGRESP[] = {0xd0, 0x00};
+
+LoopbackBroker::LoopbackBroker()
+  : listenFd(-1), listenPort(0), running(false), connectionCount(0), publishCount(0),
+    duplicateCount(0), connectionPublishes(0) {
+}
+
+LoopbackBroker::~LoopbackBroker() {
+  stop();
+}
+
+bool LoopbackBroker::start() {
+  listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenFd < 0) {
+    return false;
+  }
+  struct sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+  socklen_t addressLength = sizeof(address);
+  if (bind(listenFd, (struct sockaddr *) &address, sizeof(address)) != 0 ||
+      listen(listenFd, 1) != 0 ||
+      getsockname(listenFd, (struct sockaddr *) &address, &addressLength) != 0) {
+    close(listenFd);
+    listenFd = -1;
+    return false;
+  }
+  listenPort = ntohs(address.sin_port);
+  running = true;
+  thread = std::thread(&LoopbackBroker::run, this);
+  return true;
+}
+
+void LoopbackBroker::stop() {
+  running = false;
+  if (thread.joinable()) {
+    thread.join();
+  }
+  if (listenFd >= 0) {
+    close(listenFd);
+    listenFd = -1;
+  }
+}
+
+void LoopbackBroker::setOptions(const LoopbackBrokerOptions &options) {
+  std::lock_guard<std::mutex> lock(mutex);
+  nextOptions = options;
+}
+
+std::string LoopbackBroker::lastPath() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return path;
+}
+
+void LoopbackBroker::run() {
+  struct pollfd listenPoll = {listenFd, POLLIN, 0};
+  while (running) {
+    if (poll(&listenPoll, 1, POLL_INTERVAL_MS) <= 0) {
+      continue;
+    }
+    int fd = accept(listenFd, NULL, NULL);
+    if (fd < 0) {
+      continue;
+    }
+    int noDelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      options = nextOptions;
+    }
+    subscriptions.clear();
+    connectionPublishes = 0;
+    ++connectionCount;
+    serve(fd);
+    close(fd);
+  }
+}
+
+void LoopbackBroker::serve(int fd) {
+  std::string in;
+  std::string mqtt;
+  bool upgraded = false;
+  char buffer[4096];
+  struct pollfd clientPoll = {fd, POLLIN, 0};
+
+  while (running) {
+    if (poll(&clientPoll, 1, POLL_INTERVAL_MS) <= 0) {
+      continue;
+    }
+    ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+    if (n <= 0) {
+      return;
+    }
+    in.append(buffer, n);
+
+    if (!upgraded) {
+      if (in.find("\r\n\r\n") == std::string::npos) {
+        continue;
+      }
+      if (!handshake(fd, in)) {
+        return;
+      }
+      upgraded = true;
+    }
+
+    // unmask the complete client frames and collect their payload as the MQTT stream
+    while (in.size() >= 2) {
+      const unsigned char *frame = (const unsigned char *) in.data();
+      int opcode = frame[0] & 0x0f;
+      bool masked = frame[1] & 0x80;
+      size_t length = frame[1] & 0x7f;
+      size_t headerLength = 2;
+      if (length == 126) {
+        if (in.size() < 4) {
+          break;
+        }
+        length = (frame[2] << 8) | frame[3];
+        headerLength = 4;
+      } else if (length == 127) {
+        if (in.size() < 10) {
+          break;
+        }
+        length = 0;
+        for (int i = 2; i < 10; ++i) {
+          length = (length << 8) | frame[i];
+        }
+        headerLength = 10;
+      }
+      const unsigned char *mask = frame + headerLength;
+      if (masked) {
+        headerLength += 4;
+      }
+      if (in.size() < headerLength + length) {
+        break;
+      }
+      if (opcode == 0x08) {
+        return;
+      }
+      for (size_t i = 0; i < length; ++i) {
+        mqtt += (char) (frame[headerLength + i] ^ (masked ? mask[i % 4] : 0));
+      }
+      in.erase(0, headerLength + length);
+    }
+
+    std::vector<std::string> out;
+    bool open = handleMqtt(mqtt, out);
+    sendPackets(fd, out);
+    if (!open) {
+      return;
+    }
+  }
+}
+
+// answer the upgrade request with the accept key of RFC 6455
+bool LoopbackBroker::handshake(int fd, std::string &buffer) {
+  size_t end = buffer.find("\r\n\r\n");
+  std::string request = buffer.substr(0, end);
+  buffer.erase(0, end + 4);
+
+  size_t pathStart = request.find(' ');
+  size_t pathEnd = request.find(' ', pathStart + 1);
+  if (request.compare(0, 4, "GET ") != 0 || pathEnd == std::string::npos) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    path = request.substr(pathStart + 1, pathEnd - pathStart - 1);
+  }
+
+  const char *keyHeader = "Sec-WebSocket-Key: ";
+  size_t keyStart = request.find(keyHeader);
+  if (keyStart == std::string::npos) {
+    return false;
+  }
+  keyStart += strlen(keyHeader);
+  std::string key = request.substr(keyStart, request.find("\r\n", keyStart) - keyStart);
+  key += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+  unsigned char hash[20];
+  SHA1_CTX context;
+  SHA1Init(&context);
+  SHA1Update(&context, (const unsigned char *) key.data(), key.size());
+  SHA1Final(hash, &context);
+  char accept[32];
+  base64_encodestate state;
+  base64_init_encodestate(&state);
+  int length = base64_encode_block((const char *) hash, sizeof(hash), accept, &state);
+  base64_encode_blockend(accept + length, &state);
+
+  std::string response = "HTTP/1.1 101 Switching Protocols\r\n"
+    "Upgrade: websocket\r\n"
+    "Connection: Upgrade\r\n"
+    "Sec-WebSocket-Protocol: mqtt\r\n"
+    "Sec-WebSocket-Accept: ";
+  response += accept;
+  response += "\r\n\r\n";
+  sendBytes(fd, response);
+  return true;
+}
+
+bool LoopbackBroker::handleMqtt(std::string &in, std::vector<std::string> &out) {
+  unsigned char reply[16];
+  while (in.size() >= 2) {
+    unsigned char *packet = (unsigned char *) &in[0];
+    int remainingLength = 0;
+    int multiplier = 1;
+    size_t headerLength = 1;
+    do {
+      if (headerLength >= in.size()) {
+        return true;
+      }
+      remainingLength += (packet[headerLength] & 0x7f) * multiplier;
+      multiplier *= 128;
+    } while (packet[headerLength++] & 0x80);
+    size_t packetLength = headerLength + remainingLength;
+    if (in.size() < packetLength) {
+      return true;
+    }
+
+    switch (packet[0] >> 4) {
+      case CONNECT:
+        out.push_back(std::string((char *) reply, MQTTSerialize_connack(reply, sizeof(reply), 0, 0)));
+        break;
+
+      case SUBSCRIBE: {
+        unsigned char dup;
+        unsigned short id;
+        int count;
+        MQTTString filters[MAX_FILTERS];
+        int qos[MAX_FILTERS];
+        if (MQTTDeserialize_subscribe(&dup, &id, MAX_FILTERS, &count, filters, qos, packet, packetLength) != 1) {
+          return false;
+        }
+        for (int i = 0; i < count; ++i) {
+          subscriptions.push_back(std::string(filters[i].lenstring.data, filters[i].lenstring.len));
+          qos[i] = qos[i] > 1 ? 1 : qos[i];
+        }
+        out.push_back(std::string((char *) reply, MQTTSerialize_suback(reply, sizeof(reply), id, count, qos)));
+        break;
+      }
+
+      case UNSUBSCRIBE: {
+        unsigned char dup;
+        unsigned short id;
+        int count;
+        MQTTString filters[MAX_FILTERS];
+        if (MQTTDeserialize_unsubscribe(&dup, &id, MAX_FILTERS, &count, filters, packet, packetLength) != 1) {
+          return false;
+        }
+        for (int i = 0; i < count; ++i) {
+          std::string filter(filters[i].lenstring.data, filters[i].lenstring.len);
+          for (size_t j = 0; j < subscriptions.size(); ++j) {
+            if (subscriptions[j] == filter) {
+              subscriptions.erase(subscriptions.begin() + j);
+              break;
+            }
+          }
+        }
+        out.push_back(std::string((char *) reply, MQTTSerialize_unsuback(reply, sizeof(reply), id)));
+        break;
+      }
+
+      case PUBLISH: {
+        unsigned char dup;
+        int qos;
+        unsigned char retained;
+        unsigned short id;
+        MQTTString topicName;
+        unsigned char *payload;
+        int payloadLength;
+        if (MQTTDeserialize_publish(&dup, &qos, &retained, &id, &topicName, &payload, &payloadLength,
+            packet, packetLength) != 1) {
+          return false;
+        }
+        ++publishCount;
+        if (dup) {
+          ++duplicateCount;
+        }
+        if (options.disconnectAfterPublishes > 0 && ++connectionPublishes >= options.disconnectAfterPublishes) {
+          return false;
+        }
+        if (qos == 1 && options.ackPublishes) {
+          out.push_back(std::string((char *) reply, MQTTSerialize_puback(reply, sizeof(reply), id)));
+        }
+        std::string topic(topicName.lenstring.data, topicName.lenstring.len);
+        for (size_t i = 0; i < subscriptions.size(); ++i) {
+          if (topicMatches(subscriptions[i], topic)) {
+            std::vector<unsigned char> delivery(packetLength + 8);
+            MQTTString deliveryTopic = MQTTString_initializer;
+            deliveryTopic.cstring = (char *) topic.c_str();
+            int length = MQTTSerialize_publish(&delivery[0], delivery.size(), 0, 0, 0, 0, deliveryTopic,
+              payload, payloadLength);
+            out.push_back(std::string((char *) &delivery[0], length));
+            break;
+          }
+        }
+        break;
+      }
+
+      case PINGREQ:
+        out.push_back(std::string((const char *) MQTT_PINGRESP, sizeof(MQTT_PINGRESP)));
+        break;
+
+      case DISCONNECT:
+        return false;
+    }
+    in.erase(0, packetLength);
+  }
+  return true;
+}
+
+void LoopbackBroker::sendPackets(int fd, const std::vector<std::string> &packets) {
+  if (packets.empty()) {
+    return;
+  }
+  std::string stream;
+  if (options.coalesce) {
+    std::string all;
+    for (size_t i = 0; i < packets.size(); ++i) {
+      all += packets[i];
+    }
+    sendFrame(all.data(), all.size(), stream);
+  } else {
+    for (size_t i = 0; i < packets.size(); ++i) {
+      size_t chunk = options.frameChunk > 0 ? options.frameChunk : packets[i].size();
+      for (size_t offset = 0; offset < packets[i].size(); offset += chunk) {
+        sendFrame(packets[i].data() + offset, std::min(chunk, packets[i].size() - offset), stream);
+      }
+    }
+  }
+  sendBytes(fd, stream);
+}
+
+// append an unmasked binary frame
+void LoopbackBroker::sendFrame(const char *data, size_t length, std::string &stream) {
+  stream += (char) 0x82;
+  if (length < 126) {
+    stream += (char) length;
+  } else {
+    stream += (char) 126;
+    stream += (char) (length >> 8);
+    stream += (char) (length & 0xff);
+  }
+  stream.append(data, length);
+}
+
+void LoopbackBroker::sendBytes(int fd, const std::string &stream) {
+  size_t chunk = options.tcpChunk > 0 ? options.tcpChunk : stream.size();
+  for (size_t offset = 0; offset < stream.size(); offset += chunk) {
+    size_t length = std::min(chunk, stream.size() - offset);
+    if (send(fd, stream.data() + offset, length, MSG_NOSIGNAL) != (ssize_t) length) {
+      return;
+    }
+    if (options.tcpChunk > 0) {
+      // give the client the chance to read the chunks one by one
+      usleep(50);
+    }
+  }
+}
+
+bool LoopbackBroker::topicMatches(const std::string &filter, const std::string &topic) {
+  size_t f = 0;
+  size_t t = 0;
+  while (f < filter.size()) {
+    if (filter[f] == '#') {
+      return true;
+    }
+    if (t == topic.size() && filter.compare(f, std::string::npos, "/#") == 0) {
+      return true;
+    }
+    if (filter[f] == '+') {
+      while (t < topic.size() && topic[t] != '/') {
+        ++t;
+      }
+      ++f;
+    } else {
+      if (t >= topic.size() || filter[f] != topic[t]) {
+        return false;
+      }
+      ++f;
+      ++t;
+    }
+  }
+  return t == topic.size();
+}
@@ -0,0 +1,88 @@
+/*
+ * This file is part of Smarkant project
+ *
+ * (C) 2017 Dirk Grappendorf, www.grappendorf.net
+ */
+
+#ifndef LOOPBACK_BROKER_H
+#define LOOPBACK_BROKER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Stand-in for the AWS IoT MQTT over WebSocket endpoint, running in its own thread on a
+ * localhost port. It accepts one connection at a time, answers CONNECT, SUBSCRIBE,
+ * UNSUBSCRIBE and PINGREQ, acknowledges QoS1 publishes and delivers every publish back
+ * to the connection if one of its subscriptions matches the topic.
+ *
+ * The options control how the bytes are sent to the client, so that the client stack
+ * can be exercised with fragmented frames and connection losses.
+ */
+struct LoopbackBrokerOptions {
+  // maximum number of bytes per TCP write, 0 writes everything at once
+  size_t tcpChunk;
+  // maximum number of MQTT bytes per WebSocket frame, 0 sends each packet in one frame
+  size_t frameChunk;
+  // send all packets that are answered to one read in one WebSocket frame
+  bool coalesce;
+  // close the connection after this many received publishes, 0 never closes it
+  int disconnectAfterPublishes;
+  // send a PUBACK for each QoS1 publish
+  bool ackPublishes;
+
+  LoopbackBrokerOptions()
+    : tcpChunk(0), frameChunk(0), coalesce(false), disconnectAfterPublishes(0), ackPublishes(true) {}
+};
+
+class LoopbackBroker {
+public:
+  LoopbackBroker();
+  ~LoopbackBroker();
+
+  // listen on a free localhost port and start the broker thread
+  bool start();
+  void stop();
+  uint16_t port() const { return listenPort; }
+
+  // the options are applied to the next connection
+  void setOptions(const LoopbackBrokerOptions &options);
+
+  int connections() const { return connectionCount; }
+  int publishes() const { return publishCount; }
+  int duplicatePublishes() const { return duplicateCount; }
+  // request path of the last WebSocket upgrade
+  std::string lastPath();
+
+private:
+  void run();
+  void serve(int fd);
+  bool handshake(int fd, std::string &buffer);
+  // handle the complete MQTT packets at the start of in, false if the connection is to be closed
+  bool handleMqtt(std::string &in, std::vector<std::string> &out);
+  void sendPackets(int fd, const std::vector<std::string> &packets);
+  void sendFrame(const char *data, size_t length, std::string &stream);
+  void sendBytes(int fd, const std::string &stream);
+  static bool topicMatches(const std::string &filter, const std::string &topic);
+
+  int listenFd;
+  uint16_t listenPort;
+  std::thread thread;
+  std::atomic<bool> running;
+  std::atomic<int> connectionCount;
+  std::atomic<int> publishCount;
+  std::atomic<int> duplicateCount;
+  std::mutex mutex;
+  LoopbackBrokerOptions nextOptions;
+  LoopbackBrokerOptions options;
+  std::string path;
+  std::vector<std::string> subscriptions;
+  int connectionPublishes;
+};
+
+#endif
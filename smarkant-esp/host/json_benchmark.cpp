@@ -0,0 +1,716 @@
+/*
+ * This file is part of Smarkant project
+ *
+ * (C) 2017 Dirk Grappendorf, www.grappendorf.net
+ *
+ * Measures ArduinoJson on the host, with the number types of the ESP8266 (see CMakeLists.txt).
+ * It is built three times: json_benchmark with the default configuration, json_benchmark_index
+ * with an index for every object, which shows the key count from which the object index pays
+ * off, and json_benchmark_cache with the number cache.
+ * The structs of JsonStruct mirror the json bodies of main.cpp.
+ * The checks of the library that don't depend on the configuration are in
+ * lib/ArduinoJson/benchmark/check.cpp, the ones here run in each configuration.
+ * The numbers are parsed from the files of ArduinoJson's fuzzing seed corpus (SEED_CORPUS_DIR),
+ * whose documents also compare the size and the time of JSON and of MessagePack.
+ *
+ * Usage: json_benchmark [--quick | --all-floats]
+ *
+ * --all-floats checks that every positive float reads back with strtof() after it was written,
+ * which takes some minutes.
+ */
+
+#include <ArduinoJson.h>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+const size_t OBJECT_KEY_COUNTS[] = {2, 4, 8, 12, 16, 32, 64};
+const size_t DEVICE_JSON_BUFFER_LENGTH = 512;
+const char * const SHADOW_DELTA_PATHS[] = {"state.move", "state.position", "state.height"};
+const char * const TELEMETRY_KEYS[] = {"height", "position", "temperature", "current", "voltage", "speed",
+  "target", "uptime"};
+const char * const SEED_CORPUS_FILES[] = {"ArduinoJson.json", "OpenWeatherMap.json",
+  "WeatherUnderground.json"};
+const float TELEMETRY_VALUES[] = {1187.5f, 0.42f, 23.4f, 0.173f, 24.1f, 12.25f, 1200.0f, 86400.0f};
+
+long iterations = 200000;
+int failures = 0;
+long allocations = 0;
+long allocationsBeforeFailure = -1;
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+      ++failures; \
+    } \
+  } while (0)
+
+// counts the blocks of a DynamicJsonBuffer, and fails after allocationsBeforeFailure of them
+class CountingAllocator {
+ public:
+  void *allocate(size_t size) {
+    if (allocationsBeforeFailure == 0) {
+      return NULL;
+    }
+    --allocationsBeforeFailure;
+    ++allocations;
+    return malloc(size);
+  }
+
+  void deallocate(void *pointer) {
+    free(pointer);
+  }
+};
+
+typedef DynamicJsonBufferBase<CountingAllocator> CountingJsonBuffer;
+
+double microsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+void printResult(const char *name, const char *metric, double value, const char *unit) {
+  printf("%-28s %-22s %12.2f %s\n", name, metric, value, unit);
+}
+
+// a flat object like the ones of the weather services, with keys of 8 to 16 chars
+std::string makeObjectJson(size_t keyCount) {
+  std::string json = "{";
+  for (size_t i = 0; i < keyCount; ++i) {
+    char member[48];
+    sprintf(member, "%s\"observation_%03u\":%u", i > 0 ? "," : "", (unsigned) i, (unsigned) i);
+    json += member;
+  }
+  return json + "}";
+}
+
+// containsKey() followed by operator[] for each key, like the handlers in main.cpp
+void benchmarkObjectLookup(size_t keyCount) {
+  std::string json = makeObjectJson(keyCount);
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < keyCount; ++i) {
+    char key[24];
+    sprintf(key, "observation_%03u", (unsigned) i);
+    keys.push_back(key);
+  }
+  DynamicJsonBuffer jsonBuffer;
+  JsonObject &object = jsonBuffer.parseObject(json.c_str());
+  CHECK(object.success());
+  CHECK(object.size() == keyCount);
+
+  long rounds = iterations / keyCount + 1;
+  long sum = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (long round = 0; round < rounds; ++round) {
+    for (size_t i = 0; i < keyCount; ++i) {
+      const char *key = keys[i].c_str();
+      if (object.containsKey(key)) {
+        sum += object[key].as<long>();
+      }
+    }
+  }
+  double elapsed = microsSince(start);
+  CHECK(sum == (long) (rounds * keyCount * (keyCount - 1) / 2));
+  CHECK(!object.containsKey("observation_999"));
+
+  char name[32];
+  sprintf(name, "object lookup (%u keys)", (unsigned) keyCount);
+  printResult(name, "time", elapsed * 1000 / (rounds * keyCount), "ns per key");
+}
+
+void checkObjectChanges() {
+  DynamicJsonBuffer jsonBuffer;
+  JsonObject &object = jsonBuffer.createObject();
+  char key[16];
+  for (int i = 0; i < 100; ++i) {
+    sprintf(key, "k%d", i);
+    object[jsonBuffer.strdup(key)] = i;
+  }
+  object.remove("k10");
+  object["k20"] = -20;
+  object["k100"] = 100;
+  CHECK(object.size() == 100);
+  CHECK(!object.containsKey("k10"));
+  CHECK(object["k20"] == -20);
+  CHECK(object["k99"] == 99);
+  CHECK(object["k100"] == 100);
+  CHECK(object[std::string("k50")] == 50);
+}
+
+// a delta like the shadow service sends it, with the move and some more desired fields
+std::string makeShadowDelta(size_t extraFields) {
+  std::string json = "{\"version\":42,\"timestamp\":1496318400,\"state\":{\"move\":\"height\",\"height\":1200";
+  std::string metadata = "\"metadata\":{\"move\":{\"timestamp\":1496318400},\"height\":{\"timestamp\":1496318400}";
+  for (size_t i = 0; i < extraFields; ++i) {
+    char field[96];
+    sprintf(field, ",\"field%u\":%u", (unsigned) i, (unsigned) i);
+    json += field;
+    sprintf(field, ",\"field%u\":{\"timestamp\":1496318400}", (unsigned) i);
+    metadata += field;
+  }
+  return json + "}," + metadata + "}}";
+}
+
+float floatFromBits(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// the number of significant digits of a number in JSON
+int significantDigits(const char *json) {
+  std::string digits;
+  for (const char *c = json; *c && *c != 'e'; ++c) {
+    if (*c >= '0' && *c <= '9' && (*c != '0' || !digits.empty())) {
+      digits += *c;
+    }
+  }
+  return (int) digits.find_last_not_of('0') + 1;
+}
+
+template <typename TFloat>
+int shortestDigits(TFloat value, TFloat (*parse)(const char *, char **)) {
+  char text[40];
+  int digits = 1;
+  for (; digits < 17; ++digits) {
+    snprintf(text, sizeof(text), "%.*e", digits - 1, (double) value);
+    if (parse(text, NULL) == value) {
+      break;
+    }
+  }
+  return digits;
+}
+
+double parseDouble(const char *text, char **end) {
+  return strtod(text, end);
+}
+
+float parseFloat(const char *text, char **end) {
+  return strtof(text, end);
+}
+
+bool floatRoundTrips(float value, char *json, size_t size) {
+  JsonVariant(value).printTo(json, size);
+  return strtof(json, NULL) == value;
+}
+
+// floats are written with the shortest digits that strtof() reads back as the same value
+void checkFloats() {
+  char json[40];
+  const struct {
+    float value;
+    const char *json;
+  } examples[] = {{0.0f, "0"}, {1200.0f, "1200"}, {-2.5f, "-2.5"}, {0.1f, "0.1"}, {23.4f, "23.4"},
+    {0.0001f, "0.0001"}, {0.00001f, "1e-5"}, {1.5e-7f, "1.5e-7"}, {123456789.0f, "123456790"},
+    {1e10f, "1e10"}, {3.4028235e38f, "3.4028235e38"}, {1e-45f, "1e-45"}, {16777216.0f, "16777216"}};
+  for (size_t i = 0; i < sizeof(examples) / sizeof(examples[0]); ++i) {
+    JsonVariant(examples[i].value).printTo(json, sizeof(json));
+    if (strcmp(json, examples[i].json) != 0) {
+      printf("%.9g is written as %s instead of %s\n", (double) examples[i].value, json, examples[i].json);
+      ++failures;
+    }
+  }
+
+  // a fixed number of decimals is still written as before
+  JsonVariant(1.5f, 2).printTo(json, sizeof(json));
+  CHECK(strcmp(json, "1.50") == 0);
+  JsonVariant(1234.5678f, 1).printTo(json, sizeof(json));
+  CHECK(strcmp(json, "1.2e3") == 0);
+
+  long samples = 0;
+  long longer = 0;
+  for (uint32_t bits = 1; bits < 0x7f800000; bits += 65521) {
+    float value = floatFromBits(bits);
+    if (!floatRoundTrips(value, json, sizeof(json))) {
+      printf("float %.9g is written as %s\n", (double) value, json);
+      ++failures;
+    }
+    int digits = significantDigits(json);
+    int shortest = shortestDigits(value, parseFloat);
+    CHECK(digits >= shortest);
+    longer += digits > shortest;
+    ++samples;
+  }
+  printResult("float digits", "longer than shortest", 100.0 * longer / samples, "% of samples");
+
+  // doubles, for builds with ARDUINOJSON_USE_DOUBLE
+  uint64_t random = 88172645463325252ULL;
+  longer = 0;
+  for (long i = 0; i < iterations; ++i) {
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    uint64_t bits = random & 0x7fffffffffffffffULL;
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    if (value != value || value - value != 0 || value == 0) {
+      continue;
+    }
+    ArduinoJson::Internals::FloatDigits<double> number(value);
+    char text[40];
+    snprintf(text, sizeof(text), "%.*se%d", number.length(), number.digits(), number.exponent());
+    if (strtod(text, NULL) != value) {
+      printf("double %.17g is written as %s\n", value, text);
+      ++failures;
+    }
+    longer += number.length() > shortestDigits(value, parseDouble);
+  }
+  printResult("double digits", "longer than shortest", 100.0 * longer / iterations, "% of samples");
+}
+
+void checkAllFloats() {
+  char json[40];
+  long wrong = 0;
+  for (uint32_t bits = 1; bits < 0x7f800000; ++bits) {
+    float value = floatFromBits(bits);
+    if (!floatRoundTrips(value, json, sizeof(json)) && wrong++ < 10) {
+      printf("float %.9g is written as %s\n", (double) value, json);
+    }
+  }
+  printResult("all positive floats", "not read back", wrong, "floats");
+  failures += wrong > 0;
+}
+
+// a telemetry report of the desk, with the shortest floats and with the two decimals that
+// were the default before
+void benchmarkFloats() {
+  const size_t fieldCount = sizeof(TELEMETRY_VALUES) / sizeof(TELEMETRY_VALUES[0]);
+  char json[256];
+  for (int fixed = 0; fixed < 2; ++fixed) {
+    StaticJsonBuffer<DEVICE_JSON_BUFFER_LENGTH> jsonBuffer;
+    JsonObject &report = jsonBuffer.createObject();
+    for (size_t i = 0; i < fieldCount; ++i) {
+      if (fixed) {
+        report.set(TELEMETRY_KEYS[i], TELEMETRY_VALUES[i], 2);
+      } else {
+        report.set(TELEMETRY_KEYS[i], TELEMETRY_VALUES[i]);
+      }
+    }
+    size_t length = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+      length = report.printTo(json, sizeof(json));
+    }
+    double elapsed = microsSince(start);
+    const char *name = fixed ? "telemetry (2 decimals)" : "telemetry (shortest)";
+    printResult(name, "throughput", iterations * fieldCount / elapsed, "M floats/s");
+    printResult(name, "payload", length, "bytes");
+  }
+}
+
+std::string readSeedCorpus(const char *name) {
+  std::ifstream file((std::string(SEED_CORPUS_DIR) + "/" + name).c_str());
+  CHECK(file.good());
+  std::stringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+// the texts of the numbers in a document, which ArduinoJson keeps unparsed
+void collectNumbers(JsonVariant value, std::vector<std::string> &numbers) {
+  if (value.is<JsonArray &>()) {
+    JsonArray &array = value;
+    for (JsonArray::iterator it = array.begin(); it != array.end(); ++it) {
+      collectNumbers(*it, numbers);
+    }
+  } else if (value.is<JsonObject &>()) {
+    JsonObject &object = value;
+    for (JsonObject::iterator it = object.begin(); it != object.end(); ++it) {
+      collectNumbers(it->value, numbers);
+    }
+  } else if (!value.is<const char *>() && !value.is<bool>() && value.as<const char *>()) {
+    numbers.push_back(value.as<const char *>());
+  }
+}
+
+// the numbers are parsed to the same values as strtod(), strtof() and strtol() do
+void checkNumber(const char *text) {
+  using namespace ArduinoJson::Internals;
+  double expectedDouble = strtod(text, NULL);
+  float expectedFloat = strtof(text, NULL);
+  double actualDouble = parse<double>(text);
+  float actualFloat = parse<float>(text);
+  bool nan = expectedDouble != expectedDouble;
+  if ((!nan && (actualDouble != expectedDouble || actualFloat != expectedFloat)) ||
+      (nan && actualDouble == actualDouble)) {
+    printf("\"%s\" is parsed as %.17g and %.9g\n", text, actualDouble, (double) actualFloat);
+    ++failures;
+  }
+  if (parse<long>(text) != strtol(text, NULL, 10) ||
+      parse<unsigned long>(text) != strtoul(text, NULL, 10)) {
+    printf("\"%s\" is parsed as %ld and %lu\n", text, parse<long>(text), parse<unsigned long>(text));
+    ++failures;
+  }
+}
+
+void checkNumbers() {
+  const char *texts[] = {"0", "-0", "1", "-1", "42", "007", "+5", " 12", "12.5", "1e3", "-0.13",
+    "51.51", "0.1", "0.000123", "1e-7", "3.4028235e38", "1.17549435e-38", "1e-45", "2.5e-324",
+    "1.7976931348623157e308", "1e400", "-1e400", "1e-400", "123456789", "2147483647", "2147483648",
+    "-2147483648", "-2147483649", "4294967295", "4294967296", "9223372036854775807",
+    "9223372036854775808", "-9223372036854775808", "-9223372036854775809", "18446744073709551615",
+    "18446744073709551616", "99999999999999999999999", "123456789012345678901234567890",
+    "00000000000000000000000012", "0.30000000000000004", "9007199254740993", "12e25", "1.5e300",
+    "NaN", "-Infinity", "Infinity", "", "-", ".", "1.", ".5", "1e", "1e+", "0x1A", "12abc", "true"};
+  for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); ++i) {
+    checkNumber(texts[i]);
+  }
+
+  uint64_t random = 88172645463325252ULL;
+  char text[40];
+  for (long i = 0; i < iterations; ++i) {
+    random ^= random << 13;
+    random ^= random >> 7;
+    random ^= random << 17;
+    switch (i % 4) {
+      case 0:
+        snprintf(text, sizeof(text), "%.*g", (int) (random % 17) + 1, (double) (random >> 11) * 1e-10);
+        break;
+      case 1:
+        snprintf(text, sizeof(text), "%.9g", (double) floatFromBits((uint32_t) random & 0x7f7fffff));
+        break;
+      case 2:
+        snprintf(text, sizeof(text), "%lld", (long long) random >> (random % 64));
+        break;
+      default:
+        snprintf(text, sizeof(text), "%u.%02ue%d", (unsigned) (random % 100000), (unsigned) (random % 100),
+          (int) (random % 80) - 40);
+    }
+    checkNumber(text);
+  }
+
+  for (size_t i = 0; i < sizeof(SEED_CORPUS_FILES) / sizeof(SEED_CORPUS_FILES[0]); ++i) {
+    DynamicJsonBuffer jsonBuffer;
+    std::vector<std::string> numbers;
+    collectNumbers(jsonBuffer.parse(readSeedCorpus(SEED_CORPUS_FILES[i])), numbers);
+    CHECK(!numbers.empty());
+    for (size_t j = 0; j < numbers.size(); ++j) {
+      checkNumber(numbers[j].c_str());
+    }
+  }
+
+#if ARDUINOJSON_ENABLE_NUMBER_CACHE
+  // an integer is replaced by its value but keeps its text, a float stays as it was written
+  DynamicJsonBuffer jsonBuffer;
+  JsonObject &object = jsonBuffer.parseObject("{\"a\":-12,\"b\":1.50,\"c\":012,\"d\":[7]}");
+  CHECK(object["a"] == -12);
+  CHECK(object.get<long>("a") == -12);
+  CHECK(strcmp(object.get<const char *>("a"), "-12") == 0);
+  JsonArray &array = object["d"];
+  CHECK(array.get<int>(0) == 7);
+  CHECK(strcmp(array.get<const char *>(0), "7") == 0);
+  array[0] = 8;
+  CHECK(array.get<const char *>(0) == NULL);
+  CHECK(object["b"].as<float>() == 1.5f);
+  CHECK(object["c"].as<int>() == 12);
+  char json[40];
+  object.printTo(json, sizeof(json));
+  CHECK(strcmp(json, "{\"a\":-12,\"b\":1.50,\"c\":012,\"d\":[8]}") == 0);
+#endif
+}
+
+// converts the numbers of each seed corpus file, with the decoder of Data/Parse.hpp and with the
+// functions of the C library it replaces
+void benchmarkNumbers() {
+  for (size_t i = 0; i < sizeof(SEED_CORPUS_FILES) / sizeof(SEED_CORPUS_FILES[0]); ++i) {
+    DynamicJsonBuffer jsonBuffer;
+    std::vector<std::string> numbers;
+    collectNumbers(jsonBuffer.parse(readSeedCorpus(SEED_CORPUS_FILES[i])), numbers);
+    long rounds = iterations / (long) numbers.size() + 1;
+
+    for (int libc = 0; libc < 2; ++libc) {
+      double sum = 0;
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      for (long round = 0; round < rounds; ++round) {
+        for (size_t j = 0; j < numbers.size(); ++j) {
+          const char *text = numbers[j].c_str();
+          if (libc) {
+            sum += (float) strtod(text, NULL) + strtol(text, NULL, 10);
+          } else {
+            sum += ArduinoJson::Internals::parse<float>(text) + ArduinoJson::Internals::parse<long>(text);
+          }
+        }
+      }
+      double elapsed = microsSince(start);
+      CHECK(sum != 0);
+      char name[40];
+      sprintf(name, "%.*s (%u numbers)", (int) (strlen(SEED_CORPUS_FILES[i]) - 5), SEED_CORPUS_FILES[i],
+        (unsigned) numbers.size());
+      printResult(name, libc ? "strtod + strtol" : "parse<float> + <long>", rounds * numbers.size() / elapsed,
+        "M numbers/s");
+    }
+  }
+
+  // the height of a delta, read like the handlers of main.cpp read it
+  DynamicJsonBuffer jsonBuffer;
+  JsonObject &delta = jsonBuffer.parseObject(makeShadowDelta(0));
+  long sum = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; ++i) {
+    sum += delta["state"]["height"].as<int>();
+  }
+  double elapsed = microsSince(start);
+  CHECK(sum == 1200 * iterations);
+  printResult("shadow delta height", "read", elapsed * 1000 / iterations, "ns");
+}
+
+// a document with strings that don't fit in the first blocks
+std::string makeLongStrings(size_t length) {
+  return "{\"short\":\"abc\",\"long\":\"" + std::string(length, 'x') + "\",\"escaped\":\"" +
+    std::string(length / 2, 'y') + "\\n\"}";
+}
+
+template <typename TPrintable>
+std::string printed(const TPrintable &value) {
+  std::string json;
+  value.printTo(json);
+  return json;
+}
+
+// allocations and time per parse of a document, with a new DynamicJsonBuffer each time and with
+// one that is reset
+void benchmarkDynamicBuffer(const char *name, const std::string &json) {
+  for (int reuse = 0; reuse < 2; ++reuse) {
+    CountingJsonBuffer reused;
+    long before = allocations;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations / 10; ++i) {
+      if (reuse) {
+        reused.reset();
+        CHECK(reused.parse(json).success());
+      } else {
+        CountingJsonBuffer jsonBuffer;
+        CHECK(jsonBuffer.parse(json).success());
+      }
+    }
+    double elapsed = microsSince(start);
+    printResult(name, reuse ? "parse after reset()" : "parse", elapsed / (iterations / 10), "us");
+    printResult(name, reuse ? "allocs after reset()" : "allocations", (double) (allocations - before) /
+      (iterations / 10), "per parse");
+  }
+}
+
+// the fields of the shadow messages, like in main.cpp
+struct MoveJson {
+  char move[10];
+  bool hasMove;
+  int height;
+  bool hasHeight;
+  int position;
+  bool hasPosition;
+
+  template <typename TFields>
+  static void jsonFields(TFields &fields) {
+    fields("move", &MoveJson::move, &MoveJson::hasMove);
+    fields("height", &MoveJson::height, &MoveJson::hasHeight);
+    fields("position", &MoveJson::position, &MoveJson::hasPosition);
+  }
+};
+
+struct ShadowDeltaJson {
+  MoveJson state;
+  uint32_t version;
+
+  template <typename TFields>
+  static void jsonFields(TFields &fields) {
+    fields("state", &ShadowDeltaJson::state);
+    fields("version", &ShadowDeltaJson::version);
+  }
+};
+
+struct ShadowUpdateJson {
+  const char *desired;
+  MoveJson reported;
+
+  template <typename TFields>
+  static void jsonFields(TFields &fields) {
+    fields("desired", &ShadowUpdateJson::desired);
+    fields("reported", &ShadowUpdateJson::reported);
+  }
+};
+
+// parse a delta into the JsonBuffer of the device, with and without the filter of main.cpp,
+// and in place like main.cpp does it
+void benchmarkFilter(size_t extraFields) {
+  const char *const MODES[] = {"parse", "filtered parse", "filtered in place"};
+  const char *const BUFFERS[] = {"buffer", "filtered buffer", "in place buffer"};
+  std::string json = makeShadowDelta(extraFields);
+  std::vector<char> payload(json.size());
+  const JsonFilter filter(SHADOW_DELTA_PATHS);
+  char name[40];
+  sprintf(name, "shadow delta (%u bytes)", (unsigned) json.size());
+
+  for (int mode = 0; mode < 3; ++mode) {
+    size_t used = 0;
+    bool success = false;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations / 10; ++i) {
+      StaticJsonBuffer<DEVICE_JSON_BUFFER_LENGTH> jsonBuffer;
+      if (mode == 0) {
+        success = jsonBuffer.parseObject(json).success();
+      } else if (mode == 1) {
+        success = jsonBuffer.parseObject(json, filter).success();
+      } else {
+        // the receive buffer gets a new message each time
+        memcpy(&payload[0], json.data(), json.size());
+        success = jsonBuffer.parseObjectN(&payload[0], payload.size(), filter).success();
+      }
+      used = jsonBuffer.size();
+    }
+    double elapsed = microsSince(start);
+    printResult(name, MODES[mode], elapsed / (iterations / 10), "us");
+    if (success) {
+      printResult(name, BUFFERS[mode], used, "bytes");
+    } else {
+      printResult(name, BUFFERS[mode], DEVICE_JSON_BUFFER_LENGTH, "bytes, too small");
+    }
+    CHECK(success || mode == 0);
+  }
+}
+
+// parse the same delta straight into the fields
+void benchmarkStruct(size_t extraFields) {
+  std::string json = makeShadowDelta(extraFields);
+  char name[40];
+  sprintf(name, "shadow delta (%u bytes)", (unsigned) json.size());
+  bool success = true;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations / 10; ++i) {
+    ShadowDeltaJson delta = ShadowDeltaJson();
+    success = JsonStruct<ShadowDeltaJson>(delta).parseN(json.data(), json.size()) && success;
+  }
+  double elapsed = microsSince(start);
+  CHECK(success);
+  printResult(name, "struct parse", elapsed / (iterations / 10), "us");
+  printResult(name, "struct", sizeof(ShadowDeltaJson), "bytes");
+}
+
+// print a shadow update from a struct and from a JsonObject
+void benchmarkStructPrint() {
+  ShadowUpdateJson update = ShadowUpdateJson();
+  strcpy(update.reported.move, "height");
+  update.reported.hasMove = true;
+  update.reported.height = 1200;
+  update.reported.hasHeight = true;
+  char buffer[128];
+  size_t length = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; ++i) {
+    length += JsonStruct<ShadowUpdateJson>(update).printTo(buffer, sizeof(buffer));
+  }
+  printResult("shadow update", "struct print", microsSince(start) / iterations, "us");
+  size_t expected = length;
+  length = 0;
+  start = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; ++i) {
+    StaticJsonBuffer<DEVICE_JSON_BUFFER_LENGTH> jsonBuffer;
+    JsonObject &state = jsonBuffer.createObject();
+    state["desired"] = (char *) NULL;
+    JsonObject &reported = state.createNestedObject("reported");
+    reported["move"] = "height";
+    reported["height"] = 1200;
+    length += state.printTo(buffer, sizeof(buffer));
+  }
+  printResult("shadow update", "object print", microsSince(start) / iterations, "us");
+  CHECK(length == expected);
+}
+
+template <typename TPrintable>
+std::string msgPack(const TPrintable &value) {
+  std::vector<char> buffer(value.measureMsgPackLength() + 1);
+  size_t length = value.printMsgPackTo(&buffer[0], buffer.size());
+  return std::string(&buffer[0], length);
+}
+
+// the same documents in JSON and in MessagePack: size, JsonBuffer and time to parse and to print
+void benchmarkMsgPack(const char *name, const std::string &json) {
+  DynamicJsonBuffer jsonBuffer;
+  JsonVariant root = jsonBuffer.parse(json);
+  std::string compact = printed(root);
+  std::string bytes = msgPack(root);
+  printResult(name, "json", compact.size(), "bytes");
+  printResult(name, "msgpack", bytes.size(), "bytes");
+
+  std::vector<char> output(compact.size() + 1);
+  for (int format = 0; format < 2; ++format) {
+    const char *parseMetric = format ? "msgpack parse" : "json parse";
+    const char *printMetric = format ? "msgpack print" : "json print";
+    DynamicJsonBuffer parseBuffer;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations / 10; ++i) {
+      parseBuffer.reset();
+      JsonVariant value = format ? parseBuffer.parseMsgPack(bytes.data(), bytes.size())
+        : parseBuffer.parseN(compact.data(), compact.size());
+      CHECK(value.success());
+    }
+    printResult(name, parseMetric, microsSince(start) / (iterations / 10), "us");
+    printResult(name, format ? "msgpack buffer" : "json buffer", parseBuffer.size(), "bytes");
+
+    JsonVariant value = format ? parseBuffer.parseMsgPack(bytes.data(), bytes.size())
+      : parseBuffer.parseN(compact.data(), compact.size());
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations / 10; ++i) {
+      if (format) {
+        value.printMsgPackTo(&output[0], output.size());
+      } else {
+        value.printTo(&output[0], output.size());
+      }
+    }
+    printResult(name, printMetric, microsSince(start) / (iterations / 10), "us");
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "--quick") == 0) {
+    iterations = 2000;
+  }
+  if (argc > 1 && strcmp(argv[1], "--all-floats") == 0) {
+    checkAllFloats();
+    return failures > 0 ? 1 : 0;
+  }
+#if ARDUINOJSON_ENABLE_OBJECT_INDEX
+  printf("object index from %d keys\n", ARDUINOJSON_OBJECT_INDEX_THRESHOLD);
+#else
+  printf("no object index\n");
+#endif
+#if ARDUINOJSON_ENABLE_NUMBER_CACHE
+  printf("number cache\n");
+#endif
+  checkObjectChanges();
+  checkFloats();
+  checkNumbers();
+  for (size_t i = 0; i < sizeof(OBJECT_KEY_COUNTS) / sizeof(OBJECT_KEY_COUNTS[0]); ++i) {
+    benchmarkObjectLookup(OBJECT_KEY_COUNTS[i]);
+  }
+  benchmarkFilter(0);
+  benchmarkFilter(8);
+  benchmarkStruct(0);
+  benchmarkStruct(8);
+  benchmarkStructPrint();
+  benchmarkFloats();
+  benchmarkNumbers();
+  for (size_t i = 0; i < sizeof(SEED_CORPUS_FILES) / sizeof(SEED_CORPUS_FILES[0]); ++i) {
+    std::string name(SEED_CORPUS_FILES[i], strlen(SEED_CORPUS_FILES[i]) - 5);
+    benchmarkDynamicBuffer(name.c_str(), readSeedCorpus(SEED_CORPUS_FILES[i]));
+  }
+  benchmarkDynamicBuffer("shadow delta", makeShadowDelta(8));
+  benchmarkDynamicBuffer("strings of 1 KB", makeLongStrings(1024));
+  benchmarkDynamicBuffer("strings of 64 KB", makeLongStrings(65536));
+  for (size_t i = 0; i < sizeof(SEED_CORPUS_FILES) / sizeof(SEED_CORPUS_FILES[0]); ++i) {
+    std::string name(SEED_CORPUS_FILES[i], strlen(SEED_CORPUS_FILES[i]) - 5);
+    benchmarkMsgPack(name.c_str(), readSeedCorpus(SEED_CORPUS_FILES[i]));
+  }
+  benchmarkMsgPack("shadow delta", makeShadowDelta(8));
+
+  if (failures > 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
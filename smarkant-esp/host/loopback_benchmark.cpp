@@ -0,0 +1,260 @@
+/*
+ * This file is part of Smarkant project
+ *
+ * (C) 2017 Dirk Grappendorf, www.grappendorf.net
+ *
+ * Measures the MQTT over WebSocket stack of the device against the loopback broker:
+ * command round trip latency, throughput and heap allocations per message, with whole
+ * and with fragmented frames. It also measures the signing of the connection url and
+ * the circular byte buffer.
+ *
+ * Usage: loopback_benchmark [--quick]
+ */
+
+#include "LoopbackClient.h"
+#include <algorithm>
+#include <vector>
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+}
+
+// allocations are only counted in the thread of the client, not in the broker thread
+static __thread bool countAllocations = false;
+static __thread unsigned long allocations = 0;
+
+extern "C" void *malloc(size_t size) {
+  if (countAllocations) {
+    ++allocations;
+  }
+  return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) {
+  if (countAllocations) {
+    ++allocations;
+  }
+  return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *pointer, size_t size) {
+  if (countAllocations) {
+    ++allocations;
+  }
+  return __libc_realloc(pointer, size);
+}
+
+typedef MQTT::Client<IPStack, Countdown, 512, 2, 4, 512> MqttClient;
+
+const char * const COMMAND_FILTER = "smarkant/+/command";
+const char * const COMMAND_TOPIC = "smarkant/Smarkant/command";
+const unsigned long DELIVERY_TIMEOUT_MS = 2000;
+const int THROUGHPUT_BATCH = 4;
+
+FixedDateTimeProvider dateTimeProvider;
+LoopbackBroker broker;
+LoopbackWebSocketClient webSocketClient;
+IPStack ipStack(webSocketClient);
+MqttClient mqttClient(ipStack, 1000);
+int deliveries = 0;
+int iterations = 20000;
+
+void messageReceived(MQTT::MessageData &) {
+  ++deliveries;
+}
+
+bool waitForDeliveries(int count) {
+  unsigned long start = millis();
+  while (deliveries < count && millis() - start < DELIVERY_TIMEOUT_MS) {
+    if (mqttClient.yield(0) != MQTT::SUCCESS) {
+      return false;
+    }
+  }
+  return deliveries >= count;
+}
+
+bool connectWithOptions(const LoopbackBrokerOptions &options) {
+  broker.setOptions(options);
+  return connectLoopback(webSocketClient, mqttClient, broker.port()) &&
+    mqttClient.subscribe(COMMAND_FILTER, MQTT::QOS0, messageReceived) == MQTT::SUCCESS;
+}
+
+void printResult(const char *name, const char *metric, double value, const char *unit) {
+  printf("%-28s %-22s %12.2f %s\n", name, metric, value, unit);
+}
+
+// publish a command and wait for its delivery, one after the other
+bool benchmarkRoundTrip(const char *name, const LoopbackBrokerOptions &options, size_t payloadLength) {
+  if (!connectWithOptions(options)) {
+    printf("%s: unable to connect\n", name);
+    return false;
+  }
+  std::vector<unsigned char> payload(payloadLength, 0x5a);
+  std::vector<unsigned long> latencies;
+  latencies.reserve(iterations);
+  allocations = 0;
+  for (int i = 0; i < iterations; ++i) {
+    unsigned long start = micros();
+    countAllocations = true;
+    int expected = deliveries + 1;
+    bool ok = mqttClient.publish(COMMAND_TOPIC, &payload[0], payloadLength, MQTT::QOS0) == MQTT::SUCCESS &&
+      waitForDeliveries(expected);
+    countAllocations = false;
+    if (!ok) {
+      printf("%s: round trip %d failed\n", name, i);
+      return false;
+    }
+    latencies.push_back(micros() - start);
+  }
+  std::sort(latencies.begin(), latencies.end());
+  printResult(name, "latency min", latencies[0], "us");
+  printResult(name, "latency median", latencies[latencies.size() / 2], "us");
+  printResult(name, "latency p99", latencies[latencies.size() * 99 / 100], "us");
+  printResult(name, "allocations", (double) allocations / iterations, "per message");
+  return true;
+}
+
+// keep a few commands on the way, so the client reads several messages per yield
+bool benchmarkThroughput(const char *name, const LoopbackBrokerOptions &options, size_t payloadLength) {
+  if (!connectWithOptions(options)) {
+    printf("%s: unable to connect\n", name);
+    return false;
+  }
+  std::vector<unsigned char> payload(payloadLength, 0xa5);
+  int messages = iterations - iterations % THROUGHPUT_BATCH;
+  unsigned long start = micros();
+  for (int i = 0; i < messages; i += THROUGHPUT_BATCH) {
+    int expected = deliveries + THROUGHPUT_BATCH;
+    for (int j = 0; j < THROUGHPUT_BATCH; ++j) {
+      if (mqttClient.publish(COMMAND_TOPIC, &payload[0], payloadLength, MQTT::QOS0) != MQTT::SUCCESS) {
+        printf("%s: publish failed\n", name);
+        return false;
+      }
+    }
+    if (!waitForDeliveries(expected)) {
+      printf("%s: deliveries missing\n", name);
+      return false;
+    }
+  }
+  double seconds = (micros() - start) / 1e6;
+  printResult(name, "messages", messages / seconds, "per s");
+  printResult(name, "payload", messages * payloadLength / seconds / 1024, "KiB/s");
+  return true;
+}
+
+/**
+ * Changes the day with each call, so that each url is signed with a newly derived signing key.
+ */
+class AlternatingDateTimeProvider : public IDateTimeProvider {
+public:
+  AlternatingDateTimeProvider() : calls(0) {}
+  const char *getDateTime() { return ++calls % 2 ? "20170601120000" : "20170602120000"; }
+  bool syncTakesArg() { return false; }
+  void sync(const char *) {}
+
+private:
+  unsigned long calls;
+};
+
+// time and heap allocations per signed url, with the signing key of the day cached and derived anew
+void benchmarkSigning() {
+  AlternatingDateTimeProvider alternatingDateTimeProvider;
+  IDateTimeProvider *providers[] = {&dateTimeProvider, &alternatingDateTimeProvider};
+  const char *names[] = {"generateAWSPath", "generateAWSPath new key"};
+  char path[AWS_PATH_MAX_LEN];
+  int count = iterations / 4;
+  for (int p = 0; p < 2; ++p) {
+    webSocketClient.setDateTimeProvider(providers[p]);
+    webSocketClient.signPath(443, path, sizeof(path));
+    allocations = 0;
+    unsigned long start = micros();
+    countAllocations = true;
+    for (int i = 0; i < count; ++i) {
+      if (!webSocketClient.signPath(443, path, sizeof(path))) {
+        countAllocations = false;
+        printf("signing failed\n");
+        return;
+      }
+    }
+    countAllocations = false;
+    printResult(names[p], "time", (double) (micros() - start) / count, "us per url");
+    printResult(names[p], "allocations", (double) allocations / count, "per url");
+  }
+  webSocketClient.setDateTimeProvider(&dateTimeProvider);
+}
+
+void benchmarkCircularByteBuffer() {
+  const long CAPACITY = 1000;
+  const long CHUNK = 100;
+  long rounds = iterations * 10L;
+  CircularByteBuffer bb;
+  bb.init(CAPACITY);
+  byte data[CHUNK];
+  memset(data, 0x33, sizeof(data));
+
+  unsigned long start = micros();
+  unsigned long check = 0;
+  for (long i = 0; i < rounds; ++i) {
+    for (long j = 0; j < CHUNK; ++j) {
+      bb.push(data[j]);
+    }
+    for (long j = 0; j < CHUNK; ++j) {
+      check += bb.pop();
+    }
+  }
+  double seconds = (micros() - start) / 1e6;
+  printResult("CircularByteBuffer", "byte push/pop", rounds * CHUNK / seconds / 1048576, "MiB/s");
+
+  start = micros();
+  for (long i = 0; i < rounds; ++i) {
+    bb.push(data, CHUNK);
+    check += bb.pop(data, CHUNK);
+  }
+  seconds = (micros() - start) / 1e6;
+  printResult("CircularByteBuffer", "block push/pop", rounds * CHUNK / seconds / 1048576, "MiB/s");
+
+  start = micros();
+  for (long i = 0; i < rounds; ++i) {
+    long length;
+    byte *span = bb.writableSpan(&length);
+    length = std::min(length, CHUNK);
+    memcpy(span, data, length);
+    bb.commit(length);
+    span = bb.readableSpan(&length);
+    check += span[0];
+    bb.consume(length);
+  }
+  seconds = (micros() - start) / 1e6;
+  printResult("CircularByteBuffer", "span commit/consume", rounds * CHUNK / seconds / 1048576, "MiB/s");
+  if (check == 0) {
+    printf("\n");
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc > 1 && strcmp(argv[1], "--quick") == 0) {
+    iterations = 500;
+  }
+  if (!broker.start()) {
+    printf("unable to start the loopback broker\n");
+    return 1;
+  }
+  setupLoopbackClient(webSocketClient, &dateTimeProvider);
+
+  LoopbackBrokerOptions whole;
+  LoopbackBrokerOptions fragmented;
+  fragmented.tcpChunk = 16;
+  fragmented.frameChunk = 16;
+  bool ok = benchmarkRoundTrip("command (4 bytes)", whole, 4) &&
+    benchmarkRoundTrip("shadow delta (300 bytes)", whole, 300) &&
+    benchmarkRoundTrip("fragmented (300 bytes)", fragmented, 300) &&
+    benchmarkThroughput("throughput (256 bytes)", whole, 256);
+  benchmarkSigning();
+  benchmarkCircularByteBuffer();
+
+  webSocketClient.stop();
+  broker.stop();
+  return ok ? 0 : 1;
+}
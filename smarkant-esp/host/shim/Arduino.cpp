@@ -0,0 +1,265 @@
+/*
+ * This file is part of Smarkant project
+ *
+ * (C) 2017 Dirk Grappendorf, www.grappendorf.net
+ */
+
+#include <Arduino.h>
+#include <Ethernet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint64_t monotonicMicros() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+// start at one second, Countdown treats an end time of 0 as not running
+static const uint64_t startMicros = monotonicMicros() - 1000000;
+
+unsigned long millis() {
+  return (monotonicMicros() - startMicros) / 1000;
+}
+
+unsigned long micros() {
+  return monotonicMicros() - startMicros;
+}
+
+void delay(unsigned long ms) {
+  usleep(ms * 1000);
+}
+
+void yield() {
+  sched_yield();
+}
+
+long random(long max) {
+  return max > 0 ? rand() % max : 0;
+}
+
+long random(long min, long max) {
+  return min < max ? min + random(max - min) : min;
+}
+
+void randomSeed(unsigned long seed) {
+  srand(seed);
+}
+
+bool String::equalsIgnoreCase(const String &other) const {
+  if (s.length() != other.s.length()) {
+    return false;
+  }
+  for (size_t i = 0; i < s.length(); ++i) {
+    if (tolower((unsigned char) s[i]) != tolower((unsigned char) other.s[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool String::endsWith(const String &suffix) const {
+  return s.length() >= suffix.s.length() &&
+    s.compare(s.length() - suffix.s.length(), suffix.s.length(), suffix.s) == 0;
+}
+
+int String::indexOf(char c, unsigned int from) const {
+  size_t index = s.find(c, from);
+  return index == std::string::npos ? -1 : (int) index;
+}
+
+int String::indexOf(const String &str, unsigned int from) const {
+  size_t index = s.find(str.s, from);
+  return index == std::string::npos ? -1 : (int) index;
+}
+
+String String::substring(unsigned int from, unsigned int to) const {
+  if (from > to) {
+    unsigned int swap = from;
+    from = to;
+    to = swap;
+  }
+  if (from >= s.length()) {
+    return String();
+  }
+  return String(s.substr(from, to - from));
+}
+
+void String::toLowerCase() {
+  for (size_t i = 0; i < s.length(); ++i) {
+    s[i] = tolower((unsigned char) s[i]);
+  }
+}
+
+void String::toUpperCase() {
+  for (size_t i = 0; i < s.length(); ++i) {
+    s[i] = toupper((unsigned char) s[i]);
+  }
+}
+
+void String::trim() {
+  size_t begin = s.find_first_not_of(" \t\r\n");
+  if (begin == std::string::npos) {
+    s.clear();
+    return;
+  }
+  size_t end = s.find_last_not_of(" \t\r\n");
+  s = s.substr(begin, end - begin + 1);
+}
+
+int Stream::timedRead() {
+  unsigned long start = millis();
+  do {
+    if (available() > 0) {
+      return read();
+    }
+    yield();
+  } while (millis() - start < timeout);
+  return -1;
+}
+
+size_t Stream::readBytes(char *buffer, size_t length) {
+  size_t count = 0;
+  while (count < length) {
+    int c = timedRead();
+    if (c < 0) {
+      break;
+    }
+    buffer[count++] = (char) c;
+  }
+  return count;
+}
+
+String Stream::readStringUntil(char terminator) {
+  String line;
+  int c = timedRead();
+  while (c >= 0 && c != terminator) {
+    line += (char) c;
+    c = timedRead();
+  }
+  return line;
+}
+
+EthernetClient::EthernetClient() : fd(-1) {
+}
+
+EthernetClient::~EthernetClient() {
+  stop();
+}
+
+int EthernetClient::connect(IPAddress ip, uint16_t port) {
+  char host[16];
+  uint32_t address = ip;
+  snprintf(host, sizeof(host), "%u.%u.%u.%u", address & 0xff, (address >> 8) & 0xff,
+    (address >> 16) & 0xff, address >> 24);
+  return connect(host, port);
+}
+
+int EthernetClient::connect(const char *host, uint16_t port) {
+  stop();
+  struct addrinfo hints;
+  struct addrinfo *addresses;
+  char service[6];
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  snprintf(service, sizeof(service), "%u", port);
+  if (getaddrinfo(host, service, &hints, &addresses) != 0) {
+    return 0;
+  }
+  fd = socket(addresses->ai_family, addresses->ai_socktype, addresses->ai_protocol);
+  if (fd >= 0 && ::connect(fd, addresses->ai_addr, addresses->ai_addrlen) != 0) {
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addresses);
+  if (fd < 0) {
+    return 0;
+  }
+  // like lwip on the esp8266 with nagle disabled, reads never block
+  int noDelay = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return 1;
+}
+
+size_t EthernetClient::write(uint8_t b) {
+  return write(&b, 1);
+}
+
+size_t EthernetClient::write(const uint8_t *buffer, size_t size) {
+  size_t written = 0;
+  while (fd >= 0 && written < size) {
+    ssize_t n = send(fd, buffer + written, size - written, MSG_NOSIGNAL);
+    if (n > 0) {
+      written += n;
+    } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+      yield();
+    } else {
+      break;
+    }
+  }
+  return written;
+}
+
+int EthernetClient::available() {
+  int count = 0;
+  if (fd < 0 || ioctl(fd, FIONREAD, &count) != 0) {
+    return 0;
+  }
+  return count;
+}
+
+int EthernetClient::read() {
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+int EthernetClient::read(uint8_t *buffer, size_t size) {
+  if (fd < 0) {
+    return -1;
+  }
+  ssize_t n = recv(fd, buffer, size, 0);
+  return n > 0 ? (int) n : -1;
+}
+
+int EthernetClient::peek() {
+  uint8_t b;
+  if (fd < 0 || recv(fd, &b, 1, MSG_PEEK) != 1) {
+    return -1;
+  }
+  return b;
+}
+
+void EthernetClient::flush() {
+}
+
+void EthernetClient::stop() {
+  if (fd >= 0) {
+    close(fd);
+    fd = -1;
+  }
+}
+
+// like the arduino clients, a closed connection counts as connected while there are unread bytes
+uint8_t EthernetClient::connected() {
+  if (fd < 0) {
+    return 0;
+  }
+  uint8_t b;
+  ssize_t n = recv(fd, &b, 1, MSG_PEEK);
+  return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR));
+}
+
+EthernetClient::operator bool() {
+  return fd >= 0;
+}
@@ -0,0 +1,38 @@
+/*
+ * This file is part of Smarkant project
+ *
+ * (C) 2017 Dirk Grappendorf, www.grappendorf.net
+ *
+ * Network client of the WebSocket library on the host: a non-blocking POSIX TCP socket.
+ */
+
+#ifndef HOST_ETHERNET_H
+#define HOST_ETHERNET_H
+
+#include "Client.h"
+
+class EthernetClient : public Client {
+public:
+  EthernetClient();
+  ~EthernetClient();
+
+  using Print::write;
+
+  int connect(IPAddress ip, uint16_t port);
+  int connect(const char *host, uint16_t port);
+  size_t write(uint8_t b);
+  size_t write(const uint8_t *buffer, size_t size);
+  int available();
+  int read();
+  int read(uint8_t *buffer, size_t size);
+  int peek();
+  void flush();
+  void stop();
+  uint8_t connected();
+  operator bool();
+
+private:
+  int fd;
+};
+
+#endif
@@ -0,0 +1,25 @@
+/*
+ * This file is part of Smarkant project
+ *
+ * (C) 2017 Dirk Grappendorf, www.grappendorf.net
+ */
+
+#ifndef HOST_IPADDRESS_H
+#define HOST_IPADDRESS_H
+
+#include <stdint.h>
+
+class IPAddress {
+public:
+  IPAddress() : address(0) {}
+  IPAddress(uint32_t address) : address(address) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+    : address(a | (b << 8) | (c << 16) | ((uint32_t) d << 24)) {}
+  operator uint32_t() const { return address; }
+  bool operator==(const IPAddress &other) const { return address == other.address; }
+
+private:
+  uint32_t address;
+};
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * This file is part of Smarkant project
+ *
+ * (C) 2017 Dirk Grappendorf, www.grappendorf.net
+ */
+
+#ifndef HOST_PRINT_H
+#define HOST_PRINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t b) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size) {
+    size_t n = 0;
+    while (size-- && write(*buffer++)) {
+      ++n;
+    }
+    return n;
+  }
+  size_t write(const char *str) {
+    return write((const uint8_t *) str, strlen(str));
+  }
+  size_t print(const char *str) {
+    return write((const uint8_t *) str, strlen(str));
+  }
+};
+
+#endif
@@ -0,0 +1,7 @@
+/*
+ * This file is part of Smarkant project
+ *
+ * (C) 2017 Dirk Grappendorf, www.grappendorf.net
+ *
+ * Empty, the host network client doesn't need SPI.
+ */
@@ -0,0 +1,33 @@
+/*
+ * This file is part of Smarkant project
+ *
+ * (C) 2017 Dirk Grappendorf, www.grappendorf.net
+ */
+
+#ifndef HOST_STREAM_H
+#define HOST_STREAM_H
+
+#include "Print.h"
+#include "WString.h"
+
+class Stream : public Print {
+public:
+  Stream() : timeout(1000) {}
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() = 0;
+
+  void setTimeout(unsigned long timeout) { this->timeout = timeout; }
+  size_t readBytes(char *buffer, size_t length);
+  size_t readBytes(uint8_t *buffer, size_t length) { return readBytes((char *) buffer, length); }
+  String readStringUntil(char terminator);
+
+protected:
+  // read a byte, waiting at most timeout milliseconds for it (-1 on timeout)
+  int timedRead();
+
+  unsigned long timeout;
+};
+
+#endif
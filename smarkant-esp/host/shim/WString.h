@@ -0,0 +1,66 @@
+/*
+ * This file is part of Smarkant project
+ *
+ * (C) 2017 Dirk Grappendorf, www.grappendorf.net
+ *
+ * The subset of the Arduino String class that is used by the WebSocket library.
+ */
+
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+#include <string>
+
+class String {
+public:
+  String() {}
+  String(const char *str) : s(str ? str : "") {}
+  String(const std::string &str) : s(str) {}
+  String(char c) : s(1, c) {}
+  String(int value) : s(std::to_string(value)) {}
+  String(unsigned int value) : s(std::to_string(value)) {}
+  String(long value) : s(std::to_string(value)) {}
+  String(unsigned long value) : s(std::to_string(value)) {}
+
+  const char *c_str() const { return s.c_str(); }
+  unsigned int length() const { return s.length(); }
+  char charAt(unsigned int index) const { return index < s.length() ? s[index] : 0; }
+  char operator[](unsigned int index) const { return charAt(index); }
+
+  String &operator+=(const String &other) { s += other.s; return *this; }
+  String &operator+=(const char *str) { s += str; return *this; }
+  String &operator+=(char c) { s += c; return *this; }
+  String &operator+=(int value) { s += std::to_string(value); return *this; }
+  String &operator+=(unsigned int value) { s += std::to_string(value); return *this; }
+
+  bool operator==(const String &other) const { return s == other.s; }
+  bool operator==(const char *str) const { return s == str; }
+  bool operator!=(const String &other) const { return s != other.s; }
+  bool operator!=(const char *str) const { return s != str; }
+  bool equals(const String &other) const { return s == other.s; }
+  bool equalsIgnoreCase(const String &other) const;
+  bool startsWith(const String &prefix) const { return s.compare(0, prefix.s.length(), prefix.s) == 0; }
+  bool endsWith(const String &suffix) const;
+
+  int indexOf(char c, unsigned int from = 0) const;
+  int indexOf(const String &str, unsigned int from = 0) const;
+  String substring(unsigned int from) const { return substring(from, s.length()); }
+  String substring(unsigned int from, unsigned int to) const;
+  long toInt() const { return atol(s.c_str()); }
+  void toLowerCase();
+  void toUpperCase();
+  void trim();
+  void reserve(unsigned int size) { s.reserve(size); }
+
+  friend String operator+(const String &lhs, const String &rhs) { return String(lhs.s + rhs.s); }
+  friend String operator+(const String &lhs, const char *rhs) { return String(lhs.s + rhs); }
+  friend String operator+(const char *lhs, const String &rhs) { return String(lhs + rhs.s); }
+  friend String operator+(const String &lhs, char rhs) { return String(lhs.s + rhs); }
+  friend String operator+(const String &lhs, int rhs) { return String(lhs.s + std::to_string(rhs)); }
+  friend String operator+(const String &lhs, unsigned int rhs) { return String(lhs.s + std::to_string(rhs)); }
+
+private:
+  std::string s;
+};
+
+#endif
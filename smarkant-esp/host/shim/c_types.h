@@ -0,0 +1,12 @@
+/*
+ * This file is part of Smarkant project
+ *
+ * (C) 2017 Dirk Grappendorf, www.grappendorf.net
+ */
+
+#ifndef HOST_C_TYPES_H
+#define HOST_C_TYPES_H
+
+#define ICACHE_FLASH_ATTR
+
+#endif
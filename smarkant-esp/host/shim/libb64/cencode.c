@@ -0,0 +1,60 @@
+/*
+ * This file is part of Smarkant project
+ *
+ * (C) 2017 Dirk Grappendorf, www.grappendorf.net
+ */
+
+#include <stdint.h>
+#include "cencode_inc.h"
+
+static const char base64Characters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+void base64_init_encodestate(base64_encodestate *state_in) {
+  state_in->step = step_A;
+  state_in->result = 0;
+  state_in->stepcount = 0;
+}
+
+int base64_encode_block(const char *plaintext_in, int length_in, char *code_out, base64_encodestate *state_in) {
+  char *code = code_out;
+  for (int i = 0; i < length_in; ++i) {
+    uint8_t fragment = plaintext_in[i];
+    switch (state_in->step) {
+      case step_A:
+        *code++ = base64Characters[fragment >> 2];
+        state_in->result = (fragment & 0x03) << 4;
+        state_in->step = step_B;
+        break;
+      case step_B:
+        *code++ = base64Characters[state_in->result | (fragment >> 4)];
+        state_in->result = (fragment & 0x0f) << 2;
+        state_in->step = step_C;
+        break;
+      case step_C:
+        *code++ = base64Characters[state_in->result | (fragment >> 6)];
+        *code++ = base64Characters[fragment & 0x3f];
+        state_in->step = step_A;
+        break;
+    }
+  }
+  return code - code_out;
+}
+
+int base64_encode_blockend(char *code_out, base64_encodestate *state_in) {
+  char *code = code_out;
+  switch (state_in->step) {
+    case step_B:
+      *code++ = base64Characters[(uint8_t) state_in->result];
+      *code++ = '=';
+      *code++ = '=';
+      break;
+    case step_C:
+      *code++ = base64Characters[(uint8_t) state_in->result];
+      *code++ = '=';
+      break;
+    case step_A:
+      break;
+  }
+  *code = '\0';
+  return code - code_out;
+}
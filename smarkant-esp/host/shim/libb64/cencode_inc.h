@@ -0,0 +1,26 @@
+/*
+ * This file is part of Smarkant project
+ *
+ * (C) 2017 Dirk Grappendorf, www.grappendorf.net
+ *
+ * The libb64 encoder interface that the WebSocket library uses on boards without libb64.
+ */
+
+#ifndef HOST_CENCODE_INC_H
+#define HOST_CENCODE_INC_H
+
+typedef enum {
+  step_A, step_B, step_C
+} base64_encodestep;
+
+typedef struct {
+  base64_encodestep step;
+  char result;
+  int stepcount;
+} base64_encodestate;
+
+void base64_init_encodestate(base64_encodestate *state_in);
+int base64_encode_block(const char *plaintext_in, int length_in, char *code_out, base64_encodestate *state_in);
+int base64_encode_blockend(char *code_out, base64_encodestate *state_in);
+
+#endif
@@ -0,0 +1,24 @@
+/*
+ * This file is part of Smarkant project
+ *
+ * (C) 2017 Dirk Grappendorf, www.grappendorf.net
+ *
+ * Const correct declarations of the SHA-1 functions in ArduinoWebSockets/sha1.c.
+ */
+
+#ifndef HOST_LIBSHA1_H
+#define HOST_LIBSHA1_H
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t state[5];
+  uint32_t count[2];
+  unsigned char buffer[64];
+} SHA1_CTX;
+
+void SHA1Init(SHA1_CTX *context);
+void SHA1Update(SHA1_CTX *context, const unsigned char *data, uint32_t len);
+void SHA1Final(unsigned char digest[20], SHA1_CTX *context);
+
+#endif
@@ -181,10 +181,12 @@ char* AWSClient4::createRequest(MinimalString &reqPayload) {
     // set date and time
     // @TODO: find out why sprintf doesn't work
     const char* dateTime = dateTimeProvider->getDateTime();
-    strncpy(awsDate, dateTime, 8);
-    awsDate[9] = '\0';
-    strncpy(awsTime, dateTime + 8, 6);
-    awsTime[7] = '\0';
+    if (dateTime == 0)
+        return 0;
+    strncpy(awsDate, dateTime, AWS_DATE_LEN4);
+    awsDate[AWS_DATE_LEN4] = '\0';
+    strncpy(awsTime, dateTime + AWS_DATE_LEN4, AWS_TIME_LEN4);
+    awsTime[AWS_TIME_LEN4] = '\0';
 
     SHA256* sha256 = new SHA256();
     payloadHash = (*sha256)(reqPayload.getCStr(), reqPayload.length());
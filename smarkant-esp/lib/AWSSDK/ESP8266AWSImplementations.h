@@ -34,4 +34,28 @@ public:
     void sync(const char* dateTime);
 };
 
+/* DateTimeProvider backed by the SNTP client of the Esp8266 core. The system
+ * clock is kept in UTC by SNTP and advanced by the hardware timer in between,
+ * so reading the time needs no network round trip. */
+class Esp8266SntpDateTimeProvider: public IDateTimeProvider {
+    /* The time as a cstring in yyyyMMddHHmmss format. Is written to within and
+     * returned by getDateTime(). */
+    char dateTime[15];
+public:
+    Esp8266SntpDateTimeProvider();
+    /* Start the SNTP client. Must be called once after WiFi is up. */
+    void begin(const char* ntpServer1 = "pool.ntp.org",
+            const char* ntpServer2 = "time.nist.gov");
+    /* Returns true as soon as the clock has been set by SNTP or sync(). */
+    bool isSynced(void);
+    /* Retrieve the current GMT date and time in yyyyMMddHHmmss format. Returns
+     * null if the clock has not been synced yet. */
+    const char* getDateTime(void);
+    /* Returns true. sync() takes the time reported by an AWS service. */
+    bool syncTakesArg(void);
+    /* Sets the clock to the given GMT date and time in yyyyMMddHHmmss format.
+     * The next SNTP update continues from there. */
+    void sync(const char* dateTime);
+};
+
 #endif /* AWSESP2866IMPLEMENTATIONS_H_ */
@@ -5,6 +5,8 @@
 #include "DeviceIndependentInterfaces.h"
 #include <ESP8266WiFi.h>
 #include <string.h>
+#include <time.h>
+#include <sys/time.h>
 
 int delayTime = 500;
 char* updateCurTime(void);
@@ -72,6 +74,54 @@ void Esp8266DateTimeProvider::sync(const char* dateTime) {
   // should have no need for an implementation
 }
 
+/* Any earlier time means that the clock has not been set yet. */
+static const time_t SNTP_MIN_VALID_TIME = 1483228800; // 2017-01-01
+
+Esp8266SntpDateTimeProvider::Esp8266SntpDateTimeProvider() {
+    dateTime[0] = '\0';
+}
+
+void Esp8266SntpDateTimeProvider::begin(const char* ntpServer1, const char* ntpServer2) {
+    configTime(0, 0, ntpServer1, ntpServer2);
+}
+
+bool Esp8266SntpDateTimeProvider::isSynced(void) {
+    return time(NULL) >= SNTP_MIN_VALID_TIME;
+}
+
+const char* Esp8266SntpDateTimeProvider::getDateTime() {
+    time_t now = time(NULL);
+    if (now < SNTP_MIN_VALID_TIME) {
+        return NULL;
+    }
+    struct tm utc;
+    gmtime_r(&now, &utc);
+    snprintf(dateTime, sizeof(dateTime), "%04d%02d%02d%02d%02d%02d",
+            utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday,
+            utc.tm_hour, utc.tm_min, utc.tm_sec);
+    return dateTime;
+}
+
+bool Esp8266SntpDateTimeProvider::syncTakesArg(void) {
+    return true;
+}
+
+void Esp8266SntpDateTimeProvider::sync(const char* dateTime) {
+    struct tm utc;
+    memset(&utc, 0, sizeof(utc));
+    if (dateTime == NULL || sscanf(dateTime, "%4d%2d%2d%2d%2d%2d",
+            &utc.tm_year, &utc.tm_mon, &utc.tm_mday,
+            &utc.tm_hour, &utc.tm_min, &utc.tm_sec) != 6) {
+        return;
+    }
+    utc.tm_year -= 1900;
+    utc.tm_mon -= 1;
+    /* configTime(0, 0, ...) sets the time zone to UTC, so mktime does not
+     * apply an offset. */
+    struct timeval tv = { mktime(&utc), 0 };
+    settimeofday(&tv, NULL);
+}
+
 ////////////////////////////////////
 // convert month to digits
 ////////////////////////////////////
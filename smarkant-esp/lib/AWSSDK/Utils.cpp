@@ -389,3 +389,57 @@ char* hmacSha256(const char* key, int keyLen, const char* message,
     return final;
 }
 
+HmacSha256::HmacSha256() {
+}
+
+void HmacSha256::setKey(const void* key, size_t keyLen) {
+    /* The corrected key is BLOCK_SIZE long, longer keys are replaced by their
+     * hash. */
+    unsigned char correctedKey[BLOCK_SIZE];
+    memset(correctedKey, 0, BLOCK_SIZE);
+    if ((int) keyLen > BLOCK_SIZE) {
+        inner.reset();
+        inner.add(key, keyLen);
+        inner.getHashDec(correctedKey);
+    } else {
+        memcpy(correctedKey, key, keyLen);
+    }
+
+    unsigned char padded[BLOCK_SIZE];
+    for (int i = 0; i < BLOCK_SIZE; i++) {
+        padded[i] = correctedKey[i] ^ IPAD;
+    }
+    innerPadState.reset();
+    innerPadState.add(padded, BLOCK_SIZE);
+    for (int i = 0; i < BLOCK_SIZE; i++) {
+        padded[i] = correctedKey[i] ^ OPAD;
+    }
+    outerPadState.reset();
+    outerPadState.add(padded, BLOCK_SIZE);
+    memset(correctedKey, 0, BLOCK_SIZE);
+    memset(padded, 0, BLOCK_SIZE);
+    begin();
+}
+
+void HmacSha256::begin(void) {
+    inner = innerPadState;
+}
+
+void HmacSha256::add(const void* data, size_t numBytes) {
+    inner.add(data, numBytes);
+}
+
+void HmacSha256::finish(unsigned char* mac) {
+    unsigned char innerHash[SHA256_DEC_HASH_LEN];
+    inner.getHashDec(innerHash);
+    SHA256 outer = outerPadState;
+    outer.add(innerHash, SHA256_DEC_HASH_LEN);
+    outer.getHashDec(mac);
+}
+
+void HmacSha256::compute(const void* message, size_t messageLen,
+        unsigned char* mac) {
+    begin();
+    add(message, messageLen);
+    finish(mac);
+}
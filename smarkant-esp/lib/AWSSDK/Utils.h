@@ -12,6 +12,7 @@
 
 #include <stdint.h>
 #include "jsmn.h"
+#include "sha256.h"
 
 extern const int SHA256_DEC_HASH_LEN;
 
@@ -72,4 +73,29 @@ char* getTimeFromInvalidSignatureMessage(const char* message);
 char* hmacSha256(const char* key, int keyLen, const char* message,
         int messageLen);
 
+/* Hmac-sha256 with precomputed inner and outer pad states. The key is only
+ * padded and hashed once in setKey(), each message then costs the hash of the
+ * message plus two block compressions. */
+class HmacSha256 {
+public:
+    HmacSha256();
+    /* Set the key and precompute the pad states. */
+    void setKey(const void* key, size_t keyLen);
+    /* Start a new message. */
+    void begin(void);
+    /* Add a part of the message. */
+    void add(const void* data, size_t numBytes);
+    /* Write the SHA256_DEC_HASH_LEN bytes of the mac into the given buffer. */
+    void finish(unsigned char* mac);
+    /* Shorthand for begin(), add() and finish(). */
+    void compute(const void* message, size_t messageLen, unsigned char* mac);
+private:
+    /* State after hashing the inner padded key. */
+    SHA256 innerPadState;
+    /* State after hashing the outer padded key. */
+    SHA256 outerPadState;
+    /* State of the current message. */
+    SHA256 inner;
+};
+
 #endif /* UTILS_H_ */
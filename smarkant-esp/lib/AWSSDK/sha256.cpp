@@ -590,6 +590,29 @@ char* SHA256::getHashDec() {
     return hashBuffer;
 }
 
+/* This function added to original source. It is a modified version of
+ * getHashDec() from above that does not allocate the result. */
+/// write latest hash raw (not as hex) into a buffer of 32 bytes
+void SHA256::getHashDec(unsigned char* hash) {
+    // save old hash if buffer is partially filled
+    uint32_t oldHash[HashValues];
+    for (int i = 0; i < HashValues; i++)
+        oldHash[i] = m_hash[i];
+
+    // process remaining bytes
+    processBuffer();
+
+    size_t offset = 0;
+    for (int i = 0; i < HashValues; i++) {
+        hash[offset++] = (m_hash[i] >> 24) & 0xff;
+        hash[offset++] = (m_hash[i] >> 16) & 0xff;
+        hash[offset++] = (m_hash[i] >> 8) & 0xff;
+        hash[offset++] = m_hash[i] & 0xff;
+        // restore old hash
+        m_hash[i] = oldHash[i];
+    }
+}
+
 /// compute SHA256 of a memory block
 /* Modified from original source code. Using char* instead of string. */
 char* SHA256::operator()(const void* data, size_t numBytes) {
@@ -61,6 +61,9 @@ public:
     /* This function added to original source. */
     /// return latest hash raw (not as hex)
     char* getHashDec();
+    /* This function added to original source. */
+    /// write latest hash raw (not as hex) into a buffer of 32 bytes
+    void getHashDec(unsigned char* hash);
 
     /// restart
     void reset();
@@ -34,6 +34,7 @@ void AWSWebSocketClient::webSocketEvent(WStype_t type, uint8_t * payload, size_t
 AWSWebSocketClient::AWSWebSocketClient (unsigned int bufferSize) {
     useSSL = true;
     connectionTimeout = 5000; //5 seconds
+    connectStart = 0;
     AWSWebSocketClient:instance = this;
     onEvent(AWSWebSocketClient::webSocketEvent);
     awsRegion = NULL;
@@ -41,7 +42,17 @@ AWSWebSocketClient::AWSWebSocketClient (unsigned int bufferSize) {
     awsKeyID = NULL;
     awsDomain = NULL;
     path = NULL;
+    dateTimeProvider = NULL;
+    signingKeyDate[0] = '\0';
+#ifdef WEBSOCKETS_SSL_SESSION
+    sslSessionRTCOffset = -1;
+    sslSessionLoaded = false;
+    setSSLSession (&sslSession);
+#endif
 	_connected = false;	
+    frame = NULL;
+    frameLength = 0;
+    frameOffset = 0;
     bb.init (bufferSize); //1000 bytes of circular buffer... maybe it is too big
 }
 
@@ -60,186 +71,176 @@ AWSWebSocketClient::~AWSWebSocketClient(void) {
 }
 
 
-// convert month to digits
-String AWSWebSocketClient::getMonth(String sM) {
-  if(sM=="Jan") return "01";
-  if(sM=="Feb") return "02";
-  if(sM=="Mar") return "03";
-  if(sM=="Apr") return "04";
-  if(sM=="May") return "05";
-  if(sM=="Jun") return "06";
-  if(sM=="Jul") return "07";
-  if(sM=="Aug") return "08";
-  if(sM=="Sep") return "09";
-  if(sM=="Oct") return "10";
-  if(sM=="Nov") return "11";
-  if(sM=="Dec") return "12";
-  return "01";
+//get current time (UTC) from the date time provider (used to sign), NULL if the clock is not set yet
+const char* AWSWebSocketClient::getCurrentTime(void) {
+    if (dateTimeProvider == NULL)
+        return NULL;
+    return dateTimeProvider->getDateTime ();
 }
 
-//get current time (UTC) from aws service (used to sign)
-char* AWSWebSocketClient::getCurrentTime(void) {
+//bounded writer for the signed path, remembers if the buffer was too small
+struct AWSPathWriter {
+    char* buffer;
+    size_t size;
+    size_t length;
+    bool overflow;
 
-	
-    int timeout_busy = 0;
-
-    String GmtDate;
-    char* dateStamp = new char[15]();
-	strcpy (dateStamp,"19860618123600");	
-    
-    if (timeClient.connect("aws.amazon.com", 80)) {
-
-      // send a bad header on purpose, so we get a 400 with a DATE: timestamp
-      //Send Request
-      timeClient.println("GET example.com/ HTTP/1.1");
-      timeClient.println("Connection: close");
-      timeClient.println();
-
-      while((!timeClient.available()) && (timeout_busy++ < 5000)){
-        // Wait until the client sends some data
-        delay(1);
-      }
-
-      // kill client if timeout
-      if(timeout_busy >= 5000) {
-          timeClient.flush();
-          timeClient.stop();		  
-          DEBUG_WEBSOCKET_MQTT("timeout receiving timeserver data");
-		  
-          return dateStamp;
-      }
-
-      // read the http GET Response
-      String req2 = timeClient.readString();
-
-      // close connection
-      delay(1);
-      timeClient.flush();
-      timeClient.stop();
-	  
-
-      int ipos = req2.indexOf("Date:");
-      if(ipos > 0) {
-        String gmtDate = req2.substring(ipos, ipos + 35);
-        String utctime = gmtDate.substring(18,22) + getMonth(gmtDate.substring(14,17)) + gmtDate.substring(11,13) + gmtDate.substring(23,25) + gmtDate.substring(26,28) + gmtDate.substring(29,31);
-        utctime.substring(0, 14).toCharArray(dateStamp, 15);
-      }
+    AWSPathWriter (char* buffer, size_t size) : buffer(buffer), size(size), length(0), overflow(size == 0) {
+        if (size > 0)
+            buffer[0] = '\0';
     }
-    else {
-       DEBUG_WEBSOCKET_MQTT("did not connect to timeserver");
+
+    void append (const char* data, size_t len) {
+        if (overflow || length + len >= size) {
+            overflow = true;
+            return;
+        }
+        memcpy (buffer + length, data, len);
+        length += len;
+        buffer[length] = '\0';
     }
 
-   
-    timeout_busy=0;     // reset timeout
-	
-	
-    return dateStamp;   // Return latest or last good dateStamp
-}
+    void append (const char* str) {
+        append (str, strlen (str));
+    }
+};
 
-//generate AWS url path, signed using url parameters
-char* AWSWebSocketClient::generateAWSPath (uint16_t port) {
+//convert a raw hash to lower case hex (out must hold 2 * len + 1 chars)
+static void hashToHex (const unsigned char* hash, size_t len, char* out) {
+    static const char hexDigits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; ++i) {
+        out[2 * i] = hexDigits[hash[i] >> 4];
+        out[2 * i + 1] = hexDigits[hash[i] & 0x0f];
+    }
+    out[2 * len] = '\0';
+}
 
-	 
-    char* dateTime = getCurrentTime ();
-    char* awsService = "iotdevicegateway";
-    char* awsDate = new char[9]();
-    strncpy(awsDate, dateTime, 8);
+//generate AWS url path, signed using url parameters, into the given buffer (false if it is too small)
+//the canonical request and the string to sign are streamed into the hashes, so no heap memory is used
+bool AWSWebSocketClient::generateAWSPath (uint16_t port, char* path, size_t size) {
+    const char* dateTime = getCurrentTime ();
+    if (dateTime == NULL) {
+        DEBUG_WEBSOCKET_MQTT("[AWSc] current time unknown, can not sign\n");
+        return false;
+    }
+    const char* awsService = "iotdevicegateway";
+    const char* canonicalUri = "/mqtt";
+    const char* algorithm = "AWS4-HMAC-SHA256";
+    //sha256 of the empty payload
+    const char* payloadHash = "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855";
+    char awsDate[9];
+    memcpy (awsDate, dateTime, 8);
     awsDate[8] = '\0';
-    char* awsTime = new char[7]();
-    strncpy(awsTime, dateTime + 8, 6);
-    awsTime[6] = '\0';
-    delete[] dateTime;
-	char* credentialScope = new char[strlen(awsDate)+strlen(awsRegion)+strlen(awsService)+16]();
-	sprintf(credentialScope, "%s/%s/%s/aws4_request",awsDate,awsRegion,awsService);
-	String key_credential (awsKeyID);
-	key_credential+="/";
-	key_credential+=credentialScope;
-	//FIX tried a lot of escape functions, but no one was equal to escapeURL from javascript
-	key_credential.replace ("/","%2F");
-	const char* method = "GET";
-	const char* canonicalUri = "/mqtt";
-	const char* algorithm = "AWS4-HMAC-SHA256";
-
-	char* canonicalQuerystring = new char[strlen(algorithm)+strlen(key_credential.c_str())+strlen(awsDate)+strlen(awsTime)+200]();
-	sprintf(canonicalQuerystring, "%sX-Amz-Algorithm=%s", canonicalQuerystring,algorithm);
-	sprintf(canonicalQuerystring, "%s&X-Amz-Credential=%s", canonicalQuerystring,key_credential.c_str());
-	sprintf(canonicalQuerystring, "%s&X-Amz-Date=%sT%sZ", canonicalQuerystring, awsDate,awsTime);
-	sprintf(canonicalQuerystring, "%s&X-Amz-Expires=86400", canonicalQuerystring); //sign will last one day
-	sprintf(canonicalQuerystring, "%s&X-Amz-SignedHeaders=host", canonicalQuerystring);
-
-	String portString = String(port);
-	char* canonicalHeaders = new char[strlen (awsDomain)+ strlen (portString.c_str())+ 8]();
-
-	sprintf(canonicalHeaders, "%shost:%s:%s\n", canonicalHeaders,awsDomain,portString.c_str());
-	SHA256* sha256 = new SHA256();
-	char* payloadHash = (*sha256)("", 0);
-	delete sha256;
-	char* canonicalRequest = new char[strlen (method)+ strlen (canonicalUri)+strlen(canonicalQuerystring)+strlen(canonicalHeaders)+strlen(payloadHash)+10]();
-
-	sprintf(canonicalRequest, "%s%s\n%s\n%s\n%s\nhost\n%s", canonicalRequest,method,canonicalUri,canonicalQuerystring,canonicalHeaders,payloadHash);
-	delete[] payloadHash;
-	delete[] canonicalHeaders;
-
-
-	sha256 = new SHA256();
-	char* requestHash = (*sha256)(canonicalRequest, strlen (canonicalRequest));
-	delete sha256;
-	char* stringToSign = new char[strlen (algorithm)+ strlen(awsDate)+strlen (awsTime)+strlen(credentialScope)+strlen(requestHash)+6]();
-	sprintf(stringToSign, "%s%s\n%sT%sZ\n%s\n%s", stringToSign,algorithm,awsDate,awsTime,credentialScope,requestHash);
-	delete[] requestHash;
-	delete[] credentialScope;
-	delete[] canonicalRequest;	
-	delete[] awsTime;
-
-	/* Allocate memory for the signature */
-    char* signature = new char[HASH_HEX_LEN2 + 1]();
-
-    /* Create the signature key */
-    /* + 4 for "AWS4" */
-    int keyLen = strlen(awsSecKey) + 4;
-    char* key = new char[keyLen + 1]();
-    sprintf(key, "AWS4%s", awsSecKey);
-
-    char* k1 = hmacSha256(key, keyLen, awsDate, strlen(awsDate));
-	delete[] awsDate;
-    delete[] key;
-    char* k2 = hmacSha256(k1, SHA256_DEC_HASH_LEN, awsRegion,
-            strlen(awsRegion));
-
-    delete[] k1;
-    char* k3 = hmacSha256(k2, SHA256_DEC_HASH_LEN, awsService,
-            strlen(awsService));
-
-	delete[] k2;
-    char* k4 = hmacSha256(k3, SHA256_DEC_HASH_LEN, "aws4_request", 12);
-
-	delete[] k3;
-    char* k5 = hmacSha256(k4, SHA256_DEC_HASH_LEN, stringToSign, strlen(stringToSign));
-
-	delete[] k4;
-	delete[] stringToSign;
-    /* Convert the chars in hash to hex for signature. */
-    for (int i = 0; i < SHA256_DEC_HASH_LEN; ++i) {
-        sprintf(signature + 2 * i, "%02lx", 0xff & (unsigned long) k5[i]);
+    const char* awsTime = dateTime + 8;
+    char portString[6];
+    snprintf (portString, sizeof (portString), "%u", port);
+
+    //the query string is written to its final place in the path, the credential is url escaped
+    AWSPathWriter writer (path, size);
+    writer.append (canonicalUri);
+    writer.append ("?", 1);
+    size_t querystringStart = writer.length;
+    writer.append ("X-Amz-Algorithm=");
+    writer.append (algorithm);
+    writer.append ("&X-Amz-Credential=");
+    writer.append (awsKeyID);
+    writer.append ("%2F");
+    writer.append (awsDate, 8);
+    writer.append ("%2F");
+    writer.append (awsRegion);
+    writer.append ("%2F");
+    writer.append (awsService);
+    writer.append ("%2Faws4_request&X-Amz-Date=");
+    writer.append (awsDate, 8);
+    writer.append ("T", 1);
+    writer.append (awsTime, 6);
+    writer.append ("Z&X-Amz-Expires=86400&X-Amz-SignedHeaders=host"); //sign will last one day
+    if (writer.overflow) {
+        DEBUG_WEBSOCKET_MQTT("[AWSc] path buffer too small\n");
+        return false;
     }
-    delete[] k5;
-
-	sprintf(canonicalQuerystring, "%s&X-Amz-Signature=%s", canonicalQuerystring, signature);
-	delete[] signature;
 
-	char* requestUri = new char[strlen(canonicalUri)+strlen(canonicalQuerystring)+2]();
-	//sprintf(requestUri, "%swss://%s%s?%s", requestUri, awsDomain,canonicalUri,canonicalQuerystring);
-	sprintf(requestUri, "%s%s?%s", requestUri, canonicalUri,canonicalQuerystring);
-	delete[] canonicalQuerystring;
-
-	return requestUri;
+    //canonical request: method, uri, query string, headers, signed headers and payload hash
+    SHA256 sha256;
+    sha256.add ("GET\n", 4);
+    sha256.add (canonicalUri, strlen (canonicalUri));
+    sha256.add ("\n", 1);
+    sha256.add (path + querystringStart, writer.length - querystringStart);
+    sha256.add ("\nhost:", 6);
+    sha256.add (awsDomain, strlen (awsDomain));
+    sha256.add (":", 1);
+    sha256.add (portString, strlen (portString));
+    sha256.add ("\n\nhost\n", 7);
+    sha256.add (payloadHash, strlen (payloadHash));
+    unsigned char hash[SHA256_DEC_HASH_LEN];
+    sha256.getHashDec (hash);
+    char hashHex[2 * SHA256_DEC_HASH_LEN + 1];
+    hashToHex (hash, SHA256_DEC_HASH_LEN, hashHex);
+
+    /* The signing key only depends on the date, region, service and secret key, so it is
+     * derived once a day. Signing then only needs the precomputed hmac pad states. */
+    if (strcmp(signingKeyDate, awsDate) != 0)
+        deriveSigningKey(awsDate, awsService);
+
+    //string to sign: algorithm, timestamp, credential scope and hash of the canonical request
+    signingKey.begin ();
+    signingKey.add (algorithm, strlen (algorithm));
+    signingKey.add ("\n", 1);
+    signingKey.add (awsDate, 8);
+    signingKey.add ("T", 1);
+    signingKey.add (awsTime, 6);
+    signingKey.add ("Z\n", 2);
+    signingKey.add (awsDate, 8);
+    signingKey.add ("/", 1);
+    signingKey.add (awsRegion, strlen (awsRegion));
+    signingKey.add ("/", 1);
+    signingKey.add (awsService, strlen (awsService));
+    signingKey.add ("/aws4_request\n", 14);
+    signingKey.add (hashHex, 2 * SHA256_DEC_HASH_LEN);
+    signingKey.finish (hash);
+    hashToHex (hash, SHA256_DEC_HASH_LEN, hashHex);
+
+    writer.append ("&X-Amz-Signature=");
+    writer.append (hashHex, 2 * SHA256_DEC_HASH_LEN);
+    if (writer.overflow) {
+        DEBUG_WEBSOCKET_MQTT("[AWSc] path buffer too small\n");
+        return false;
+    }
+    return true;
+}
 
+//derive the sigv4 signing key of the given date and precompute its hmac states
+void AWSWebSocketClient::deriveSigningKey (const char* awsDate, const char* awsService) {
+    signingKeyDate[0] = '\0';
+    /* + 4 for "AWS4" */
+    char key[AWS_SECRET_KEY_MAX_LEN + 5];
+    int keyLen = snprintf(key, sizeof(key), "AWS4%s", awsSecKey);
+    if (keyLen >= (int) sizeof(key))
+        keyLen = sizeof(key) - 1;
+
+    HmacSha256 hmac;
+    unsigned char k[SHA256_DEC_HASH_LEN];
+    hmac.setKey(key, keyLen);
+    hmac.compute(awsDate, strlen(awsDate), k);
+    memset(key, 0, sizeof(key));
+    hmac.setKey(k, SHA256_DEC_HASH_LEN);
+    hmac.compute(awsRegion, strlen(awsRegion), k);
+    hmac.setKey(k, SHA256_DEC_HASH_LEN);
+    hmac.compute(awsService, strlen(awsService), k);
+    hmac.setKey(k, SHA256_DEC_HASH_LEN);
+    hmac.compute("aws4_request", 12, k);
+    signingKey.setKey(k, SHA256_DEC_HASH_LEN);
+    memset(k, 0, sizeof(k));
+
+    strncpy(signingKeyDate, awsDate, sizeof(signingKeyDate) - 1);
+    signingKeyDate[sizeof(signingKeyDate) - 1] = '\0';
 }
 
 AWSWebSocketClient& AWSWebSocketClient::setAWSRegion(const char * awsRegion) {
     int len = strlen(awsRegion) + 1;
     this->awsRegion = new char[len]();
     strcpy(this->awsRegion, awsRegion);
+    signingKeyDate[0] = '\0';
 	return *this;
 }
 
@@ -254,6 +255,7 @@ AWSWebSocketClient& AWSWebSocketClient::setAWSSecretKey(const char * awsSecKey)
     int len = strlen(awsSecKey) + 1;
     this->awsSecKey = new char[len]();
     strcpy(this->awsSecKey, awsSecKey);
+    signingKeyDate[0] = '\0';
 	return *this;
 }
 AWSWebSocketClient& AWSWebSocketClient::setAWSKeyID(const char * awsKeyID) {
@@ -263,6 +265,58 @@ AWSWebSocketClient& AWSWebSocketClient::setAWSKeyID(const char * awsKeyID) {
 	return *this;
 }
 
+AWSWebSocketClient& AWSWebSocketClient::setDateTimeProvider(IDateTimeProvider * dateTimeProvider) {
+    this->dateTimeProvider = dateTimeProvider;
+	return *this;
+}
+
+#ifdef WEBSOCKETS_SSL_SESSION
+//layout of the tls session copy in the rtc user memory
+struct AWSSSLSessionRTC {
+    uint32_t magic;
+    uint32_t checksum;
+    uint32_t session[(sizeof (BearSSL::Session) + 3) / 4];
+};
+
+static const uint32_t AWS_SSL_SESSION_RTC_MAGIC = 0x53534c31;
+
+static uint32_t sslSessionChecksum (const AWSSSLSessionRTC& data) {
+    uint32_t checksum = AWS_SSL_SESSION_RTC_MAGIC;
+    for (size_t i = 0; i < sizeof (data.session) / 4; ++i)
+        checksum = (checksum << 5) + (checksum >> 27) + data.session[i];
+    return checksum;
+}
+
+AWSWebSocketClient& AWSWebSocketClient::setSSLSessionRTCOffset (int offset) {
+    sslSessionRTCOffset = offset;
+    sslSessionLoaded = false;
+	return *this;
+}
+
+void AWSWebSocketClient::loadSSLSession () {
+    if (sslSessionRTCOffset < 0)
+        return;
+    AWSSSLSessionRTC data;
+    if (!ESP.rtcUserMemoryRead (sslSessionRTCOffset, (uint32_t*) &data, sizeof (data)))
+        return;
+    if (data.magic != AWS_SSL_SESSION_RTC_MAGIC || data.checksum != sslSessionChecksum (data))
+        return;
+    memcpy ((void*) &sslSession, data.session, sizeof (BearSSL::Session));
+    DEBUG_WEBSOCKET_MQTT("[AWSc] tls session restored from rtc memory\n");
+}
+
+void AWSWebSocketClient::saveSSLSession () {
+    if (sslSessionRTCOffset < 0)
+        return;
+    AWSSSLSessionRTC data;
+    memset (&data, 0, sizeof (data));
+    memcpy (data.session, (const void*) &sslSession, sizeof (BearSSL::Session));
+    data.magic = AWS_SSL_SESSION_RTC_MAGIC;
+    data.checksum = sslSessionChecksum (data);
+    ESP.rtcUserMemoryWrite (sslSessionRTCOffset, (uint32_t*) &data, sizeof (data));
+}
+#endif
+
 AWSWebSocketClient& AWSWebSocketClient::setPath(const char * path) {
     int len = strlen(path) + 1;
     this->path = new char[len]();
@@ -275,39 +329,116 @@ int AWSWebSocketClient::connect(IPAddress ip, uint16_t port){
 }
 
 int AWSWebSocketClient::connect(const char *host, uint16_t port) {
+	  if (beginConnect (host,port) == 0)
+		  return 0;
+	  int rc;
+	  while ( (rc = pollConnect ()) == 0) {
+		  delay (10);
+	  }
+	  return rc == 1 ? 1 : 0;
+}
+
+//sign the url and start the websocket handshake, the connection itself is established by pollConnect
+int AWSWebSocketClient::beginConnect(const char *host, uint16_t port) {
 	//make sure it is disconnect first
 	  const char* protocol = "mqtt";
-	  stop ();	
-	  char* path = this->path;
-	  //just need to free path if it was generated to connect to AWS
-	  bool freePath = false;
+	  stop ();
+	  char signedPath[AWS_PATH_MAX_LEN];
+	  const char* path = this->path;
 	  if (this->path == NULL) {
 		  //just generate AWS Path if user does not inform its own (to support the lib usage out of aws)
-		  path = generateAWSPath (port);
-		  freePath = true;
+		  if (!generateAWSPath (port, signedPath, sizeof (signedPath)))
+			  return 0;
+		  path = signedPath;
 	  }
+#ifdef WEBSOCKETS_SSL_SESSION
+	  if (!sslSessionLoaded) {
+		  loadSSLSession ();
+		  sslSessionLoaded = true;
+	  }
+#endif
+	  //the websocket layer keeps its own copy of the url
+#if (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266)
 	  if (useSSL == true)
 		  beginSSL (host,port,path,"",protocol);
 	  else
+#endif
 		  begin (host,port,path,protocol);
-	  long now = millis ();
-	  while ( (millis ()-now) < connectionTimeout) {
-		  loop ();		  
-		  if (connected () == 1) {		  
-			  if (freePath == true)
-				delete[] path;
-			  return 1;
-		  }
-		  delay (10);
+	  connectStart = millis ();
+	  return 1;
+}
+
+//advance the connection started by beginConnect one step (1 = connected, 0 = in progress, -1 = failed)
+int AWSWebSocketClient::pollConnect() {
+	  if (_connected) {
+#ifdef WEBSOCKETS_SSL_SESSION
+		  saveSSLSession ();
+#endif
+		  return 1;
+	  }
+	  if ((millis () - connectStart) >= (unsigned long) connectionTimeout) {
+		  DEBUG_WEBSOCKET_MQTT("[AWSc] Connection timeout\n");
+		  stop ();
+		  return -1;
+	  }
+	  //tcp and tls are established by the first loop call, which blocks for the dns lookup and the handshakes
+	  //(bounded by the timeouts of the network stack, not by connectionTimeout), all further calls read the upgrade response
+	  receive ();
+	  if (_connected) {
+#ifdef WEBSOCKETS_SSL_SESSION
+		  saveSSLSession ();
+#endif
+		  return 1;
+	  }
+	  if (_client.status == WSC_NOT_CONNECTED) {
+		  DEBUG_WEBSOCKET_MQTT("[AWSc] Connection failed\n");
+		  stop ();
+		  return -1;
 	  }
-	  if (freePath == true)
-		delete[] path;
 	  return 0;
 }
 
 //store messages arrived by websocket layer to be consumed by mqtt layer through the read funcion
+//while nothing else is pending the message is read in place, otherwise it is queued behind the pending bytes
 void AWSWebSocketClient::putMessage (byte* buffer, int length) {
-	bb.push (buffer,length);	
+	if (frameOffset < frameLength) {
+		//receive copies the unread rest before the websocket layer reads on, so it is gone here already
+		DEBUG_WEBSOCKET_MQTT("[AWSc] Message arrived before the last one was copied\n");
+		overflow ();
+		return;
+	}
+	if (bb.getSize () > 0) {
+		if (!bb.push (buffer,length))
+			overflow ();
+		return;
+	}
+	frame = buffer;
+	frameLength = length;
+	frameOffset = 0;
+}
+
+//let the websocket layer read the next message, it reuses the frame memory for it
+void AWSWebSocketClient::receive () {
+	if (flushFrame ())
+		loop ();
+}
+
+//move the unread rest of the current frame to the circular buffer (false if it didn't fit)
+bool AWSWebSocketClient::flushFrame () {
+	if (frameOffset < frameLength && !bb.push (frame + frameOffset, frameLength - frameOffset)) {
+		overflow ();
+		return false;
+	}
+	frame = NULL;
+	frameLength = 0;
+	frameOffset = 0;
+	return true;
+}
+
+//the mqtt stream can't be continued once bytes have been dropped, so the connection is closed
+void AWSWebSocketClient::overflow () {
+	DEBUG_WEBSOCKET_MQTT("[AWSc] Receive buffer overflow\n");
+	stop ();
 }
 
 size_t AWSWebSocketClient::write(uint8_t b) {
@@ -325,35 +456,86 @@ size_t AWSWebSocketClient::write(const uint8_t *buf, size_t size) {
   return 0;
 }
 
-//return with there is bytes to consume from the circular buffer (used by mqtt layer)
+int AWSWebSocketClient::writeHeadroom() {
+  return WEBSOCKETS_MAX_HEADER_SIZE;
+}
+
+//write through websocket layer as one frame without copying, the header goes into the headroom in front of buf
+size_t AWSWebSocketClient::writeInPlace(uint8_t *buf, size_t size) {
+  if (_connected == false)
+	  return -1;
+  if (sendBIN (buf - WEBSOCKETS_MAX_HEADER_SIZE,size,true))
+	  return size;
+  return 0;
+}
+
+//return with there is bytes to consume from the current frame or the circular buffer (used by mqtt layer)
 int AWSWebSocketClient::available(){
-  //force websocket to handle it messages
   if (_connected == false)
 	  return false;
-  loop ();
-  return bb.getSize ();
+  //force websocket to handle it messages, but only once the current frame is consumed: the next message
+  //would reuse its memory, and the frame stays readable in place by peekBuffer
+  if (frameOffset == frameLength)
+	  receive ();
+  return bb.getSize () + frameLength - frameOffset;
 }
 
-//read from circular buffer (used by mqtt layer)
+//read from the current frame or the circular buffer (used by mqtt layer)
 int AWSWebSocketClient::read() {
 	if (_connected == false)
 	  return -1;
+	if (frameOffset < frameLength)
+		return frame[frameOffset++];
 	return bb.pop ();
 }
 
-//read from circular buffer (used by mqtt layer)
+//read from the current frame or the circular buffer (used by mqtt layer)
 int AWSWebSocketClient::read(uint8_t *buf, size_t size) {
 	if (_connected == false)
 	  return -1;
-	int s = size;
-	if (bb.getSize()<s)
-		s = bb.getSize ();
-
-	bb.pop (buf,s);	
-	return s;
+	if (frameOffset < frameLength) {
+		if (size > frameLength - frameOffset)
+			size = frameLength - frameOffset;
+		memcpy (buf, frame + frameOffset, size);
+		frameOffset += size;
+		return size;
+	}
+	return bb.pop (buf,size);
 };
 
+//get the unread bytes of the current frame or the oldest contiguous bytes of the circular buffer
+//without copying them, reads the next frame if nothing is pending
+int AWSWebSocketClient::peekBuffer(unsigned char** buffer) {
+	if (_connected == false)
+	  return 0;
+	if (frameOffset == frameLength && bb.getSize () == 0)
+		receive ();
+	if (frameOffset == frameLength) {
+		long len;
+		*buffer = bb.readableSpan (&len);
+		return len;
+	}
+	*buffer = frame + frameOffset;
+	return frameLength - frameOffset;
+}
+
+//drop bytes returned by peekBuffer
+void AWSWebSocketClient::consume(int len) {
+	if (frameOffset == frameLength) {
+		bb.consume (len);
+		return;
+	}
+	frameOffset += len;
+	if (frameOffset >= frameLength) {
+		frame = NULL;
+		frameLength = 0;
+		frameOffset = 0;
+	}
+}
+
 int AWSWebSocketClient::peek() {
+	if (frameOffset < frameLength)
+		return frame[frameOffset];
 	return bb.peek ();
 }
 
@@ -366,6 +548,9 @@ void AWSWebSocketClient::stop() {
 		_connected = false;
 		bb.clear ();
 	}
+	frame = NULL;
+	frameLength = 0;
+	frameOffset = 0;
 	disconnect ();
 }
 
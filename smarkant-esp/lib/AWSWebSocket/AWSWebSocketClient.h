@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <Stream.h>
 #include "Client.h"
+#include "BufferedClient.h"
 #include "WebSocketsClient.h"
 #include "CircularByteBuffer.h"
 #include "sha256.h"
@@ -13,12 +14,17 @@
 
 //#define DEBUG_WEBSOCKET_MQTT(...) os_printf( __VA_ARGS__ )
 
+//longest supported aws secret access key
+#define AWS_SECRET_KEY_MAX_LEN 128
+//size of the buffer for the signed url path
+#define AWS_PATH_MAX_LEN 512
+
 #ifndef DEBUG_WEBSOCKET_MQTT
 #define DEBUG_WEBSOCKET_MQTT(...)
 #define NODEBUG_WEBSOCKET_MQTT
 #endif
 
-class AWSWebSocketClient : public Client, private WebSocketsClient {
+class AWSWebSocketClient : public BufferedClient, private WebSocketsClient {
 public:
 
   //bufferSize defines the size of the circular byte buffer that provides the interface between messages arrived in websocket layer and byte reads from mqtt layer	
@@ -30,12 +36,25 @@ public:
   int connect(IPAddress ip, uint16_t port);
   int connect(const char *host, uint16_t port);
 
+  //non blocking connect: beginConnect signs the url and starts the connection, pollConnect must then be
+  //called until it returns 1 (connected) or -1 (failed or timed out), 0 means the connection is in progress
+  //the first pollConnect still blocks: it resolves the host and opens the tcp and tls
+  //connection, which the esp8266 can only do synchronously, the later calls only read the upgrade response
+  int beginConnect(const char *host, uint16_t port);
+  int pollConnect();
+
   void putMessage (byte* buffer, int length);
   size_t write(uint8_t b);
   size_t write(const uint8_t *buf, size_t size);
+  //write a buffer with WEBSOCKETS_MAX_HEADER_SIZE bytes of headroom in front of it, the frame header is put there
+  int writeHeadroom();
+  size_t writeInPlace(uint8_t *buf, size_t size);
   int available();
   int read();
   int read(uint8_t *buf, size_t size);
+  //in place access to the received bytes (used by mqtt layer to parse packets without copying them)
+  int peekBuffer(unsigned char** buffer);
+  void consume(int len);
 
   int peek();
   void flush();
@@ -51,17 +70,34 @@ public:
   AWSWebSocketClient& setAWSSecretKey(const char * awsSecKey);
   AWSWebSocketClient& setAWSKeyID(const char * awsKeyID);  
   AWSWebSocketClient& setPath(const char * path);
+  //source of the current time (UTC) used to sign the connection url, must be set to connect to AWS
+  AWSWebSocketClient& setDateTimeProvider(IDateTimeProvider * dateTimeProvider);
+#ifdef WEBSOCKETS_SSL_SESSION
+  //keep the tls session also in the rtc user memory (offset in 4 byte blocks), so it survives a soft reset
+  AWSWebSocketClient& setSSLSessionRTCOffset (int offset);
+#endif
   
 
       
   protected:
-  //generate AWS signed path
-  char* generateAWSPath (uint16_t port);
+  //generate AWS signed path into the given buffer, false if the time is unknown or the buffer is too small
+  bool generateAWSPath (uint16_t port, char* path, size_t size);
+#ifdef WEBSOCKETS_SSL_SESSION
+  //copy the tls session from/to the rtc user memory
+  void loadSSLSession ();
+  void saveSSLSession ();
+#endif
+  //derive the signing key of the given date (yyyyMMdd)
+  void deriveSigningKey (const char* awsDate, const char* awsService);
   
-  //convert the month info
-  String getMonth(String sM);
-  //get current time (UTC) from aws service (used to sign)
-  char* getCurrentTime(void);
+  //run the websocket layer, after moving the unread rest of the current frame to the circular buffer
+  void receive ();
+  bool flushFrame ();
+  //close the connection after received bytes were dropped
+  void overflow ();
+
+  //get current time (UTC) from the date time provider (used to sign)
+  const char* getCurrentTime(void);
   
   //static instance of aws websocket client
   static AWSWebSocketClient* instance;
@@ -77,6 +113,8 @@ public:
 
   //connection timeout (but it seems it is not working as I've expected... many I should control it by the receipt of the connection message)
   long connectionTimeout;
+  //start time of the connection attempt
+  unsigned long connectStart;
 
   char* path;
   /* Name of region, eg. "us-east-1" in "kinesis.us-east-1.amazonaws.com". */
@@ -88,11 +126,30 @@ public:
   /* The user's AWS Access Key ID for accessing the AWS Resource. */
   char* awsKeyID;
 
-  //circular buffer to keep incoming messages from websocket
+  //circular buffer to keep incoming messages from websocket (only used for data that can't be read in place)
   CircularByteBuffer bb;
+  //last message from websocket, read in place while the circular buffer is empty
+  //(the websocket layer owns it, it stays valid until the next message is read by loop)
+  uint8_t* frame;
+  size_t frameLength;
+  size_t frameOffset;
   
-  //connection to get current time
-  WiFiClient timeClient;
+  //provides the current time to sign the connection url
+  IDateTimeProvider* dateTimeProvider;
+
+  //sigv4 signing key of signingKeyDate, with precomputed hmac states
+  HmacSha256 signingKey;
+  //date (yyyyMMdd) the signing key was derived for, empty if there is no key
+  char signingKeyDate[9];
+
+#ifdef WEBSOCKETS_SSL_SESSION
+  //tls session resumed by the next connection
+  BearSSL::Session sslSession;
+  //offset of the session copy in the rtc user memory, -1 to keep it only in ram
+  int sslSessionRTCOffset;
+  //true after the rtc copy has been read
+  bool sslSessionLoaded;
+#endif
 };
 
 #endif
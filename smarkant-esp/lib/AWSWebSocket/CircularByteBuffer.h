@@ -8,116 +8,186 @@
 #define NODEBUG_CBB
 #endif
 
+//bip buffer: the data is kept in up to two regions, A (the oldest bytes) and B at the start of
+//the memory (filled once A has reached its end). regions never wrap around, so the bytes can be
+//written and read in place through the span functions instead of byte by byte
 class CircularByteBuffer {
 public:
 
 	CircularByteBuffer () {
 		data = NULL;
-		size = 0;
 		capacity = 0;
+		clear ();
 	}
 	~CircularByteBuffer(){
 		if (data!=NULL)
 			free (data);
 	}
-	
+
 	void clear ()
 	{
-		size = 0;
-		begin = 0;
-		end = 0;
+		aStart = 0;
+		aEnd = 0;
+		bEnd = 0;
+		bActive = false;
+		reserveB = false;
 	}
-	
+
 	void deallocate () {
 		if (data!=NULL) {
 			free (data);
 			data = NULL;
 		}
+		capacity = 0;
+		clear ();
 	}
 
 	void init (long capacity) {
 		if (data!=NULL)
 			free (data);
 		data = (byte*) malloc (capacity);
-		size = 0;
-		begin = 0;
-		end = 0;
-		this->capacity = capacity;
+		this->capacity = (data != NULL) ? capacity : 0;
+		clear ();
 	}
 
 	long getSize () {
-		return size;
+		return (aEnd - aStart) + bEnd;
 	}
 
-	byte peek () {
-		return data[begin];
+	long getCapacity () {
+		return capacity;
 	}
-	void push (byte b) {
-		if (size+1 == capacity) {
-			DEBUG_CBB ("buffer full");
+
+	//number of bytes that can be pushed (possibly split into two spans)
+	long getFree () {
+		if (bActive)
+			return aStart - bEnd;
+		return (capacity - aEnd) + aStart;
+	}
+
+	//largest contiguous free space (can be less than getFree), the bytes written there are added by commit
+	byte* writableSpan (long* len) {
+		if (bActive || (capacity - aEnd) < aStart) {
+			reserveB = true;
+			*len = aStart - bEnd;
+			return &data[bEnd];
+		}
+		reserveB = false;
+		*len = capacity - aEnd;
+		return &data[aEnd];
+	}
+
+	//add len bytes written to the last writable span
+	void commit (long len) {
+		if (len <= 0)
 			return;
+		if (reserveB) {
+			bEnd += len;
+			bActive = true;
+		} else {
+			aEnd += len;
 		}
-		data[end] = b;
-		end = (end+1) % capacity;
-		size += 1;
+	}
 
+	//oldest contiguous bytes, dropped by consume once they are processed
+	byte* readableSpan (long* len) {
+		*len = aEnd - aStart;
+		return &data[aStart];
+	}
+
+	//drop len bytes of the readable span (at most the whole span)
+	void consume (long len) {
+		if (len <= 0)
+			return;
+		if (len > aEnd - aStart) {
+			DEBUG_CBB ("consume beyond the readable span");
+			len = aEnd - aStart;
+		}
+		aStart += len;
+		if (aStart < aEnd)
+			return;
+		//region A is empty, region B (if any) becomes region A
+		aStart = 0;
+		aEnd = bEnd;
+		bEnd = 0;
+		bActive = false;
+	}
+
+	byte peek () {
+		if (aStart == aEnd) {
+			DEBUG_CBB ("buffer empty");
+			return 0;
+		}
+		return data[aStart];
+	}
+
+	bool push (byte b) {
+		return push (&b, 1);
 	}
 
 	byte pop () {
-		if (size == 0){
+		if (aStart == aEnd) {
 			DEBUG_CBB ("buffer empty");
 			return 0;
 		}
-		byte ret = data[begin];
-		begin = (begin+1) % capacity;
-		size -= 1;
+		byte ret = data[aStart];
+		consume (1);
 		return ret;
-
 	}
 
-	void push (byte* b, long len){
-		if (size+len >= capacity) {
+	//append len bytes, false (and nothing is written) if they don't fit
+	bool push (const byte* b, long len){
+		if (len > getFree ()) {
 			DEBUG_CBB ("buffer full");
-			return;
+			return false;
 		}
-		if ( (end + len)  <= capacity ) {
-			memcpy ((void*)&data[end],b,len);
-			end += len;
-		} else {
-			long endSide = capacity - end;
-			memcpy ((void*)&data[end],b,endSide);
-			end = 0;
-			memcpy ((void*)&data[end],b+endSide,len-endSide);
-			end += len-endSide;
+		while (len > 0) {
+			long spanLen;
+			byte* span;
+			if (!bActive && aEnd < capacity) {
+				//fill the end of A before B, so all free bytes can be used
+				reserveB = false;
+				spanLen = capacity - aEnd;
+				span = &data[aEnd];
+			} else {
+				span = writableSpan (&spanLen);
+			}
+			if (spanLen > len)
+				spanLen = len;
+			memcpy (span, b, spanLen);
+			commit (spanLen);
+			b += spanLen;
+			len -= spanLen;
 		}
-		size += len;
-
+		return true;
 	}
 
-	byte* pop (byte* b, long len){
-		if ( (size - len) < 0 ) {
-			DEBUG_CBB ("buffer empty");
-			return NULL;
-		}
-		if ( (begin + len)  <= capacity ) {
-			memcpy (b,(void*)&data[begin],len);
-			begin += len;
-		} else {
-			long endSide = capacity - begin;
-			memcpy (b,(void*)&data[begin],endSide);
-			begin = 0;
-			memcpy (b+endSide,(void*)&data[begin],len-endSide);
-			begin += len-endSide;
+	//take up to len bytes, returns the number of bytes copied to b
+	long pop (byte* b, long len){
+		long total = 0;
+		while (total < len && aStart < aEnd) {
+			long spanLen;
+			byte* span = readableSpan (&spanLen);
+			if (spanLen > len - total)
+				spanLen = len - total;
+			memcpy (b + total, span, spanLen);
+			consume (spanLen);
+			total += spanLen;
 		}
-		size -= len;
+		return total;
 	}
 
 private:
 	byte* data;
 	long capacity;
-	long size;
-	long begin;
-	long end;
+	//region A [aStart, aEnd) and region B [0, bEnd)
+	long aStart;
+	long aEnd;
+	long bEnd;
+	//B is in use, new bytes go behind it until A is consumed
+	bool bActive;
+	//the last writable span is in region B
+	bool reserveB;
 };
 
 
@@ -0,0 +1,319 @@
+// Copyright Benoit Blanchon 2014-2017
+// MIT License
+//
+// Arduino JSON library
+// https://github.com/bblanchon/ArduinoJson
+// If you like this project, please add a star!
+
+// Measures the parser and the serializer on each document of the command line,
+// and compares the results with a baseline.
+//
+// Usage: arduinojson_benchmark [--quick] [--update] [--tolerance RATIO]
+//                              --baseline FILE DOCUMENT...
+//
+// The memory (JsonBuffer bytes, nodes and peak heap) fails the run as soon as
+// it exceeds the baseline. The throughput fails the run when it is below the
+// baseline by more than the tolerance (0.3 by default); it depends on the
+// machine, so --quick doesn't compare it.
+// --update writes the results in the baseline file instead.
+
+#include <ArduinoJson.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// the heap used by the blocks of the JsonBuffer
+size_t heapSize = 0;
+size_t heapPeak = 0;
+
+class TrackingAllocator {
+  union Header {
+    size_t size;
+    double alignment;
+  };
+
+ public:
+  void* allocate(size_t size) {
+    Header* header = static_cast<Header*>(malloc(sizeof(Header) + size));
+    if (!header) return NULL;
+    header->size = size;
+    heapSize += size;
+    if (heapSize > heapPeak) heapPeak = heapSize;
+    return header + 1;
+  }
+
+  void deallocate(void* pointer) {
+    if (!pointer) return;
+    Header* header = static_cast<Header*>(pointer) - 1;
+    heapSize -= header->size;
+    free(header);
+  }
+};
+
+typedef DynamicJsonBufferBase<TrackingAllocator> TrackingJsonBuffer;
+
+enum Kind {
+  // higher is better, compared with the tolerance
+  THROUGHPUT,
+  // lower is better, any increase is a regression
+  MEMORY
+};
+
+struct Result {
+  std::string document;
+  const char* metric;
+  double value;
+  Kind kind;
+};
+
+struct Options {
+  Options() : quick(false), update(false), tolerance(0.3), baseline(NULL) {}
+
+  bool quick;
+  bool update;
+  double tolerance;
+  const char* baseline;
+  std::vector<const char*> documents;
+};
+
+bool readFile(const char* path, std::string& content) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return false;
+  std::ostringstream stream;
+  stream << file.rdbuf();
+  content = stream.str();
+  return true;
+}
+
+std::string baseName(const char* path) {
+  const char* name = strrchr(path, '/');
+  return name ? name + 1 : path;
+}
+
+// the members of the objects and the elements of the arrays, which are the
+// nodes that the JsonBuffer allocated
+size_t countNodes(JsonVariant value) {
+  size_t count = 0;
+  if (value.is<JsonArray>()) {
+    JsonArray& array = value.as<JsonArray>();
+    for (JsonArray::iterator it = array.begin(); it != array.end(); ++it)
+      count += 1 + countNodes(*it);
+  } else if (value.is<JsonObject>()) {
+    JsonObject& object = value.as<JsonObject>();
+    for (JsonObject::iterator it = object.begin(); it != object.end(); ++it)
+      count += 1 + countNodes(it->value);
+  }
+  return count;
+}
+
+// MB/s of the best of five rounds, so that a preempted round doesn't count
+template <typename TFunction>
+double throughput(size_t bytes, long iterations, TFunction function) {
+  double best = 0;
+  for (int round = 0; round < 5; round++) {
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; i++) function();
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    double rate = seconds > 0 ? bytes * iterations / seconds / 1e6 : 0;
+    if (rate > best) best = rate;
+  }
+  return best;
+}
+
+bool measure(const char* path, const Options& options,
+             std::vector<Result>& results) {
+  std::string json;
+  if (!readFile(path, json)) {
+    printf("%s: cannot read the file\n", path);
+    return false;
+  }
+  std::string name = baseName(path);
+
+  // the memory of a first parse, in a new JsonBuffer
+  heapPeak = heapSize;
+  size_t heapBefore = heapSize;
+  TrackingJsonBuffer jsonBuffer;
+  JsonVariant root = jsonBuffer.parse(json.c_str());
+  if (!root.success()) {
+    printf("%s: parsing failed\n", path);
+    return false;
+  }
+  size_t bufferBytes = jsonBuffer.size();
+  size_t peak = heapPeak - heapBefore;
+  size_t nodes = countNodes(root);
+
+  // the output reads back as the same document
+  std::string output;
+  root.printTo(output);
+  DynamicJsonBuffer checkBuffer;
+  std::string reprinted;
+  checkBuffer.parse(output.c_str()).printTo(reprinted);
+  if (reprinted != output) {
+    printf("%s: the output doesn't read back\n", path);
+    return false;
+  }
+
+  // enough iterations for 1 MB, or 20 MB, per round
+  long target = options.quick ? 1000000L : 20000000L;
+  long iterations = target / static_cast<long>(json.size()) + 1;
+
+  TrackingJsonBuffer parseBuffer;
+  const char* input = json.c_str();
+  double parseRate = throughput(json.size(), iterations, [&]() {
+    parseBuffer.reset();
+    parseBuffer.parse(input);
+  });
+
+  std::vector<char> printBuffer(output.size() + 1);
+  size_t outputSize = output.size();
+  long printIterations = target / static_cast<long>(outputSize + 1) + 1;
+  double serializeRate = throughput(outputSize, printIterations, [&]() {
+    root.printTo(&printBuffer[0], printBuffer.size());
+  });
+
+  Result measured[] = {
+      {name, "parse", parseRate, THROUGHPUT},
+      {name, "serialize", serializeRate, THROUGHPUT},
+      {name, "buffer_bytes", static_cast<double>(bufferBytes), MEMORY},
+      {name, "nodes", static_cast<double>(nodes), MEMORY},
+      {name, "peak_heap_bytes", static_cast<double>(peak), MEMORY}};
+  results.insert(results.end(), measured,
+                 measured + sizeof(measured) / sizeof(measured[0]));
+  return true;
+}
+
+std::string baselineKey(const std::string& document, const char* metric) {
+  return document + " " + metric;
+}
+
+// lines of "document metric value", '#' starts a comment
+std::map<std::string, double> readBaseline(const char* path) {
+  std::map<std::string, double> baseline;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    std::istringstream fields(line);
+    std::string document, metric;
+    double value;
+    if (fields >> document >> metric >> value)
+      baseline[baselineKey(document, metric.c_str())] = value;
+  }
+  return baseline;
+}
+
+bool writeBaseline(const char* path, const std::vector<Result>& results) {
+  FILE* file = fopen(path, "w");
+  if (!file) return false;
+  fprintf(file,
+          "# written by arduinojson_benchmark --update\n"
+          "# parse and serialize in MB/s, they depend on the machine\n");
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result& result = results[i];
+    fprintf(file, "%s %s %.*f\n", result.document.c_str(), result.metric,
+            result.kind == THROUGHPUT ? 1 : 0, result.value);
+  }
+  return fclose(file) == 0;
+}
+
+// Prints each result with its baseline.
+// Returns the number of regressions.
+int compare(const std::vector<Result>& results,
+            const std::map<std::string, double>& baseline,
+            const Options& options) {
+  int regressions = 0;
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result& result = results[i];
+    const char* unit = result.kind == THROUGHPUT ? "MB/s" : "";
+    printf("%-24s %-16s %10.1f %-4s", result.document.c_str(), result.metric,
+           result.value, unit);
+
+    std::map<std::string, double>::const_iterator expected =
+        baseline.find(baselineKey(result.document, result.metric));
+    if (expected == baseline.end()) {
+      printf("  no baseline\n");
+      continue;
+    }
+    double reference = expected->second;
+    printf("  baseline %10.1f", reference);
+
+    bool regressed;
+    if (result.kind == MEMORY)
+      regressed = result.value > reference;
+    else
+      regressed = !options.quick &&
+                  result.value < reference * (1 - options.tolerance);
+    if (regressed) regressions++;
+    printf("%s\n", regressed ? "  REGRESSION" : "");
+  }
+  return regressions;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--quick")) {
+      options.quick = true;
+    } else if (!strcmp(argv[i], "--update")) {
+      options.update = true;
+    } else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) {
+      options.tolerance = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--baseline") && i + 1 < argc) {
+      options.baseline = argv[++i];
+    } else if (argv[i][0] == '-') {
+      return false;
+    } else {
+      options.documents.push_back(argv[i]);
+    }
+  }
+  return options.baseline && !options.documents.empty();
+}
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printf(
+        "Usage: %s [--quick] [--update] [--tolerance RATIO] "
+        "--baseline FILE DOCUMENT...\n",
+        argv[0]);
+    return 2;
+  }
+
+  std::vector<Result> results;
+  for (size_t i = 0; i < options.documents.size(); i++) {
+    if (!measure(options.documents[i], options, results)) return 1;
+  }
+
+  if (options.update) {
+    if (options.quick) {
+      printf("--update needs the throughput of a full run\n");
+      return 2;
+    }
+    compare(results, std::map<std::string, double>(), options);
+    if (!writeBaseline(options.baseline, results)) {
+      printf("%s: cannot write the baseline\n", options.baseline);
+      return 1;
+    }
+    printf("baseline written to %s\n", options.baseline);
+    return 0;
+  }
+
+  int regressions = compare(results, readBaseline(options.baseline), options);
+  if (regressions > 0) {
+    printf("%d regressions\n", regressions);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,625 @@
+// Copyright Benoit Blanchon 2014-2017
+// MIT License
+//
+// Arduino JSON library
+// https://github.com/bblanchon/ArduinoJson
+// If you like this project, please add a star!
+
+// Checks the behavior that the benchmark relies on: the filter, the bounded
+// and in place parsing, the blocks of the DynamicJsonBuffer, JsonStruct,
+// MessagePack and the strings scanned a word at a time.
+//
+// Usage: arduinojson_check DOCUMENT...
+//
+// The documents of the command line are parsed in every way, along with some
+// built here. The CMake file also builds it with AddressSanitizer, which
+// catches a parser that reads or writes past a payload.
+
+#include <ArduinoJson.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../fuzzing/CharByCharReader.hpp"
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                            \
+  do {                                                              \
+    if (!(condition)) {                                             \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__,       \
+             #condition);                                           \
+      failures++;                                                   \
+    }                                                               \
+  } while (0)
+
+// counts the blocks of a DynamicJsonBuffer, and fails after
+// allocationsBeforeFailure of them
+long allocations = 0;
+long allocationsBeforeFailure = -1;
+
+class CountingAllocator {
+ public:
+  void* allocate(size_t size) {
+    if (allocationsBeforeFailure == 0) return NULL;
+    allocationsBeforeFailure--;
+    allocations++;
+    return malloc(size);
+  }
+
+  void deallocate(void* pointer) {
+    free(pointer);
+  }
+};
+
+typedef DynamicJsonBufferBase<CountingAllocator> CountingJsonBuffer;
+
+const char* const SHADOW_DELTA_PATHS[] = {"state.move", "state.position",
+                                          "state.height"};
+
+bool readFile(const char* path, std::string& content) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return false;
+  std::ostringstream stream;
+  stream << file.rdbuf();
+  content = stream.str();
+  return true;
+}
+
+// a delta like the shadow service sends it, with the move and some more
+// desired fields
+std::string makeShadowDelta(size_t extraFields) {
+  std::string json =
+      "{\"version\":42,\"timestamp\":1496318400,\"state\":{\"move\":"
+      "\"height\",\"height\":1200";
+  std::string metadata =
+      "\"metadata\":{\"move\":{\"timestamp\":1496318400},\"height\":{"
+      "\"timestamp\":1496318400}";
+  for (size_t i = 0; i < extraFields; i++) {
+    char field[96];
+    sprintf(field, ",\"field%u\":%u", (unsigned)i, (unsigned)i);
+    json += field;
+    sprintf(field, ",\"field%u\":{\"timestamp\":1496318400}", (unsigned)i);
+    metadata += field;
+  }
+  return json + "}," + metadata + "}}";
+}
+
+// a document with strings that don't fit in the first blocks
+std::string makeLongStrings(size_t length) {
+  return "{\"short\":\"abc\",\"long\":\"" + std::string(length, 'x') +
+         "\",\"escaped\":\"" + std::string(length / 2, 'y') + "\\n\"}";
+}
+
+template <typename TPrintable>
+std::string printed(const TPrintable& value) {
+  std::string json;
+  value.printTo(json);
+  return json;
+}
+
+template <typename TPrintable>
+std::string msgPack(const TPrintable& value) {
+  std::vector<char> buffer(value.measureMsgPackLength() + 1);
+  size_t length = value.printMsgPackTo(&buffer[0], buffer.size());
+  return std::string(&buffer[0], length);
+}
+
+// the MessagePack of a JSON text, as hexadecimal bytes
+std::string msgPackHex(const char* json) {
+  DynamicJsonBuffer jsonBuffer;
+  std::string bytes = msgPack(jsonBuffer.parse(json));
+  std::string hex;
+  for (size_t i = 0; i < bytes.size(); i++) {
+    char byte[4];
+    sprintf(byte, i ? " %02x" : "%02x", (unsigned)(uint8_t)bytes[i]);
+    hex += byte;
+  }
+  return hex;
+}
+
+bool parsesMsgPack(const std::string& bytes,
+                   uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+  DynamicJsonBuffer jsonBuffer;
+  return jsonBuffer.parseMsgPack(bytes.data(), bytes.size(), nestingLimit)
+      .success();
+}
+
+// the fields of the shadow messages of Smarkant
+struct MoveJson {
+  char move[10];
+  bool hasMove;
+  int height;
+  bool hasHeight;
+  int position;
+  bool hasPosition;
+
+  template <typename TFields>
+  static void jsonFields(TFields& fields) {
+    fields("move", &MoveJson::move, &MoveJson::hasMove);
+    fields("height", &MoveJson::height, &MoveJson::hasHeight);
+    fields("position", &MoveJson::position, &MoveJson::hasPosition);
+  }
+};
+
+struct ShadowDeltaJson {
+  MoveJson state;
+  uint32_t version;
+
+  template <typename TFields>
+  static void jsonFields(TFields& fields) {
+    fields("state", &ShadowDeltaJson::state);
+    fields("version", &ShadowDeltaJson::version);
+  }
+};
+
+struct ShadowUpdateJson {
+  const char* desired;
+  MoveJson reported;
+
+  template <typename TFields>
+  static void jsonFields(TFields& fields) {
+    fields("desired", &ShadowUpdateJson::desired);
+    fields("reported", &ShadowUpdateJson::reported);
+  }
+};
+
+// one field of each type
+struct TelemetryJson {
+  bool moving;
+  char name[8];
+  int8_t tilt;
+  uint16_t height;
+  long uptime;
+  unsigned long energy;
+  float temperature;
+  double current;
+
+  template <typename TFields>
+  static void jsonFields(TFields& fields) {
+    fields("moving", &TelemetryJson::moving);
+    fields("name", &TelemetryJson::name);
+    fields("tilt", &TelemetryJson::tilt);
+    fields("height", &TelemetryJson::height);
+    fields("uptime", &TelemetryJson::uptime);
+    fields("energy", &TelemetryJson::energy);
+    fields("temperature", &TelemetryJson::temperature);
+    fields("current", &TelemetryJson::current);
+  }
+};
+
+void checkFilter() {
+  DynamicJsonBuffer jsonBuffer;
+  const JsonFilter shadowDeltaFilter(SHADOW_DELTA_PATHS);
+  JsonObject& delta =
+      jsonBuffer.parseObject(makeShadowDelta(2), shadowDeltaFilter);
+  CHECK(delta.success());
+  CHECK(delta.size() == 1);
+  JsonObject& state = delta["state"];
+  CHECK(state.size() == 2);
+  CHECK(state["move"] == std::string("height"));
+  CHECK(state["height"] == 1200);
+
+  // wildcards, arrays, comments, values in place and nested values that are
+  // skipped
+  const char* const paths[] = {"sensors.*.value", "name",
+                               "metadata.*.timestamp"};
+  char json[] =
+      "{\"sensors\":[{\"value\":1,\"unit\":\"mm\"},{\"unit\":[1,{\"x\":\"}"
+      "\\\"\"}],\"value\":2},3],/* comment */\"name\":'desk',\"other\":{"
+      "\"name\":3},\"metadata\":{\"a\":{\"timestamp\":5,\"b\":6}}}";
+  JsonObject& root = jsonBuffer.parseObject(json, JsonFilter(paths));
+  CHECK(root.success());
+  CHECK(root.size() == 3);
+  JsonArray& sensors = root["sensors"];
+  CHECK(sensors.size() == 2);
+  CHECK(sensors[0]["value"] == 1);
+  CHECK(sensors[0].as<JsonObject&>().size() == 1);
+  CHECK(sensors[1]["value"] == 2);
+  CHECK(root["name"] == std::string("desk"));
+  CHECK(root["metadata"]["a"]["timestamp"] == 5);
+  CHECK(root["metadata"]["a"].as<JsonObject&>().size() == 1);
+
+  // an error in a skipped value is still an error
+  CHECK(!jsonBuffer.parseObject("{\"metadata\":{\"a\" 1}}", shadowDeltaFilter)
+             .success());
+  CHECK(!jsonBuffer.parseObject("{\"metadata\":[1,2}", shadowDeltaFilter)
+             .success());
+}
+
+// a payload like the MQTT client gives it, without a terminating zero,
+// followed by bytes that must be neither read nor written
+void checkBoundedParse() {
+  const char* tail = "\"garbage\"}]";
+  std::string delta = makeShadowDelta(2);
+  std::string received = delta + tail;
+  std::vector<char> payload(received.begin(), received.end());
+  DynamicJsonBuffer jsonBuffer;
+  JsonObject& root = jsonBuffer.parseObjectN(&payload[0], delta.size(),
+                                             JsonFilter(SHADOW_DELTA_PATHS));
+  CHECK(root.success());
+  CHECK(root["state"]["height"] == 1200);
+  const char* move = root["state"]["move"];
+  CHECK(move != NULL && strcmp(move, "height") == 0);
+  CHECK(move >= &payload[0] && move < &payload[0] + delta.size());
+  CHECK(std::string(&payload[delta.size()], payload.size() - delta.size()) ==
+        tail);
+
+  // unsigned chars, and const chars that are copied
+  std::vector<uint8_t> bytes(delta.begin(), delta.end());
+  CHECK(jsonBuffer.parseObjectN(&bytes[0], bytes.size())["version"] == 42);
+  const char* array = "[1,\"two\",3]garbage";
+  JsonArray& values = jsonBuffer.parseArrayN(array, 11);
+  CHECK(values.size() == 3);
+  CHECK(values[1] == std::string("two"));
+  CHECK(values[1].as<const char*>() != array + 4);
+
+  // a payload that ends in the middle of the document
+  const char* truncated[] = {"{\"a\":12", "{\"a\":\"x", "{\"a\"",
+                             "{",         "[1,",       "/* x"};
+  for (size_t i = 0; i < sizeof(truncated) / sizeof(truncated[0]); i++) {
+    std::string bounded = std::string(truncated[i]) + "}]\"";
+    std::vector<char> copy(bounded.begin(), bounded.end());
+    size_t length = strlen(truncated[i]);
+    CHECK(!jsonBuffer.parseObjectN(&copy[0], length).success());
+    CHECK(!jsonBuffer.parseArrayN(&copy[0], length).success() ||
+          copy[0] == '[');
+    CHECK(std::string(&copy[length], 3) == "}]\"");
+  }
+  CHECK(!jsonBuffer.parseObjectN((char*)NULL, 0).success());
+
+  // any integer is a length for parseObjectN(), and the nesting limit for
+  // parseObject()
+  std::vector<char> intPayload(received.begin(), received.end());
+  int intLength = static_cast<int>(delta.size());
+  CHECK(jsonBuffer.parseObjectN(&intPayload[0], intLength)["version"] == 42);
+  CHECK(std::string(&intPayload[delta.size()], strlen(tail)) == tail);
+  CHECK(!jsonBuffer.parseObject("{\"a\":{\"b\":1}}", 1).success());
+
+  // a value at the root that is neither an object nor an array, in a buffer
+  // without room for a terminating zero
+  const char* roots[] = {"123", "true", "-1.5", "\"ab\"", "/**/7", "x", ""};
+  for (size_t i = 0; i < sizeof(roots) / sizeof(roots[0]); i++) {
+    size_t length = strlen(roots[i]);
+    char* exact = static_cast<char*>(malloc(length));
+    memcpy(exact, roots[i], length);
+    DynamicJsonBuffer terminatedBuffer;
+    std::string expected = parsed(terminatedBuffer.parse(roots[i]));
+    CHECK(parsed(jsonBuffer.parseN(exact, length)) == expected);
+    CHECK(std::string(exact, length) == roots[i]);
+    free(exact);
+  }
+}
+
+// the strings built in the blocks of a DynamicJsonBuffer are the same as the
+// ones written in place, and a buffer that was reset gives the same document
+// without allocating
+void checkDynamicBuffer(const std::vector<std::string>& documents) {
+  CountingJsonBuffer reused(8);
+  for (size_t i = 0; i < documents.size(); i++) {
+    std::vector<char> copy(documents[i].begin(), documents[i].end());
+    DynamicJsonBuffer inPlaceBuffer;
+    std::string expected =
+        printed(inPlaceBuffer.parseN(&copy[0], copy.size()));
+    CHECK(expected.size() > 2);
+
+    CountingJsonBuffer jsonBuffer(8);
+    CHECK(printed(jsonBuffer.parse(documents[i])) == expected);
+
+    // the blocks of the first parse are enough for the second one
+    reused.reset();
+    CHECK(printed(reused.parse(documents[i])) == expected);
+    reused.reset();
+    long before = allocations;
+    CHECK(printed(reused.parse(documents[i])) == expected);
+    CHECK(allocations == before);
+
+    // a failed allocation fails the parsing, at any point
+    for (long limit = 0; limit < 12; limit++) {
+      allocationsBeforeFailure = limit;
+      CountingJsonBuffer failingBuffer(8);
+      JsonVariant value = failingBuffer.parse(documents[i]);
+      CHECK(!value.success() || printed(value) == expected);
+    }
+    allocationsBeforeFailure = -1;
+  }
+}
+
+// a struct reads the same values as a JsonObject, and prints the same JSON
+void checkStruct() {
+  ShadowDeltaJson delta = ShadowDeltaJson();
+  CHECK(JsonStruct<ShadowDeltaJson>(delta).parse(makeShadowDelta(8)));
+  CHECK(delta.version == 42);
+  CHECK(delta.state.hasMove && strcmp(delta.state.move, "height") == 0);
+  CHECK(delta.state.hasHeight && delta.state.height == 1200);
+  CHECK(!delta.state.hasPosition && delta.state.position == 0);
+
+  // within the length of a payload, which stays as it is
+  std::string json = makeShadowDelta(2);
+  std::string received = json + "\"garbage\"}]";
+  std::vector<char> payload(received.begin(), received.end());
+  delta = ShadowDeltaJson();
+  CHECK(JsonStruct<ShadowDeltaJson>(delta).parseN(&payload[0], json.size()));
+  CHECK(delta.state.height == 1200);
+  CHECK(std::string(payload.begin(), payload.end()) == received);
+  CHECK(!JsonStruct<ShadowDeltaJson>(delta).parseN(&payload[0],
+                                                    json.size() - 1));
+
+  const char* telemetry =
+      "{\"moving\":true,\"name\":\"desk\\n\",\"tilt\":-3,\"height\":1187,"
+      "\"uptime\":-86400,\"energy\":4000000000,/* comment */\"temperature\":"
+      "23.25,\"current\":0.173,\"other\":[{\"moving\":false},\"}\"]}";
+  TelemetryJson fields = TelemetryJson();
+  CHECK(JsonStruct<TelemetryJson>(fields).parse(telemetry));
+  DynamicJsonBuffer jsonBuffer;
+  JsonObject& object = jsonBuffer.parseObject(telemetry);
+  CHECK(fields.moving == object["moving"].as<bool>());
+  CHECK(strcmp(fields.name, object["name"]) == 0);
+  CHECK(fields.tilt == object["tilt"].as<int8_t>());
+  CHECK(fields.height == object["height"].as<uint16_t>());
+  CHECK(fields.uptime == object["uptime"].as<long>());
+  CHECK(fields.energy == object["energy"].as<unsigned long>());
+  CHECK(fields.temperature == object["temperature"].as<float>());
+  CHECK(fields.current == object["current"].as<double>());
+  object.remove("other");
+  CHECK(printed(object) == printed(JsonStruct<TelemetryJson>(fields)));
+
+  // unquoted values, null and numbers in strings are taken like as<T>() takes
+  // them
+  fields = TelemetryJson();
+  CHECK(JsonStruct<TelemetryJson>(fields).parse(
+      "{name:null,height:'12',moving:1,tilt:true}"));
+  CHECK(fields.name[0] == 0 && fields.height == 12 && fields.moving &&
+        fields.tilt == 1);
+
+  // errors, a string that doesn't fit, a value of the wrong kind, a key that
+  // is too long
+  CHECK(!JsonStruct<TelemetryJson>(fields).parse("{\"name\":\"12345678\"}"));
+  CHECK(JsonStruct<TelemetryJson>(fields).parse("{\"name\":\"1234567\"}"));
+  CHECK(!JsonStruct<TelemetryJson>(fields).parse("{\"height\":{\"value\":1}}"));
+  CHECK(!JsonStruct<TelemetryJson>(fields).parse("{\"height\":[1]}"));
+  CHECK(!JsonStruct<ShadowDeltaJson>(delta).parse("{\"state\":1}"));
+  CHECK(!JsonStruct<ShadowDeltaJson>(delta).parse("{\"state\":{\"move\" 1}}"));
+  CHECK(!JsonStruct<ShadowDeltaJson>(delta).parse("{\"metadata\":[1,2}"));
+  CHECK(JsonStruct<ShadowDeltaJson>(delta).parse("{\"state\":{}}", 1));
+  CHECK(!JsonStruct<ShadowDeltaJson>(delta).parse("{\"metadata\":{\"a\":{}}}",
+                                                   1));
+
+  // a value of the wrong kind, or no value, fails before the field is written
+  fields = TelemetryJson();
+  fields.height = 7;
+  const char* mistyped[] = {
+      "{\"height\":{}}",           "{\"height\":[1]}",
+      "{\"moving\":[true]}",       "{\"temperature\":{\"value\":1}}",
+      "{\"name\":[\"desk\"]}",     "{\"name\":{}}",
+      "{\"height\":}",             "{\"height\":,\"tilt\":1}",
+      "{\"name\":/* none */}"};
+  for (size_t i = 0; i < sizeof(mistyped) / sizeof(mistyped[0]); i++) {
+    CHECK(!JsonStruct<TelemetryJson>(fields).parse(mistyped[i]));
+  }
+  CHECK(fields.height == 7 && !fields.moving && fields.temperature == 0);
+  CHECK(fields.name[0] == 0 && fields.tilt == 0);
+  delta = ShadowDeltaJson();
+  delta.state.height = 5;
+  CHECK(!JsonStruct<ShadowDeltaJson>(delta).parse(
+      "{\"state\":{\"height\":[1200]}}"));
+  CHECK(!delta.state.hasHeight && delta.state.height == 5);
+
+  // only the structs with a jsonFields() are nested objects, the other types
+  // fail the compilation
+  CHECK(TypeTraits::IsJsonStruct<MoveJson>::value);
+  CHECK(!TypeTraits::IsJsonStruct<const char*>::value);
+  CHECK(!TypeTraits::IsJsonStruct<std::string>::value);
+
+  std::string longKey = "{\"height" +
+                        std::string(ARDUINOJSON_STRUCT_MAX_TOKEN_LENGTH, 'x') +
+                        "\":5}";
+  fields = TelemetryJson();
+  CHECK(JsonStruct<TelemetryJson>(fields).parse(longKey) && fields.height == 0);
+
+  // the fields without their flag are not printed
+  ShadowUpdateJson update = ShadowUpdateJson();
+  CHECK(printed(JsonStruct<ShadowUpdateJson>(update)) ==
+        "{\"desired\":null,\"reported\":{}}");
+  strcpy(update.reported.move, "position");
+  update.reported.hasMove = true;
+  update.reported.position = 2;
+  update.reported.hasPosition = true;
+  CHECK(printed(JsonStruct<ShadowUpdateJson>(update)) ==
+        "{\"desired\":null,\"reported\":{\"move\":\"position\",\"position\":"
+        "2}}");
+}
+
+// each value has its shortest encoding, the MessagePack of a document reads
+// back as the same MessagePack, and the broken or unsupported data fails
+void checkMsgPack(const std::vector<std::string>& documents) {
+  CHECK(msgPackHex("{\"a\":1}") == "81 a1 61 01");
+  CHECK(msgPackHex("[127,128,256,65536]") ==
+        "94 7f cc 80 cd 01 00 ce 00 01 00 00");
+  CHECK(msgPackHex("[-1,-32,-33,-129]") == "94 ff e0 d0 df d1 ff 7f");
+  CHECK(msgPackHex("[true,false,null,0.5]") == "94 c3 c2 c0 ca 3f 00 00 00");
+  CHECK(msgPackHex("[[],{},\"\",[2]]") == "94 90 80 a0 91 02");
+  CHECK(msgPackHex(("\"" + std::string(31, 'x') + "\"").c_str())
+            .substr(0, 2) == "bf");
+  CHECK(msgPackHex(("\"" + std::string(32, 'x') + "\"").c_str())
+            .substr(0, 5) == "d9 20");
+  CHECK(msgPackHex(("\"" + std::string(256, 'x') + "\"").c_str())
+            .substr(0, 8) == "da 01 00");
+
+  DynamicJsonBuffer jsonBuffer;
+  JsonObject& object = jsonBuffer.createObject();
+  object["height"] = 1200;
+  object["speed"] = -12.25f;
+  object["move"] = "up";
+  object["none"] = (char*)NULL;
+  std::string objectBytes = msgPack(object);
+  JsonVariant value =
+      jsonBuffer.parseMsgPack(objectBytes.data(), objectBytes.size());
+  CHECK(printed(value) ==
+        "{\"height\":1200,\"speed\":-12.25,\"move\":\"up\",\"none\":null}");
+  CHECK(value["height"] == 1200);
+  CHECK(value["speed"].as<float>() == -12.25f);
+  CHECK(value["none"].as<char*>() == NULL);
+
+  const unsigned char integers[] = {0x93, 0xd0, 0xdf, 0xcf, 0,    0, 0,
+                                    0,    0xff, 0xff, 0xff, 0xff, 0xd3, 0x80,
+                                    0,    0,    0,    0,    0,    0, 0};
+  value = jsonBuffer.parseMsgPack(integers, sizeof(integers));
+  CHECK(value[0] == -33);
+  CHECK(value[1].as<unsigned long>() == 0xffffffffUL);
+  CHECK(value[2].as<float>() == -9223372036854775808.0f);
+
+  const unsigned char unsupported[][4] = {
+      {0x91, 0xc1}, {0x91, 0xc4, 0x01, 0x00}, {0x81, 0x01, 0x01}};
+  for (size_t i = 0; i < sizeof(unsupported) / sizeof(unsupported[0]); i++) {
+    CHECK(!jsonBuffer.parseMsgPack(unsupported[i], sizeof(unsupported[i]))
+               .success());
+  }
+  CHECK(!parsesMsgPack("\x91\x91\x90", 2));
+  CHECK(parsesMsgPack("\x91\x91\x90", 3));
+
+  // a string in place, moved over its header to make room for the zero, in a
+  // buffer without a byte after the document
+  const char rootString[] = {'\xa2', 'a', 'b'};
+  std::vector<char> exact(rootString, rootString + sizeof(rootString));
+  CHECK(jsonBuffer.parseMsgPack(exact.data(), exact.size()) ==
+        std::string("ab"));
+  const char truncatedString[] = {'\xa3', 'a', 'b'};
+  exact.assign(truncatedString, truncatedString + sizeof(truncatedString));
+  CHECK(!jsonBuffer.parseMsgPack(exact.data(), exact.size()).success());
+
+  for (size_t i = 0; i < documents.size(); i++) {
+    DynamicJsonBuffer documentBuffer;
+    std::string bytes = msgPack(documentBuffer.parse(documents[i]));
+    CHECK(bytes.size() > 2);
+
+    DynamicJsonBuffer copyBuffer;
+    CHECK(msgPack(copyBuffer.parseMsgPack(bytes.data(), bytes.size())) ==
+          bytes);
+
+    std::vector<char> copy(bytes.begin(), bytes.end());
+    DynamicJsonBuffer inPlaceBuffer;
+    CHECK(msgPack(inPlaceBuffer.parseMsgPack(&copy[0], copy.size())) ==
+          bytes);
+
+    // every truncated document fails
+    for (size_t length = 0; length < bytes.size(); length += 1 + length / 16) {
+      CHECK(!parsesMsgPack(bytes.substr(0, length)));
+    }
+  }
+}
+
+// every reader and every string gives the same document as the parser that
+// reads char by char
+void checkSameAsCharByChar(const std::string& json) {
+  DynamicJsonBuffer referenceBuffer;
+  std::string expected = parsed(
+      charByCharParser(referenceBuffer, json.data(), json.size())
+          .parseVariant());
+
+  DynamicJsonBuffer stringBuffer;
+  CHECK(parsed(stringBuffer.parse(json)) == expected);
+  DynamicJsonBuffer terminatedBuffer;
+  CHECK(parsed(terminatedBuffer.parse(json.c_str())) == expected);
+  DynamicJsonBuffer boundedBuffer;
+  CHECK(parsed(boundedBuffer.parseN(json.data(), json.size())) == expected);
+  // without a byte after the document, for AddressSanitizer
+  std::vector<char> copy(json.begin(), json.end());
+  DynamicJsonBuffer inPlaceBuffer;
+  CHECK(parsed(inPlaceBuffer.parseN(copy.data(), copy.size())) == expected);
+
+  // the strings that don't fit in a StaticJsonBuffer stop at the same char
+  StaticJsonBuffer<128> referenceStaticBuffer;
+  expected = parsed(
+      charByCharParser(referenceStaticBuffer, json.data(), json.size())
+          .parseVariant());
+  StaticJsonBuffer<128> staticBuffer;
+  CHECK(parsed(staticBuffer.parse(json)) == expected);
+  CHECK(staticBuffer.size() == referenceStaticBuffer.size());
+
+  const char* const paths[] = {"state.*", "version"};
+  const JsonFilter filter(paths);
+  DynamicJsonBuffer referenceFilterBuffer;
+  expected = parsed(
+      charByCharParser(referenceFilterBuffer, json.data(), json.size())
+          .parseObject(filter));
+  DynamicJsonBuffer filterBuffer;
+  CHECK(parsed(filterBuffer.parseObject(json, filter)) == expected);
+
+  ShadowDeltaJson referenceDelta = ShadowDeltaJson();
+  bool referenceSuccess =
+      charByCharParser(referenceFilterBuffer, json.data(), json.size())
+          .parseStruct(referenceDelta);
+  ShadowDeltaJson delta = ShadowDeltaJson();
+  CHECK(JsonStruct<ShadowDeltaJson>(delta).parse(json) == referenceSuccess);
+  CHECK(printed(JsonStruct<ShadowDeltaJson>(delta)) ==
+        printed(JsonStruct<ShadowDeltaJson>(referenceDelta)));
+}
+
+// the documents, strings of every length around the words, and random
+// mutations of them with quotes, backslashes and brackets, as a small fuzzer
+// that runs with the checks
+void checkPlainChars(std::vector<std::string> documents) {
+  for (size_t length = 0; length < 20; length++) {
+    std::string chars(length, 'x');
+    documents.push_back("{\"state\":{\"move\":\"" + chars + "\",'" + chars +
+                        "':'" + chars + "\\\"\\u00e9\\\\" + chars + "'}}");
+    documents.push_back("[\"" + chars + "\\");
+    documents.push_back("[\"" + chars);
+  }
+
+  const char MUTATIONS[] = "\"'\\{}[],:/* \nxu\x80\xff";
+  uint32_t random = 12345;
+  for (size_t i = 0; i < documents.size(); i++) {
+    checkSameAsCharByChar(documents[i]);
+    for (int mutation = 0; mutation < 100; mutation++) {
+      std::string json = documents[i];
+      for (int change = 0; change < 3 && !json.empty(); change++) {
+        random = random * 1103515245 + 12345;
+        size_t position = (random >> 8) % json.size();
+        char c = MUTATIONS[(random >> 24) % (sizeof(MUTATIONS) - 1)];
+        if (c == '/' && change == 0)
+          json.resize(position);
+        else
+          json[position] = c;
+      }
+      checkSameAsCharByChar(json);
+    }
+  }
+}
+}
+
+int main(int argc, char** argv) {
+  std::vector<std::string> documents;
+  for (int i = 1; i < argc; i++) {
+    std::string json;
+    if (!readFile(argv[i], json)) {
+      printf("%s: cannot read the file\n", argv[i]);
+      return 2;
+    }
+    documents.push_back(json);
+  }
+  documents.push_back(makeShadowDelta(8));
+  documents.push_back(makeLongStrings(5000));
+
+  checkFilter();
+  checkBoundedParse();
+  checkDynamicBuffer(documents);
+  checkStruct();
+  checkMsgPack(documents);
+  checkPlainChars(documents);
+
+  if (failures > 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,40 @@
+// Copyright Benoit Blanchon 2014-2017
+// MIT License
+//
+// Arduino JSON library
+// https://github.com/bblanchon/ArduinoJson
+// If you like this project, please add a star!
+
+// The reference of the fuzzer and of benchmark/check.cpp: a parser that reads
+// the strings one char at a time, like it did before it scanned them a word
+// at a time.
+
+#pragma once
+
+#include <ArduinoJson.h>
+#include <string>
+
+struct CharByCharReader : Internals::CharPointerTraits<char>::BoundedReader {
+  CharByCharReader(const char *ptr, size_t length)
+      : Internals::CharPointerTraits<char>::BoundedReader(ptr, length) {}
+
+  size_t skipPlainChars(char, const char *&) {
+    return 0;
+  }
+};
+
+template <typename TJsonBuffer>
+Internals::JsonParser<CharByCharReader, TJsonBuffer &> charByCharParser(
+    TJsonBuffer &jsonBuffer, const char *json, size_t length) {
+  return Internals::JsonParser<CharByCharReader, TJsonBuffer &>(
+      &jsonBuffer, CharByCharReader(json, length), jsonBuffer,
+      ARDUINOJSON_DEFAULT_NESTING_LIMIT);
+}
+
+// the document as JSON, to compare the results of two parsers
+inline std::string parsed(JsonVariant variant) {
+  std::string json;
+  if (!variant.success()) return "failed";
+  variant.printTo(json);
+  return json;
+}
@@ -1,4 +1,9 @@
 #include <ArduinoJson.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "CharByCharReader.hpp"
 
 class memstream : public std::istream {
   struct membuf : std::streambuf {
@@ -19,5 +24,21 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
   DynamicJsonBuffer jsonBuffer;
   memstream json(data, size);
   jsonBuffer.parse(json);
+
+  // the strings of a buffer are scanned a word at a time, the document must
+  // be the same as the one read char by char
+  const char *chars = reinterpret_cast<const char *>(data);
+  DynamicJsonBuffer referenceBuffer;
+  std::string expected =
+      parsed(charByCharParser(referenceBuffer, chars, size).parseVariant());
+  DynamicJsonBuffer bufferedBuffer;
+  if (parsed(bufferedBuffer.parseN(chars, size)) != expected) abort();
+  std::string terminated(chars, size);
+  DynamicJsonBuffer terminatedBuffer;
+  if (parsed(terminatedBuffer.parse(terminated.c_str())) != expected) abort();
+  // in place, without a byte after the document
+  std::vector<char> copy(chars, chars + size);
+  DynamicJsonBuffer inPlaceBuffer;
+  if (parsed(inPlaceBuffer.parseN(copy.data(), size)) != expected) abort();
   return 0;
 }
@@ -8,16 +8,20 @@
 #pragma once
 
 #include "ArduinoJson/DynamicJsonBuffer.hpp"
+#include "ArduinoJson/JsonFilter.hpp"
 #include "ArduinoJson/JsonArray.hpp"
 #include "ArduinoJson/JsonObject.hpp"
 #include "ArduinoJson/JsonVariantComparisons.hpp"
+#include "ArduinoJson/JsonStruct.hpp"
 #include "ArduinoJson/StaticJsonBuffer.hpp"
 
 #include "ArduinoJson/Deserialization/JsonParserImpl.hpp"
+#include "ArduinoJson/Deserialization/MsgPackParserImpl.hpp"
 #include "ArduinoJson/JsonArrayImpl.hpp"
 #include "ArduinoJson/JsonBufferImpl.hpp"
 #include "ArduinoJson/JsonObjectImpl.hpp"
 #include "ArduinoJson/JsonVariantImpl.hpp"
 #include "ArduinoJson/Serialization/JsonSerializerImpl.hpp"
+#include "ArduinoJson/Serialization/MsgPackSerializerImpl.hpp"
 
 using namespace ArduinoJson;
@@ -70,6 +70,12 @@
 #define ARDUINOJSON_DEFAULT_NESTING_LIMIT 10
 #endif
 
+// the blocks of a DynamicJsonBuffer stay small, so that they fit in a
+// fragmented heap
+#ifndef ARDUINOJSON_DYNAMIC_BLOCK_MAX_CAPACITY
+#define ARDUINOJSON_DYNAMIC_BLOCK_MAX_CAPACITY 1024
+#endif
+
 #else  // assume this is a computer
 
 // on a computer we have plenty of memory so we can use doubles
@@ -130,6 +136,45 @@
 #define ARDUINOJSON_DEFAULT_NESTING_LIMIT 50
 #endif
 
+// the blocks of a DynamicJsonBuffer double in size up to this capacity
+#ifndef ARDUINOJSON_DYNAMIC_BLOCK_MAX_CAPACITY
+#define ARDUINOJSON_DYNAMIC_BLOCK_MAX_CAPACITY 65536
+#endif
+
+#endif
+
+// index the keys of big objects in a hash table, so that a lookup doesn't
+// compare the key with every key of the object (disabled by default, because
+// the index takes 12 to 24 bytes per key in the JsonBuffer on 32-bit targets)
+#ifndef ARDUINOJSON_ENABLE_OBJECT_INDEX
+#define ARDUINOJSON_ENABLE_OBJECT_INDEX 0
+#endif
+
+// number of keys from which an object gets an index
+#ifndef ARDUINOJSON_OBJECT_INDEX_THRESHOLD
+#define ARDUINOJSON_OBJECT_INDEX_THRESHOLD 8
+#endif
+
+// replace an integer of a parsed document with its value the first time it's
+// read as a number from its JsonObject or JsonArray, so that it's parsed once
+// (disabled by default, because each JsonVariant then keeps a pointer to the
+// text of the integer, for as<const char*>(), and because the values change
+// when they're read, even through a const JsonObject or JsonArray)
+#ifndef ARDUINOJSON_ENABLE_NUMBER_CACHE
+#define ARDUINOJSON_ENABLE_NUMBER_CACHE 0
+#endif
+
+// maximum number of paths in a JsonFilter, each takes a byte of stack per
+// nesting level while parsing
+#ifndef ARDUINOJSON_FILTER_MAX_PATHS
+#define ARDUINOJSON_FILTER_MAX_PATHS 8
+#endif
+
+// maximum length of a key and of a number read by JsonStruct, they're read in
+// a buffer of this size on the stack (a longer key matches no field, a longer
+// number fails the parsing)
+#ifndef ARDUINOJSON_STRUCT_MAX_TOKEN_LENGTH
+#define ARDUINOJSON_STRUCT_MAX_TOKEN_LENGTH 31
 #endif
 
 #if ARDUINOJSON_USE_LONG_LONG && ARDUINOJSON_USE_INT64
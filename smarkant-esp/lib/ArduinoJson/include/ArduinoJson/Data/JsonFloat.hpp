@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <stdint.h>  // for uint8_t
+
 #include "../Configuration.hpp"
 
 namespace ArduinoJson {
@@ -17,5 +19,9 @@ typedef double JsonFloat;
 #else
 typedef float JsonFloat;
 #endif
+
+// The number of decimals that selects the shortest representation, the one
+// that reads back as the same JsonFloat.
+const uint8_t JSON_FLOAT_SHORTEST = 0xff;
 }
 }
@@ -0,0 +1,96 @@
+// Copyright Benoit Blanchon 2014-2017
+// MIT License
+//
+// Arduino JSON library
+// https://github.com/bblanchon/ArduinoJson
+// If you like this project, please add a star!
+
+#pragma once
+
+#include <string.h>  // for memset
+
+#include "../JsonBuffer.hpp"
+#include "../JsonPair.hpp"
+#include "../StringTraits/StringTraits.hpp"
+#include "ListNode.hpp"
+#include "StringHash.hpp"
+
+namespace ArduinoJson {
+namespace Internals {
+
+// An open-addressed hash table from the keys to the nodes of a JsonObject.
+// It lives in the JsonBuffer of the object, in a single allocation with the
+// slots, and is only built for objects with at least
+// ARDUINOJSON_OBJECT_INDEX_THRESHOLD keys.
+// The table is kept at most half full, so that the probe sequences are short.
+// When it is full, the object builds a new table with twice the slots; the
+// old one stays in the JsonBuffer, like a removed node does.
+class JsonObjectIndex {
+ public:
+  typedef ListNode<JsonPair> node_type;
+
+  // Builds the index of the nodes of a list.
+  // Returns NULL if the JsonBuffer is too small.
+  static JsonObjectIndex* create(JsonBuffer* buffer, node_type* firstNode,
+                                 size_t count) {
+    size_t capacity = 4;
+    while (capacity <= 2 * count) capacity *= 2;
+    if (capacity > 0x8000) return NULL;
+
+    size_t headerSize = sizeof(JsonObjectIndex);
+    size_t nodesSize = capacity * sizeof(node_type*);
+    void* memory =
+        buffer->alloc(headerSize + nodesSize + capacity * sizeof(uint16_t));
+    if (!memory) return NULL;
+
+    JsonObjectIndex* index = static_cast<JsonObjectIndex*>(memory);
+    index->_nodes = reinterpret_cast<node_type**>(
+        static_cast<char*>(memory) + headerSize);
+    index->_hashes = reinterpret_cast<uint16_t*>(
+        static_cast<char*>(memory) + headerSize + nodesSize);
+    index->_mask = static_cast<uint16_t>(capacity - 1);
+    index->_count = 0;
+    memset(index->_nodes, 0, nodesSize);
+    for (node_type* node = firstNode; node; node = node->next)
+      index->put(node);
+    return index;
+  }
+
+  template <typename TStringRef>
+  node_type* find(TStringRef key) const {
+    uint16_t hash = StringTraits<TStringRef>::hash(key);
+    for (size_t i = hash & _mask; _nodes[i]; i = (i + 1) & _mask) {
+      if (_hashes[i] == hash &&
+          StringTraits<TStringRef>::equals(key, _nodes[i]->content.key))
+        return _nodes[i];
+    }
+    return NULL;
+  }
+
+  // Adds a node whose key has been set.
+  // Returns false if the table is full and needs to be rebuilt.
+  bool insert(node_type* node) {
+    if (2 * (_count + 1u) > _mask + 1u) return false;
+    put(node);
+    return true;
+  }
+
+ private:
+  void put(node_type* node) {
+    // a node without a key is the leftover of a failed set()
+    if (!node->content.key) return;
+    uint16_t hash = StringHash::compute(node->content.key);
+    size_t i = hash & _mask;
+    while (_nodes[i]) i = (i + 1) & _mask;
+    _nodes[i] = node;
+    _hashes[i] = hash;
+    _count++;
+  }
+
+  node_type** _nodes;
+  uint16_t* _hashes;
+  uint16_t _mask;
+  uint16_t _count;
+};
+}
+}
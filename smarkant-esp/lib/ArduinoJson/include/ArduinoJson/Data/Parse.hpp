@@ -7,59 +7,264 @@
 
 #pragma once
 
-#include <stdlib.h>
+#include <stdint.h>  // for uint32_t, uint64_t
+#include <stdlib.h>  // for strtod
 
 namespace ArduinoJson {
 namespace Internals {
+
+inline bool isDecimalDigit(char c) {
+  return static_cast<unsigned char>(c - '0') < 10;
+}
+
+// Converts eight digits at once: the chars are loaded in a 64-bit word, then
+// combined in pairs, in quads and in the whole, with three multiplications
+// instead of eight.
+inline uint32_t parseEightDigits(const char *s) {
+  uint64_t word = 0;
+  for (int i = 7; i >= 0; i--) word = (word << 8) | static_cast<uint8_t>(s[i]);
+  word -= 0x3030303030303030ULL;
+  word = (word * 10) + (word >> 8);
+  word = (((word & 0x000000FF000000FFULL) * 0x000F424000000064ULL) +
+          (((word >> 16) & 0x000000FF000000FFULL) * 0x0000271000000001ULL)) >>
+         32;
+  return static_cast<uint32_t>(word);
+}
+
+// Adds the digits from begin to end to value, which must not overflow.
+template <typename TUInt>
+void accumulateDigits(const char *begin, const char *end, TUInt &value) {
+  if (sizeof(TUInt) >= 4) {
+    for (; end - begin >= 8; begin += 8)
+      value = static_cast<TUInt>(value * 100000000UL + parseEightDigits(begin));
+  }
+  for (; begin < end; begin++)
+    value = static_cast<TUInt>(value * 10 + (*begin - '0'));
+}
+
+// Reads the digits at the beginning of s.
+// Returns the end of the digits, or NULL if the value doesn't fit in TUInt.
+template <typename TUInt>
+const char *parseDigits(const char *s, TUInt &value) {
+  // 5 digits for 16 bits, 10 for 32 bits, 20 for 64 bits
+  const size_t maxDigits = sizeof(TUInt) * 5 / 2;
+
+  while (*s == '0') s++;
+  const char *end = s;
+  while (isDecimalDigit(*end)) end++;
+  size_t count = static_cast<size_t>(end - s);
+  if (count > maxDigits) return NULL;
+
+  value = 0;
+  if (count < maxDigits) {
+    accumulateDigits(s, end, value);
+    return end;
+  }
+  // only the last digit can overflow
+  accumulateDigits(s, end - 1, value);
+  TUInt digit = static_cast<TUInt>(end[-1] - '0');
+  if (value > (static_cast<TUInt>(-1) - digit) / 10) return NULL;
+  value = static_cast<TUInt>(value * 10 + digit);
+  return end;
+}
+
+// Like strtol(), a value out of range gives the closest limit.
+template <typename TInt, typename TUInt>
+TInt parseInteger(const char *s) {
+  while (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n') s++;
+  bool negative = *s == '-';
+  if (*s == '-' || *s == '+') s++;
+
+  const TUInt maxPositive = static_cast<TUInt>(-1) / 2;
+  TUInt value;
+  if (!parseDigits(s, value) || value > maxPositive + negative)
+    return negative ? static_cast<TInt>(-static_cast<TInt>(maxPositive) - 1)
+                    : static_cast<TInt>(maxPositive);
+  return negative ? static_cast<TInt>(0 - value) : static_cast<TInt>(value);
+}
+
+// Like strtoul(), a negative value wraps around and a value out of range
+// gives the maximum.
+template <typename TUInt>
+TUInt parseUnsignedInteger(const char *s) {
+  while (*s == ' ' || *s == '\t' || *s == '\r' || *s == '\n') s++;
+  bool negative = *s == '-';
+  if (*s == '-' || *s == '+') s++;
+
+  TUInt value;
+  if (!parseDigits(s, value)) return static_cast<TUInt>(-1);
+  return negative ? static_cast<TUInt>(0 - value) : value;
+}
+
+// Parses an integer written like JsonWriter writes it, without '+' or leading
+// zeros, so that writing the value gives the same text.
+// Returns false for anything else, or if the value doesn't fit in TUInt.
+template <typename TUInt>
+bool parseCanonicalInteger(const char *s, TUInt &value, bool &negative) {
+  negative = *s == '-';
+  if (negative) s++;
+  if (!isDecimalDigit(*s) || (s[0] == '0' && s[1] != '\0')) return false;
+  const char *end = parseDigits(s, value);
+  return end && *end == '\0';
+}
+
+// The powers of ten and the integers that a floating point type holds
+// exactly.
+template <typename TFloat>
+struct ExactFloat;
+
+template <>
+struct ExactFloat<float> {
+  typedef uint32_t significand_type;
+  static const int maxDigits = 9;
+  static const uint32_t maxSignificand = 16777216;  // 2^24
+  static const int maxPower = 10;
+
+  static float power(int exponent) {
+    static const float powers[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f,
+                                   1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+    return powers[exponent];
+  }
+};
+
+template <>
+struct ExactFloat<double> {
+  typedef uint64_t significand_type;
+  static const int maxDigits = 19;
+  static const uint64_t maxSignificand = 9007199254740992ULL;  // 2^53
+  static const int maxPower = 22;
+
+  static double power(int exponent) {
+    static const double powers[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    return powers[exponent];
+  }
+};
+
+// Parses a float with Clinger's fast path: when the significand and the power
+// of ten are both exact in TFloat, one multiplication or division gives the
+// correctly rounded value. The other numbers, and the text that isn't a plain
+// JSON number (like "NaN"), go to strtod().
 template <typename TFloat>
-TFloat parse(const char *);
+TFloat parseFloat(const char *s) {
+  typedef ExactFloat<TFloat> traits;
+  typedef typename traits::significand_type significand_type;
+
+  const char *p = s;
+  bool negative = *p == '-';
+  if (*p == '-' || *p == '+') p++;
+
+  const char *integralBegin = p;
+  while (isDecimalDigit(*p)) p++;
+  const char *integralEnd = p;
+  const char *fractionalBegin = p;
+  if (*p == '.') {
+    fractionalBegin = ++p;
+    while (isDecimalDigit(*p)) p++;
+  }
+  const char *fractionalEnd = p;
+  if (integralBegin == integralEnd && fractionalBegin == fractionalEnd)
+    return static_cast<TFloat>(strtod(s, NULL));
+
+  int exponent = 0;
+  if (*p == 'e' || *p == 'E') {
+    p++;
+    bool negativeExponent = *p == '-';
+    if (*p == '-' || *p == '+') p++;
+    if (!isDecimalDigit(*p)) return static_cast<TFloat>(strtod(s, NULL));
+    for (; isDecimalDigit(*p); p++) {
+      if (exponent < 10000) exponent = exponent * 10 + (*p - '0');
+    }
+    if (negativeExponent) exponent = -exponent;
+  }
+  if (*p != '\0') return static_cast<TFloat>(strtod(s, NULL));
+
+  // the leading zeros don't count in the digits of the significand
+  while (integralBegin < integralEnd && *integralBegin == '0') integralBegin++;
+  if (integralBegin == integralEnd) {
+    while (fractionalBegin < fractionalEnd && *fractionalBegin == '0') {
+      fractionalBegin++;
+      exponent--;
+    }
+  }
+  int digits = static_cast<int>((integralEnd - integralBegin) +
+                                (fractionalEnd - fractionalBegin));
+  if (digits > traits::maxDigits) return static_cast<TFloat>(strtod(s, NULL));
+
+  significand_type significand = 0;
+  accumulateDigits(integralBegin, integralEnd, significand);
+  accumulateDigits(fractionalBegin, fractionalEnd, significand);
+  exponent -= static_cast<int>(fractionalEnd - fractionalBegin);
+  if (significand == 0) return negative ? -TFloat(0) : TFloat(0);
+
+  // the zeros of a big exponent can go in the significand, like in 12e25
+  while (exponent > traits::maxPower &&
+         significand <= traits::maxSignificand / 10) {
+    significand *= 10;
+    exponent--;
+  }
+  if (significand > traits::maxSignificand || exponent > traits::maxPower ||
+      exponent < -traits::maxPower)
+    return static_cast<TFloat>(strtod(s, NULL));
+
+  TFloat value = static_cast<TFloat>(significand);
+  if (exponent > 0)
+    value *= traits::power(exponent);
+  else if (exponent < 0)
+    value /= traits::power(-exponent);
+  return negative ? -value : value;
+}
+
+template <typename T>
+T parse(const char *);
 
 template <>
 inline float parse<float>(const char *s) {
-  return static_cast<float>(strtod(s, NULL));
+  return parseFloat<float>(s);
 }
 
 template <>
 inline double parse<double>(const char *s) {
-  return strtod(s, NULL);
+  return parseFloat<double>(s);
 }
 
 template <>
 inline long parse<long>(const char *s) {
-  return strtol(s, NULL, 10);
+  return parseInteger<long, unsigned long>(s);
 }
 
 template <>
 inline unsigned long parse<unsigned long>(const char *s) {
-  return strtoul(s, NULL, 10);
+  return parseUnsignedInteger<unsigned long>(s);
 }
 
 template <>
 inline int parse<int>(const char *s) {
-  return atoi(s);
+  return parseInteger<int, unsigned int>(s);
 }
 
 #if ARDUINOJSON_USE_LONG_LONG
 template <>
 inline long long parse<long long>(const char *s) {
-  return strtoll(s, NULL, 10);
+  return parseInteger<long long, unsigned long long>(s);
 }
 
 template <>
 inline unsigned long long parse<unsigned long long>(const char *s) {
-  return strtoull(s, NULL, 10);
+  return parseUnsignedInteger<unsigned long long>(s);
 }
 #endif
 
 #if ARDUINOJSON_USE_INT64
 template <>
 inline __int64 parse<__int64>(const char *s) {
-  return _strtoi64(s, NULL, 10);
+  return parseInteger<__int64, unsigned __int64>(s);
 }
 
 template <>
 inline unsigned __int64 parse<unsigned __int64>(const char *s) {
-  return _strtoui64(s, NULL, 10);
+  return parseUnsignedInteger<unsigned __int64>(s);
 }
 #endif
 }
@@ -0,0 +1,69 @@
+// Copyright Benoit Blanchon 2014-2017
+// MIT License
+//
+// Arduino JSON library
+// https://github.com/bblanchon/ArduinoJson
+// If you like this project, please add a star!
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+#include <string.h>  // for memcpy
+
+#include "../Polyfills/attributes.hpp"
+
+namespace ArduinoJson {
+namespace Internals {
+
+// The chars of a quoted string that are copied as they are: anything but the
+// closing quote, a backslash or a zero.
+inline bool isPlainChar(char c, char stopChar) {
+  return c != stopChar && c != '\\' && c != '\0';
+}
+
+// Returns the end of the plain chars from begin, in a string that is
+// terminated by a zero.
+inline const char *skipPlainChars(const char *begin, char stopChar) {
+  while (isPlainChar(*begin, stopChar)) begin++;
+  return begin;
+}
+
+// Returns the end of the plain chars from begin, before end.
+// The chars are read a word at a time, a byte of the word is flagged if it's
+// a quote, a backslash or a zero, with the "has zero byte" trick of
+// https://graphics.stanford.edu/~seander/bithacks.html#ZeroInWord applied to
+// the word xor the repeated char. The first flagged byte is always right,
+// the ones after it can be wrong.
+FORCE_INLINE inline const char *skipPlainChars(const char *begin,
+                                               const char *end,
+                                               char stopChar) {
+  typedef size_t word;
+  const word ones = static_cast<word>(-1) / 0xff;  // 0x0101...01
+  const word highs = ones << 7;                    // 0x8080...80
+  const word stops = ones * static_cast<unsigned char>(stopChar);
+  const word backslashes = ones * static_cast<unsigned char>('\\');
+
+  while (static_cast<size_t>(end - begin) >= sizeof(word)) {
+    word chars;
+    memcpy(&chars, begin, sizeof(chars));
+    word quotes = chars ^ stops;
+    word escapes = chars ^ backslashes;
+    word flags = (((chars - ones) & ~chars) | ((quotes - ones) & ~quotes) |
+                  ((escapes - ones) & ~escapes)) &
+                 highs;
+    if (flags) {
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && \
+    __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      // the first char is in the low bits
+      return begin + __builtin_ctzll(flags) / 8;
+#else
+      break;
+#endif
+    }
+    begin += sizeof(word);
+  }
+  while (begin < end && isPlainChar(*begin, stopChar)) begin++;
+  return begin;
+}
+}
+}
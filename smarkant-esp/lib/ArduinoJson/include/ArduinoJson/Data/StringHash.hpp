@@ -0,0 +1,40 @@
+// Copyright Benoit Blanchon 2014-2017
+// MIT License
+//
+// Arduino JSON library
+// https://github.com/bblanchon/ArduinoJson
+// If you like this project, please add a star!
+
+#pragma once
+
+#include <stdint.h>  // for uint16_t, uint32_t
+
+namespace ArduinoJson {
+namespace Internals {
+
+// FNV-1a hash of a string, folded to 16 bits.
+// It is computed one char at a time, so that it works for strings in flash.
+class StringHash {
+ public:
+  StringHash() : _value(2166136261UL) {}
+
+  void update(char c) {
+    _value = (_value ^ static_cast<uint8_t>(c)) * 16777619UL;
+  }
+
+  uint16_t value() const {
+    return static_cast<uint16_t>(_value ^ (_value >> 16));
+  }
+
+  static uint16_t compute(const char* str) {
+    StringHash hash;
+    if (str)
+      while (*str) hash.update(*str++);
+    return hash.value();
+  }
+
+ private:
+  uint32_t _value;
+};
+}
+}
@@ -0,0 +1,175 @@
+// Copyright Benoit Blanchon 2014-2017
+// MIT License
+//
+// Arduino JSON library
+// https://github.com/bblanchon/ArduinoJson
+// If you like this project, please add a star!
+
+#pragma once
+
+#include <stdint.h>  // for uint8_t
+
+#include "../JsonFilter.hpp"
+
+namespace ArduinoJson {
+namespace Internals {
+
+// The position of the parser in the paths of a JsonFilter, at one level of
+// the document.
+// For each path, it holds the offset of the segment that the keys at this
+// level are compared with, or DEAD if the path doesn't go through here.
+class JsonFilterLevel {
+ public:
+  enum Match {
+    // the value is skipped
+    NONE,
+    // some members of the value are selected, it's parsed with the child level
+    PARTIAL,
+    // a path ends here, the value is parsed without filter
+    FULL
+  };
+
+  JsonFilterLevel()
+      : _filter(NULL), _key(NULL), _keyLength(0), _anyKey(false) {}
+
+  explicit JsonFilterLevel(const JsonFilter& filter)
+      : _filter(&filter), _key(NULL), _keyLength(0), _anyKey(false) {
+    for (size_t i = 0; i < filter.count(); i++) _offsets[i] = 0;
+  }
+
+  // Starts to compare a key with the segments of this level.
+  // The chars of the key are given to child.append(), then child.endKey()
+  // tells if the value is selected.
+  void beginKey(JsonFilterLevel& child) const {
+    child = *this;
+    child._key = NULL;
+    child._keyLength = 0;
+    child._anyKey = false;
+    for (size_t i = 0; i < count(); i++) {
+      if (isWildcard(i)) child._anyKey = true;
+    }
+  }
+
+  // True if a "*" matches the key, it must then be stored as it is read.
+  bool matchesAnyKey() const {
+    return _anyKey;
+  }
+
+  void append(char c) {
+    for (size_t i = 0; i < count(); i++) {
+      if (_offsets[i] == DEAD || isWildcard(i)) continue;
+      char expected = path(i)[_offsets[i] + _keyLength];
+      if (expected != c || expected == '.' || expected == '\0')
+        _offsets[i] = DEAD;
+    }
+    _keyLength++;
+  }
+
+  Match endKey() {
+    Match match = NONE;
+    for (size_t i = 0; i < count(); i++) {
+      if (_offsets[i] == DEAD) continue;
+      if (isWildcard(i)) {
+        match = strongest(match, endSegment(i, 1));
+      } else {
+        _key = path(i) + _offsets[i];
+        match = strongest(match, endSegment(i, _keyLength));
+      }
+    }
+    return match;
+  }
+
+  // The key matched by a segment, valid after endKey() returned a match that
+  // wasn't a wildcard.
+  const char* key() const {
+    return _key;
+  }
+
+  size_t keyLength() const {
+    return _keyLength;
+  }
+
+  // Moves to the elements of an array, which only "*" matches.
+  Match beginElement(JsonFilterLevel& child) const {
+    Match match = NONE;
+    child = *this;
+    for (size_t i = 0; i < count(); i++) {
+      if (_offsets[i] == DEAD) continue;
+      if (isWildcard(i))
+        match = strongest(match, child.endSegment(i, 1));
+      else
+        child._offsets[i] = DEAD;
+    }
+    return match;
+  }
+
+ private:
+  static const uint8_t DEAD = 0xff;
+
+  size_t count() const {
+    return _filter->count();
+  }
+
+  const char* path(size_t i) const {
+    return _filter->path(i);
+  }
+
+  bool isWildcard(size_t i) const {
+    if (_offsets[i] == DEAD) return false;
+    const char* segment = path(i) + _offsets[i];
+    return segment[0] == '*' && (segment[1] == '.' || segment[1] == '\0');
+  }
+
+  // Moves path i behind a matched segment of the specified length.
+  Match endSegment(size_t i, size_t length) {
+    size_t end = _offsets[i] + length;
+    char c = path(i)[end];
+    if (c == '\0') {
+      _offsets[i] = DEAD;
+      return FULL;
+    }
+    if (c != '.' || end + 1 >= DEAD) {
+      _offsets[i] = DEAD;
+      return NONE;
+    }
+    _offsets[i] = static_cast<uint8_t>(end + 1);
+    return PARTIAL;
+  }
+
+  static Match strongest(Match a, Match b) {
+    return a > b ? a : b;
+  }
+
+  const JsonFilter* _filter;
+  const char* _key;
+  size_t _keyLength;
+  bool _anyKey;
+  uint8_t _offsets[ARDUINOJSON_FILTER_MAX_PATHS];
+};
+
+// Gives the chars of a key to a JsonFilterLevel, and to a string if the key
+// is matched by a "*".
+template <typename TString>
+class JsonFilterKey {
+ public:
+  JsonFilterKey(JsonFilterLevel& level, TString& str)
+      : _level(level), _str(str) {}
+
+  void append(char c) {
+    _level.append(c);
+    if (_level.matchesAnyKey()) _str.append(c);
+  }
+
+  void append(const char* chars, size_t length) {
+    for (size_t i = 0; i < length; i++) _level.append(chars[i]);
+    if (_level.matchesAnyKey()) _str.append(chars, length);
+  }
+
+ private:
+  JsonFilterKey& operator=(const JsonFilterKey&);
+
+  JsonFilterLevel& _level;
+  TString& _str;
+};
+}
+}
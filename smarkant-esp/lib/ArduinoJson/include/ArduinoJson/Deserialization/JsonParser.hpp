@@ -9,7 +9,13 @@
 
 #include "../JsonBuffer.hpp"
 #include "../JsonVariant.hpp"
+#include "../TypeTraits/EnableIf.hpp"
 #include "../TypeTraits/IsConst.hpp"
+#include "../TypeTraits/IsFloatingPoint.hpp"
+#include "../TypeTraits/IsIntegral.hpp"
+#include "../TypeTraits/IsJsonStruct.hpp"
+#include "Comments.hpp"
+#include "JsonFilterLevel.hpp"
 #include "StringWriter.hpp"
 
 namespace ArduinoJson {
@@ -28,8 +34,18 @@ class JsonParser {
         _writer(writer),
         _nestingLimit(nestingLimit) {}
 
-  JsonArray &parseArray();
-  JsonObject &parseObject();
+  JsonArray &parseArray(const JsonFilterLevel *filter = NULL);
+  JsonObject &parseObject(const JsonFilterLevel *filter = NULL);
+
+  JsonArray &parseArray(const JsonFilter &filter) {
+    JsonFilterLevel level(filter);
+    return parseArray(&level);
+  }
+
+  JsonObject &parseObject(const JsonFilter &filter) {
+    JsonFilterLevel level(filter);
+    return parseObject(&level);
+  }
 
   JsonVariant parseVariant() {
     JsonVariant result;
@@ -37,6 +53,11 @@ class JsonParser {
     return result;
   }
 
+  // Parses an object in the fields of a struct, see JsonStruct.
+  // The parser doesn't need a JsonBuffer for this.
+  template <typename TStruct>
+  bool parseStruct(TStruct &object);
+
  private:
   JsonParser &operator=(const JsonParser &);  // non-copiable
 
@@ -46,13 +67,105 @@ class JsonParser {
   }
 
   const char *parseString();
-  bool parseAnythingTo(JsonVariant *destination);
-  FORCE_INLINE bool parseAnythingToUnsafe(JsonVariant *destination);
+  template <typename TString>
+  inline void readString(TString &str);
+  bool parseAnythingTo(JsonVariant *destination,
+                       const JsonFilterLevel *filter = NULL);
+  FORCE_INLINE bool parseAnythingToUnsafe(JsonVariant *destination,
+                                          const JsonFilterLevel *filter);
 
-  inline bool parseArrayTo(JsonVariant *destination);
-  inline bool parseObjectTo(JsonVariant *destination);
+  inline bool parseArrayTo(JsonVariant *destination,
+                           const JsonFilterLevel *filter);
+  inline bool parseObjectTo(JsonVariant *destination,
+                            const JsonFilterLevel *filter);
   inline bool parseStringTo(JsonVariant *destination);
 
+  // Reads a key and compares it with the filter.
+  // The key is stored only if a "*" matched it, a key that matched a segment
+  // of a path is stored later by copyFilteredKey(), once the value is known
+  // to be kept.
+  // Returns false if the JsonBuffer is full.
+  inline bool parseFilteredKey(const JsonFilterLevel &filter,
+                               JsonFilterLevel &child,
+                               JsonFilterLevel::Match &match, const char *&key);
+  inline const char *copyFilteredKey(const JsonFilterLevel &child);
+  inline bool selects(JsonFilterLevel::Match match);
+
+  // Skip a value without storing anything
+  bool skipAnything();
+  inline bool skipAnythingUnsafe();
+  inline bool skipArray();
+  inline bool skipObject();
+
+  // A string that drops the chars of the skipped values
+  struct DummyString {
+    void append(char) {}
+    void append(const char *, size_t) {}
+  };
+
+  // A string in a char array, c_str() returns NULL if it didn't fit
+  class FixedString {
+   public:
+    FixedString(char *chars, size_t capacity)
+        : _chars(chars), _capacity(capacity), _length(0) {}
+
+    void append(char c) {
+      if (_length < _capacity) _chars[_length] = c;
+      _length++;
+    }
+
+    void append(const char *chars, size_t length) {
+      if (_length < _capacity)
+        memcpy(_chars + _length, chars,
+               length < _capacity - _length ? length : _capacity - _length);
+      _length += length;
+    }
+
+    const char *c_str() {
+      if (_length >= _capacity) return NULL;
+      _chars[_length] = 0;
+      return _chars;
+    }
+
+   private:
+    char *_chars;
+    size_t _capacity;
+    size_t _length;
+  };
+
+  // Called with each field of a struct, parses the value of a key in the
+  // field that has this key.
+  template <typename TStruct>
+  class StructFieldParser;
+
+  inline bool parseStructValue(bool &value);
+  template <size_t N>
+  inline bool parseStructValue(char (&value)[N]);
+  template <typename T>
+  inline typename TypeTraits::EnableIf<TypeTraits::IsIntegral<T>::value,
+                                       bool>::type
+  parseStructValue(T &value);
+  template <typename T>
+  inline typename TypeTraits::EnableIf<TypeTraits::IsFloatingPoint<T>::value,
+                                       bool>::type
+  parseStructValue(T &value);
+  template <typename T>
+  inline typename TypeTraits::EnableIf<TypeTraits::IsJsonStruct<T>::value,
+                                       bool>::type
+  parseStructValue(T &value);
+  template <typename T>
+  inline typename TypeTraits::EnableIf<
+      !TypeTraits::IsIntegral<T>::value &&
+          !TypeTraits::IsFloatingPoint<T>::value &&
+          !TypeTraits::IsJsonStruct<T>::value,
+      bool>::type
+  parseStructValue(T &value);
+
+  // The keys and the numbers of a struct are read on the stack
+  typedef char StructToken[ARDUINOJSON_STRUCT_MAX_TOKEN_LENGTH + 1];
+  inline const char *readStructToken(StructToken &chars);
+  inline const char *readStructScalar(StructToken &chars);
+
   static inline bool isInRange(char c, char min, char max) {
     return min <= c && c <= max;
   }
@@ -103,5 +216,80 @@ inline typename JsonParserBuilder<TJsonBuffer, TString>::TParser makeParser(
   return JsonParserBuilder<TJsonBuffer, TString>::makeParser(buffer, json,
                                                              nestingLimit);
 }
+
+// The parser of a string with a length instead of a terminating zero.
+// A const string is copied in the JsonBuffer, like with JsonParserBuilder.
+template <typename TJsonBuffer, typename TChar, typename Enable = void>
+struct BoundedJsonParserBuilder {
+  typedef typename Internals::StringTraits<TChar *>::BoundedReader TReader;
+  typedef JsonParser<TReader, TJsonBuffer &> TParser;
+
+  static TParser makeParser(TJsonBuffer *buffer, TChar *json, size_t length,
+                            uint8_t nestingLimit) {
+    return TParser(buffer, TReader(json, length), *buffer, nestingLimit);
+  }
+};
+
+// A writable string is modified in place.
+// The strings are written behind the opening '{' or '[', and a string never
+// takes more room than its JSON, so the terminating zeros stay in the bounds.
+template <typename TJsonBuffer, typename TChar>
+struct BoundedJsonParserBuilder<
+    TJsonBuffer, TChar,
+    typename TypeTraits::EnableIf<!TypeTraits::IsConst<TChar>::value>::type> {
+  typedef typename Internals::StringTraits<TChar *>::BoundedReader TReader;
+  typedef StringWriter<TChar> TWriter;
+  typedef JsonParser<TReader, TWriter> TParser;
+
+  static TParser makeParser(TJsonBuffer *buffer, TChar *json, size_t length,
+                            uint8_t nestingLimit) {
+    return TParser(buffer, TReader(json, length), TWriter(json),
+                   nestingLimit);
+  }
+};
+
+template <typename TJsonBuffer, typename TChar>
+inline typename BoundedJsonParserBuilder<TJsonBuffer, TChar>::TParser
+makeParser(TJsonBuffer *buffer, TChar *json, size_t length,
+           uint8_t nestingLimit) {
+  return BoundedJsonParserBuilder<TJsonBuffer, TChar>::makeParser(
+      buffer, json, length, nestingLimit);
+}
+
+// Parses any value of a string with a length.
+// A value at the root that is neither an object nor an array has nothing in
+// front of it, so its terminating zero could go at json + length: the string
+// is then read as a const string, and the value copied in the JsonBuffer.
+template <typename TJsonBuffer, typename TChar>
+inline JsonVariant parseBoundedVariant(TJsonBuffer *buffer, TChar *json,
+                                       size_t length, uint8_t nestingLimit) {
+  typename StringTraits<TChar *>::BoundedReader reader(json, length);
+  skipSpacesAndComments(reader);
+  if (reader.current() != '{' && reader.current() != '[') {
+    const TChar *constJson = json;
+    return makeParser(buffer, constJson, length, nestingLimit).parseVariant();
+  }
+  return makeParser(buffer, json, length, nestingLimit).parseVariant();
+}
+
+// The parser of a JsonStruct, which has neither a JsonBuffer nor a writer,
+// since the values go in the fields of the struct.
+struct NoWriter {};
+
+template <typename TString>
+inline JsonParser<typename StringTraits<TString>::Reader, NoWriter>
+makeStructParser(TString &json, uint8_t nestingLimit) {
+  typedef typename StringTraits<TString>::Reader TReader;
+  return JsonParser<TReader, NoWriter>(NULL, TReader(json), NoWriter(),
+                                       nestingLimit);
+}
+
+template <typename TChar>
+inline JsonParser<typename StringTraits<TChar *>::BoundedReader, NoWriter>
+makeStructParser(TChar *json, size_t length, uint8_t nestingLimit) {
+  typedef typename StringTraits<TChar *>::BoundedReader TReader;
+  return JsonParser<TReader, NoWriter>(NULL, TReader(json, length),
+                                       NoWriter(), nestingLimit);
+}
 }
 }
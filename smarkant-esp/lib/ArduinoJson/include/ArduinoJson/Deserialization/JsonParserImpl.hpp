@@ -7,6 +7,11 @@
 
 #pragma once
 
+#include <string.h>  // for strcmp
+
+#include "../Data/Parse.hpp"
+#include "../Polyfills/staticAssert.hpp"
+#include "../TypeTraits/IsUnsignedIntegral.hpp"
 #include "Comments.hpp"
 #include "JsonParser.hpp"
 
@@ -22,10 +27,10 @@ inline bool ArduinoJson::Internals::JsonParser<TReader, TWriter>::eat(
 template <typename TReader, typename TWriter>
 inline bool
 ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseAnythingTo(
-    JsonVariant *destination) {
+    JsonVariant *destination, const JsonFilterLevel *filter) {
   if (_nestingLimit == 0) return false;
   _nestingLimit--;
-  bool success = parseAnythingToUnsafe(destination);
+  bool success = parseAnythingToUnsafe(destination, filter);
   _nestingLimit++;
   return success;
 }
@@ -33,15 +38,15 @@ ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseAnythingTo(
 template <typename TReader, typename TWriter>
 inline bool
 ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseAnythingToUnsafe(
-    JsonVariant *destination) {
+    JsonVariant *destination, const JsonFilterLevel *filter) {
   skipSpacesAndComments(_reader);
 
   switch (_reader.current()) {
     case '[':
-      return parseArrayTo(destination);
+      return parseArrayTo(destination, filter);
 
     case '{':
-      return parseObjectTo(destination);
+      return parseObjectTo(destination, filter);
 
     default:
       return parseStringTo(destination);
@@ -50,10 +55,16 @@ ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseAnythingToUnsafe(
 
 template <typename TReader, typename TWriter>
 inline ArduinoJson::JsonArray &
-ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseArray() {
+ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseArray(
+    const JsonFilterLevel *filter) {
   // Create an empty array
   JsonArray &array = _buffer->createArray();
 
+  // Find the filter of the elements
+  JsonFilterLevel elementFilter;
+  JsonFilterLevel::Match match =
+      filter ? filter->beginElement(elementFilter) : JsonFilterLevel::FULL;
+
   // Check opening braket
   if (!eat('[')) goto ERROR_MISSING_BRACKET;
   if (eat(']')) goto SUCCESS_EMPTY_ARRAY;
@@ -61,9 +72,16 @@ ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseArray() {
   // Read each value
   for (;;) {
     // 1 - Parse value
-    JsonVariant value;
-    if (!parseAnythingTo(&value)) goto ERROR_INVALID_VALUE;
-    if (!array.add(value)) goto ERROR_NO_MEMORY;
+    if (selects(match)) {
+      JsonVariant value;
+      if (!parseAnythingTo(&value, match == JsonFilterLevel::PARTIAL
+                                       ? &elementFilter
+                                       : NULL))
+        goto ERROR_INVALID_VALUE;
+      if (!array.add(value)) goto ERROR_NO_MEMORY;
+    } else {
+      if (!skipAnything()) goto ERROR_INVALID_VALUE;
+    }
 
     // 2 - More values?
     if (eat(']')) goto SUCCES_NON_EMPTY_ARRAY;
@@ -83,8 +101,8 @@ ERROR_NO_MEMORY:
 
 template <typename TReader, typename TWriter>
 inline bool ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseArrayTo(
-    JsonVariant *destination) {
-  JsonArray &array = parseArray();
+    JsonVariant *destination, const JsonFilterLevel *filter) {
+  JsonArray &array = parseArray(filter);
   if (!array.success()) return false;
 
   *destination = array;
@@ -93,7 +111,8 @@ inline bool ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseArrayTo(
 
 template <typename TReader, typename TWriter>
 inline ArduinoJson::JsonObject &
-ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseObject() {
+ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseObject(
+    const JsonFilterLevel *filter) {
   // Create an empty object
   JsonObject &object = _buffer->createObject();
 
@@ -104,14 +123,31 @@ ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseObject() {
   // Read each key value pair
   for (;;) {
     // 1 - Parse key
-    const char *key = parseString();
-    if (!key) goto ERROR_INVALID_KEY;
+    const char *key;
+    JsonFilterLevel childFilter;
+    JsonFilterLevel::Match match = JsonFilterLevel::FULL;
+    if (filter) {
+      if (!parseFilteredKey(*filter, childFilter, match, key))
+        goto ERROR_NO_MEMORY;
+    } else {
+      key = parseString();
+      if (!key) goto ERROR_INVALID_KEY;
+    }
     if (!eat(':')) goto ERROR_MISSING_COLON;
 
     // 2 - Parse value
-    JsonVariant value;
-    if (!parseAnythingTo(&value)) goto ERROR_INVALID_VALUE;
-    if (!object.set(key, value)) goto ERROR_NO_MEMORY;
+    if (selects(match)) {
+      if (!key) key = copyFilteredKey(childFilter);
+      if (!key) goto ERROR_NO_MEMORY;
+      JsonVariant value;
+      if (!parseAnythingTo(&value, match == JsonFilterLevel::PARTIAL
+                                       ? &childFilter
+                                       : NULL))
+        goto ERROR_INVALID_VALUE;
+      if (!object.set(key, value)) goto ERROR_NO_MEMORY;
+    } else {
+      if (!skipAnything()) goto ERROR_INVALID_VALUE;
+    }
 
     // 3 - More keys/values?
     if (eat('}')) goto SUCCESS_NON_EMPTY_OBJECT;
@@ -133,8 +169,8 @@ ERROR_NO_MEMORY:
 
 template <typename TReader, typename TWriter>
 inline bool ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseObjectTo(
-    JsonVariant *destination) {
-  JsonObject &object = parseObject();
+    JsonVariant *destination, const JsonFilterLevel *filter) {
+  JsonObject &object = parseObject(filter);
   if (!object.success()) return false;
 
   *destination = object;
@@ -146,7 +182,14 @@ inline const char *
 ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseString() {
   typename TypeTraits::RemoveReference<TWriter>::type::String str =
       _writer.startString();
+  readString(str);
+  return str.c_str();
+}
 
+template <typename TReader, typename TWriter>
+template <typename TString>
+inline void ArduinoJson::Internals::JsonParser<TReader, TWriter>::readString(
+    TString &str) {
   skipSpacesAndComments(_reader);
   char c = _reader.current();
 
@@ -154,6 +197,11 @@ ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseString() {
     _reader.move();
     char stopChar = c;
     for (;;) {
+      // the chars before the next quote, backslash or zero, at once
+      const char *run;
+      size_t length = _reader.skipPlainChars(stopChar, run);
+      if (length) str.append(run, length);
+
       c = _reader.current();
       if (c == '\0') break;
       _reader.move();
@@ -177,8 +225,6 @@ ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseString() {
       c = _reader.current();
     }
   }
-
-  return str.c_str();
 }
 
 template <typename TReader, typename TWriter>
@@ -194,3 +240,294 @@ inline bool ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseStringTo(
   }
   return true;
 }
+
+template <typename TReader, typename TWriter>
+inline bool
+ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseFilteredKey(
+    const JsonFilterLevel &filter, JsonFilterLevel &child,
+    JsonFilterLevel::Match &match, const char *&key) {
+  typename TypeTraits::RemoveReference<TWriter>::type::String str =
+      _writer.startString();
+  filter.beginKey(child);
+  JsonFilterKey<typename TypeTraits::RemoveReference<TWriter>::type::String>
+      filterKey(child, str);
+  readString(filterKey);
+  match = child.endKey();
+  key = NULL;
+  if (match == JsonFilterLevel::NONE || !child.matchesAnyKey()) return true;
+  key = str.c_str();
+  return key != NULL;
+}
+
+template <typename TReader, typename TWriter>
+inline const char *
+ArduinoJson::Internals::JsonParser<TReader, TWriter>::copyFilteredKey(
+    const JsonFilterLevel &child) {
+  typename TypeTraits::RemoveReference<TWriter>::type::String str =
+      _writer.startString();
+  for (size_t i = 0; i < child.keyLength(); i++) str.append(child.key()[i]);
+  return str.c_str();
+}
+
+template <typename TReader, typename TWriter>
+inline bool ArduinoJson::Internals::JsonParser<TReader, TWriter>::selects(
+    JsonFilterLevel::Match match) {
+  if (match == JsonFilterLevel::FULL) return true;
+  if (match == JsonFilterLevel::NONE) return false;
+  // the selected values below a partial match can only be in an object or an
+  // array
+  skipSpacesAndComments(_reader);
+  return _reader.current() == '{' || _reader.current() == '[';
+}
+
+template <typename TReader, typename TWriter>
+inline bool
+ArduinoJson::Internals::JsonParser<TReader, TWriter>::skipAnything() {
+  if (_nestingLimit == 0) return false;
+  _nestingLimit--;
+  bool success = skipAnythingUnsafe();
+  _nestingLimit++;
+  return success;
+}
+
+template <typename TReader, typename TWriter>
+inline bool
+ArduinoJson::Internals::JsonParser<TReader, TWriter>::skipAnythingUnsafe() {
+  skipSpacesAndComments(_reader);
+
+  switch (_reader.current()) {
+    case '[':
+      return skipArray();
+
+    case '{':
+      return skipObject();
+
+    default: {
+      DummyString str;
+      readString(str);
+      return true;
+    }
+  }
+}
+
+template <typename TReader, typename TWriter>
+inline bool ArduinoJson::Internals::JsonParser<TReader, TWriter>::skipArray() {
+  // Check opening braket
+  if (!eat('[')) return false;
+  if (eat(']')) return true;
+
+  // Skip each value
+  for (;;) {
+    if (!skipAnything()) return false;
+    if (eat(']')) return true;
+    if (!eat(',')) return false;
+  }
+}
+
+template <typename TReader, typename TWriter>
+inline bool ArduinoJson::Internals::JsonParser<TReader, TWriter>::skipObject() {
+  // Check opening brace
+  if (!eat('{')) return false;
+  if (eat('}')) return true;
+
+  // Skip each key value pair
+  for (;;) {
+    DummyString key;
+    readString(key);
+    if (!eat(':')) return false;
+    if (!skipAnything()) return false;
+    if (eat('}')) return true;
+    if (!eat(',')) return false;
+  }
+}
+
+template <typename TReader, typename TWriter>
+template <typename TStruct>
+class ArduinoJson::Internals::JsonParser<TReader, TWriter>::StructFieldParser {
+ public:
+  StructFieldParser(JsonParser &parser, TStruct &object, const char *key)
+      : _parser(parser),
+        _object(object),
+        _key(key),
+        _matched(false),
+        _success(false) {}
+
+  template <typename TValue>
+  void operator()(const char *key, TValue TStruct::*member) {
+    if (!matches(key)) return;
+    _success = _parser.parseStructValue(_object.*member);
+  }
+
+  template <typename TValue>
+  void operator()(const char *key, TValue TStruct::*member,
+                  bool TStruct::*present) {
+    if (!matches(key)) return;
+    _success = _parser.parseStructValue(_object.*member);
+    _object.*present = _success;
+  }
+
+  bool matched() const {
+    return _matched;
+  }
+
+  bool success() const {
+    return _success;
+  }
+
+ private:
+  StructFieldParser &operator=(const StructFieldParser &);
+
+  // the first field with the key takes the value
+  bool matches(const char *key) {
+    if (_matched || !_key || strcmp(key, _key) != 0) return false;
+    _matched = true;
+    return true;
+  }
+
+  JsonParser &_parser;
+  TStruct &_object;
+  const char *_key;
+  bool _matched;
+  bool _success;
+};
+
+template <typename TReader, typename TWriter>
+template <typename TStruct>
+inline bool ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseStruct(
+    TStruct &object) {
+  // Check opening brace
+  if (!eat('{')) return false;
+  if (eat('}')) return true;
+
+  // Read each key value pair
+  for (;;) {
+    // 1 - Parse key, a key that doesn't fit in the token matches no field
+    StructToken chars;
+    const char *key = readStructToken(chars);
+    if (!eat(':')) return false;
+
+    // 2 - Parse value in the field with this key, or skip it
+    StructFieldParser<TStruct> field(*this, object, key);
+    TStruct::jsonFields(field);
+    if (field.matched() ? !field.success() : !skipAnything()) return false;
+
+    // 3 - More keys/values?
+    if (eat('}')) return true;
+    if (!eat(',')) return false;
+  }
+}
+
+template <typename TReader, typename TWriter>
+inline const char *
+ArduinoJson::Internals::JsonParser<TReader, TWriter>::readStructToken(
+    StructToken &chars) {
+  FixedString str(chars, sizeof(chars));
+  readString(str);
+  return str.c_str();
+}
+
+// Reads the value of a bool or number field.
+// Returns NULL for an object, an array or a missing value, which the field
+// can't take.
+template <typename TReader, typename TWriter>
+inline const char *
+ArduinoJson::Internals::JsonParser<TReader, TWriter>::readStructScalar(
+    StructToken &chars) {
+  skipSpacesAndComments(_reader);
+  char c = _reader.current();
+  if (c == '{' || c == '[') return NULL;
+  bool hasQuotes = isQuote(c);
+  const char *token = readStructToken(chars);
+  if (token && !hasQuotes && !token[0]) return NULL;
+  return token;
+}
+
+// The values are converted like JsonVariant::as<T>() converts them.
+template <typename TReader, typename TWriter>
+inline bool
+ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseStructValue(
+    bool &value) {
+  StructToken chars;
+  const char *token = readStructScalar(chars);
+  if (!token) return false;
+  value = !strcmp("true", token) || parse<JsonInteger>(token) != 0;
+  return true;
+}
+
+template <typename TReader, typename TWriter>
+template <size_t N>
+inline bool
+ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseStructValue(
+    char (&value)[N]) {
+  skipSpacesAndComments(_reader);
+  char c = _reader.current();
+  if (c == '{' || c == '[') return false;
+  bool hasQuotes = isQuote(c);
+  FixedString str(value, N);
+  readString(str);
+  if (!str.c_str() || (!hasQuotes && !value[0])) return false;
+  if (!hasQuotes && !strcmp("null", value)) value[0] = 0;
+  return true;
+}
+
+template <typename TReader, typename TWriter>
+template <typename T>
+inline typename ArduinoJson::TypeTraits::EnableIf<
+    ArduinoJson::TypeTraits::IsIntegral<T>::value, bool>::type
+ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseStructValue(
+    T &value) {
+  StructToken chars;
+  const char *token = readStructScalar(chars);
+  if (!token) return false;
+  if (!strcmp("true", token))
+    value = 1;
+  else if (TypeTraits::IsUnsignedIntegral<T>::value)
+    value = static_cast<T>(parse<JsonUInt>(token));
+  else
+    value = static_cast<T>(parse<JsonInteger>(token));
+  return true;
+}
+
+template <typename TReader, typename TWriter>
+template <typename T>
+inline typename ArduinoJson::TypeTraits::EnableIf<
+    ArduinoJson::TypeTraits::IsFloatingPoint<T>::value, bool>::type
+ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseStructValue(
+    T &value) {
+  StructToken chars;
+  const char *token = readStructScalar(chars);
+  if (!token) return false;
+  value = static_cast<T>(parse<JsonFloat>(token));
+  return true;
+}
+
+// A field with a jsonFields() is a nested struct.
+template <typename TReader, typename TWriter>
+template <typename T>
+inline typename ArduinoJson::TypeTraits::EnableIf<
+    ArduinoJson::TypeTraits::IsJsonStruct<T>::value, bool>::type
+ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseStructValue(
+    T &value) {
+  if (_nestingLimit == 0) return false;
+  _nestingLimit--;
+  bool success = parseStruct(value);
+  _nestingLimit++;
+  return success;
+}
+
+// The other fields, like a const char*, have nowhere to put the value.
+template <typename TReader, typename TWriter>
+template <typename T>
+inline typename ArduinoJson::TypeTraits::EnableIf<
+    !ArduinoJson::TypeTraits::IsIntegral<T>::value &&
+        !ArduinoJson::TypeTraits::IsFloatingPoint<T>::value &&
+        !ArduinoJson::TypeTraits::IsJsonStruct<T>::value,
+    bool>::type
+ArduinoJson::Internals::JsonParser<TReader, TWriter>::parseStructValue(
+    T &) {
+  ARDUINOJSON_STATIC_ASSERT(
+      TypeTraits::IsJsonStruct<T>::value, JsonStruct_field_cannot_be_parsed,
+      "JsonStruct can only parse a bool, an integer, a float, a char array or "
+      "a struct with jsonFields(), a const char* field can only be printed");
+  return false;
+}
@@ -0,0 +1,105 @@
+// Copyright Benoit Blanchon 2014-2017
+// MIT License
+//
+// Arduino JSON library
+// https://github.com/bblanchon/ArduinoJson
+// If you like this project, please add a star!
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint8_t, uint64_t
+
+#include "../JsonBuffer.hpp"
+#include "../JsonVariant.hpp"
+#include "../TypeTraits/EnableIf.hpp"
+#include "../TypeTraits/IsConst.hpp"
+#include "StringWriter.hpp"
+
+namespace ArduinoJson {
+namespace Internals {
+
+// Parse MessagePack (https://msgpack.org) to create JsonArrays and JsonObjects
+// This internal class is not indended to be used directly.
+// Instead, use JsonBuffer.parseMsgPack()
+template <typename TWriter>
+class MsgPackParser {
+ public:
+  MsgPackParser(JsonBuffer *buffer, const uint8_t *data, size_t length,
+                TWriter writer, uint8_t nestingLimit)
+      : _buffer(buffer),
+        _ptr(data),
+        _end(data + length),
+        _writer(writer),
+        _nestingLimit(nestingLimit) {}
+
+  JsonVariant parseVariant() {
+    JsonVariant result;
+    parseAnythingTo(&result);
+    return result;
+  }
+
+ private:
+  MsgPackParser &operator=(const MsgPackParser &);  // non-copiable
+
+  bool parseAnythingTo(JsonVariant *destination);
+  bool parseAnythingToUnsafe(JsonVariant *destination);
+  bool parseArrayTo(JsonVariant *destination, size_t size);
+  bool parseObjectTo(JsonVariant *destination, size_t size);
+  bool parseStringTo(JsonVariant *destination, size_t length);
+  bool parseIntegerTo(JsonVariant *destination, uint64_t value);
+  bool parseNegativeIntegerTo(JsonVariant *destination, uint64_t magnitude);
+
+  // Reads the length of a string whose header starts with code.
+  // Returns false if the code isn't the one of a string.
+  bool readStringLength(uint8_t code, size_t &length);
+  // Returns NULL if the data is too short or if the JsonBuffer is full.
+  const char *readString(size_t length);
+  // Reads an unsigned big-endian integer of the specified number of bytes.
+  bool readInteger(int bytes, uint64_t &value);
+
+  JsonBuffer *_buffer;
+  const uint8_t *_ptr;
+  const uint8_t *_end;
+  TWriter _writer;
+  uint8_t _nestingLimit;
+};
+
+// A const string is copied in the JsonBuffer.
+template <typename TJsonBuffer, typename TChar, typename Enable = void>
+struct MsgPackParserBuilder {
+  typedef MsgPackParser<TJsonBuffer &> TParser;
+
+  static TParser makeParser(TJsonBuffer *buffer, TChar *data, size_t length,
+                            uint8_t nestingLimit) {
+    return TParser(buffer, reinterpret_cast<const uint8_t *>(data), length,
+                   *buffer, nestingLimit);
+  }
+};
+
+// A writable string is modified in place.
+// The header of a string takes at least one byte, so the string and its
+// terminating zero are written behind the bytes that were read.
+template <typename TJsonBuffer, typename TChar>
+struct MsgPackParserBuilder<
+    TJsonBuffer, TChar,
+    typename TypeTraits::EnableIf<!TypeTraits::IsConst<TChar>::value>::type> {
+  typedef StringWriter<TChar> TWriter;
+  typedef MsgPackParser<TWriter> TParser;
+
+  static TParser makeParser(TJsonBuffer *buffer, TChar *data, size_t length,
+                            uint8_t nestingLimit) {
+    return TParser(buffer, reinterpret_cast<const uint8_t *>(data), length,
+                   TWriter(data), nestingLimit);
+  }
+};
+
+template <typename TJsonBuffer, typename TChar>
+inline typename MsgPackParserBuilder<TJsonBuffer, TChar>::TParser
+makeMsgPackParser(TJsonBuffer *buffer, TChar *data, size_t length,
+                  uint8_t nestingLimit) {
+  return MsgPackParserBuilder<TJsonBuffer, TChar>::makeParser(
+      buffer, data, length, nestingLimit);
+}
+}
+}
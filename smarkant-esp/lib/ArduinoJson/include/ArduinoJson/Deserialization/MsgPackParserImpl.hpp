@@ -0,0 +1,229 @@
+// Copyright Benoit Blanchon 2014-2017
+// MIT License
+//
+// Arduino JSON library
+// https://github.com/bblanchon/ArduinoJson
+// If you like this project, please add a star!
+
+#pragma once
+
+#include <string.h>  // for memcpy
+
+#include "../TypeTraits/RemoveReference.hpp"
+#include "MsgPackParser.hpp"
+
+template <typename TWriter>
+inline bool ArduinoJson::Internals::MsgPackParser<TWriter>::parseAnythingTo(
+    JsonVariant *destination) {
+  if (_nestingLimit == 0) return false;
+  _nestingLimit--;
+  bool success = parseAnythingToUnsafe(destination);
+  _nestingLimit++;
+  return success;
+}
+
+template <typename TWriter>
+inline bool
+ArduinoJson::Internals::MsgPackParser<TWriter>::parseAnythingToUnsafe(
+    JsonVariant *destination) {
+  if (_ptr == _end) return false;
+  uint8_t code = *_ptr++;
+
+  // the codes with the value or the size in the low bits
+  if (code <= 0x7f) return parseIntegerTo(destination, code);
+  if (code >= 0xe0) return parseNegativeIntegerTo(destination, 0x100 - code);
+  if ((code & 0xf0) == 0x80) return parseObjectTo(destination, code & 0x0f);
+  if ((code & 0xf0) == 0x90) return parseArrayTo(destination, code & 0x0f);
+
+  size_t length;
+  if (readStringLength(code, length))
+    return parseStringTo(destination, length);
+
+  uint64_t value;
+  switch (code) {
+    case 0xc0:
+      *destination = RawJson("null");
+      return true;
+
+    case 0xc2:
+    case 0xc3:
+      *destination = code == 0xc3;
+      return true;
+
+    case 0xca: {
+      if (!readInteger(4, value)) return false;
+      uint32_t bits = static_cast<uint32_t>(value);
+      float single;
+      memcpy(&single, &bits, sizeof(single));
+      *destination = static_cast<JsonFloat>(single);
+      return true;
+    }
+
+    case 0xcb: {
+      if (!readInteger(8, value)) return false;
+      double number;
+      memcpy(&number, &value, sizeof(number));
+      *destination = static_cast<JsonFloat>(number);
+      return true;
+    }
+
+    case 0xcc:
+    case 0xcd:
+    case 0xce:
+    case 0xcf: {
+      int bytes = 1 << (code - 0xcc);
+      return readInteger(bytes, value) && parseIntegerTo(destination, value);
+    }
+
+    case 0xd0:
+    case 0xd1:
+    case 0xd2:
+    case 0xd3: {
+      int bytes = 1 << (code - 0xd0);
+      if (!readInteger(bytes, value)) return false;
+      if (!(value >> (8 * bytes - 1))) return parseIntegerTo(destination, value);
+      // the magnitude of the two's complement, extended to 64 bits
+      if (bytes < 8) value |= ~uint64_t(0) << (8 * bytes);
+      return parseNegativeIntegerTo(destination, 0 - value);
+    }
+
+    case 0xdc:
+    case 0xdd:
+      return readInteger(code == 0xdc ? 2 : 4, value) &&
+             parseArrayTo(destination, static_cast<size_t>(value));
+
+    case 0xde:
+    case 0xdf:
+      return readInteger(code == 0xde ? 2 : 4, value) &&
+             parseObjectTo(destination, static_cast<size_t>(value));
+
+    default:
+      // 0xc1 is never used, the bin and ext types have no JSON equivalent
+      return false;
+  }
+}
+
+template <typename TWriter>
+inline bool ArduinoJson::Internals::MsgPackParser<TWriter>::parseArrayTo(
+    JsonVariant *destination, size_t size) {
+  // each element takes at least one byte
+  if (size > static_cast<size_t>(_end - _ptr)) return false;
+
+  JsonArray &array = _buffer->createArray();
+  if (!array.success()) return false;
+
+  for (size_t i = 0; i < size; i++) {
+    JsonVariant value;
+    if (!parseAnythingTo(&value)) return false;
+    if (!array.add(value)) return false;
+  }
+
+  *destination = array;
+  return true;
+}
+
+template <typename TWriter>
+inline bool ArduinoJson::Internals::MsgPackParser<TWriter>::parseObjectTo(
+    JsonVariant *destination, size_t size) {
+  // each key and each value take at least one byte
+  if (size > static_cast<size_t>(_end - _ptr) / 2) return false;
+
+  JsonObject &object = _buffer->createObject();
+  if (!object.success()) return false;
+
+  for (size_t i = 0; i < size; i++) {
+    size_t length;
+    if (_ptr == _end || !readStringLength(*_ptr++, length)) return false;
+    const char *key = readString(length);
+    if (!key) return false;
+
+    JsonVariant value;
+    if (!parseAnythingTo(&value)) return false;
+    if (!object.set(key, value)) return false;
+  }
+
+  *destination = object;
+  return true;
+}
+
+template <typename TWriter>
+inline bool ArduinoJson::Internals::MsgPackParser<TWriter>::parseStringTo(
+    JsonVariant *destination, size_t length) {
+  const char *value = readString(length);
+  if (!value) return false;
+  *destination = value;
+  return true;
+}
+
+template <typename TWriter>
+inline bool ArduinoJson::Internals::MsgPackParser<TWriter>::parseIntegerTo(
+    JsonVariant *destination, uint64_t value) {
+  // a value that doesn't fit in a JsonUInt is kept as a float
+  if (value > static_cast<JsonUInt>(-1))
+    *destination = static_cast<JsonFloat>(value);
+  else
+    *destination = static_cast<JsonUInt>(value);
+  return true;
+}
+
+template <typename TWriter>
+inline bool
+ArduinoJson::Internals::MsgPackParser<TWriter>::parseNegativeIntegerTo(
+    JsonVariant *destination, uint64_t magnitude) {
+  if (magnitude > static_cast<JsonUInt>(-1) / 2)
+    *destination = -static_cast<JsonFloat>(magnitude);
+  else
+    *destination = -static_cast<JsonInteger>(magnitude);
+  return true;
+}
+
+template <typename TWriter>
+inline bool ArduinoJson::Internals::MsgPackParser<TWriter>::readStringLength(
+    uint8_t code, size_t &length) {
+  if ((code & 0xe0) == 0xa0) {
+    length = code & 0x1f;
+    return true;
+  }
+
+  int bytes;
+  switch (code) {
+    case 0xd9:
+      bytes = 1;
+      break;
+    case 0xda:
+      bytes = 2;
+      break;
+    case 0xdb:
+      bytes = 4;
+      break;
+    default:
+      return false;
+  }
+
+  uint64_t value;
+  if (!readInteger(bytes, value)) return false;
+  length = static_cast<size_t>(value);
+  return true;
+}
+
+template <typename TWriter>
+inline const char *ArduinoJson::Internals::MsgPackParser<TWriter>::readString(
+    size_t length) {
+  if (length > static_cast<size_t>(_end - _ptr)) return NULL;
+
+  typename TypeTraits::RemoveReference<TWriter>::type::String str =
+      _writer.startString();
+  str.append(reinterpret_cast<const char *>(_ptr), length);
+  _ptr += length;
+  return str.c_str();
+}
+
+template <typename TWriter>
+inline bool ArduinoJson::Internals::MsgPackParser<TWriter>::readInteger(
+    int bytes, uint64_t &value) {
+  if (_end - _ptr < bytes) return false;
+
+  value = 0;
+  for (int i = 0; i < bytes; i++) value = (value << 8) | *_ptr++;
+  return true;
+}
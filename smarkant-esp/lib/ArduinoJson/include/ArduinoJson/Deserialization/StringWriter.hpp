@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <string.h>  // for memmove
+
 namespace ArduinoJson {
 namespace Internals {
 
@@ -21,6 +23,12 @@ class StringWriter {
       *(*_writePtr)++ = c;
     }
 
+    // The chars can overlap the string, since it's written behind the input.
+    void append(const char* chars, size_t length) {
+      memmove(*_writePtr, chars, length);
+      *_writePtr += length;
+    }
+
     const char* c_str() const {
       *(*_writePtr)++ = 0;
       return reinterpret_cast<const char*>(_startPtr);
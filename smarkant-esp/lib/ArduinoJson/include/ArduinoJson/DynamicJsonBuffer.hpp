@@ -47,16 +47,11 @@ class DynamicJsonBufferBase
 
  public:
   DynamicJsonBufferBase(size_t initialSize = 256)
-      : _head(NULL), _nextBlockCapacity(initialSize) {}
+      : _head(NULL), _free(NULL), _nextBlockCapacity(initialSize) {}
 
   ~DynamicJsonBufferBase() {
-    Block* currentBlock = _head;
-
-    while (currentBlock != NULL) {
-      Block* nextBlock = currentBlock->next;
-      _allocator.deallocate(currentBlock);
-      currentBlock = nextBlock;
-    }
+    freeBlocks(_head);
+    freeBlocks(_free);
   }
 
   size_t size() const {
@@ -70,35 +65,62 @@ class DynamicJsonBufferBase
     return canAllocInHead(bytes) ? allocInHead(bytes) : allocInNewBlock(bytes);
   }
 
+  // Forgets everything that was allocated, but keeps the blocks for the next
+  // document, so that parsing it doesn't allocate again.
+  // The JsonArray, JsonObject and strings of the buffer become invalid.
+  void reset() {
+    while (_head) {
+      Block* block = _head;
+      _head = block->next;
+      block->size = 0;
+      block->next = _free;
+      _free = block;
+    }
+  }
+
+  // Builds a string in the free space of the head block.
+  // It takes all that space at first, and gives back what it didn't use in
+  // c_str(). If the string doesn't fit, it moves to a block that can hold
+  // twice its length, so a long string is copied a few times, not once for
+  // each char.
   class String {
    public:
     String(DynamicJsonBufferBase* parent)
-        : _parent(parent), _start(NULL), _length(0) {}
+        : _parent(parent), _start(NULL), _length(0), _capacity(0) {}
 
     void append(char c) {
-      if (_parent->canAllocInHead(1)) {
-        char* end = static_cast<char*>(_parent->allocInHead(1));
-        *end = c;
-        if (_length == 0) _start = end;
-      } else {
-        char* newStart =
-            static_cast<char*>(_parent->allocInNewBlock(_length + 1));
-        if (_start && newStart) memcpy(newStart, _start, _length);
-        if (newStart) newStart[_length] = c;
-        _start = newStart;
-      }
+      if (_length == _capacity) grow(1);
+      if (_start) _start[_length] = c;
       _length++;
     }
 
+    FORCE_INLINE void append(const char* chars, size_t length) {
+      if (_capacity - _length < length) grow(length);
+      if (_start) memcpy(_start + _length, chars, length);
+      _length += length;
+    }
+
     const char* c_str() {
       append(0);
+      if (_start) _parent->release(_start + _length, _start + _capacity);
       return _start;
     }
 
    private:
+    // Makes room for the specified number of chars after the current ones.
+    void grow(size_t chars) {
+      size_t capacity;
+      char* newStart = _parent->reserve(2 * _length + chars, capacity);
+      if (_start && newStart) memcpy(newStart, _start, _length);
+      _start = newStart;
+      // a failed string stays NULL, and never grows again
+      _capacity = newStart ? capacity : static_cast<size_t>(-1);
+    }
+
     DynamicJsonBufferBase* _parent;
     char* _start;
-    int _length;
+    size_t _length;
+    size_t _capacity;
   };
 
   String startString() {
@@ -121,26 +143,64 @@ class DynamicJsonBufferBase
   }
 
   void* allocInNewBlock(size_t bytes) {
-    size_t capacity = _nextBlockCapacity;
-    if (bytes > capacity) capacity = bytes;
-    if (!addNewBlock(capacity)) return NULL;
-    _nextBlockCapacity *= 2;
+    if (!addNewBlock(bytes)) return NULL;
     return allocInHead(bytes);
   }
 
-  bool addNewBlock(size_t capacity) {
-    size_t bytes = sizeof(EmptyBlock) + capacity;
-    Block* block = static_cast<Block*>(_allocator.allocate(bytes));
-    if (block == NULL) return false;
-    block->capacity = capacity;
-    block->size = 0;
+  // Allocates all the free space of the head block, or of a new block if
+  // there is less than the specified number of bytes.
+  char* reserve(size_t bytes, size_t& reserved) {
+    if (!canAllocInHead(bytes) && !addNewBlock(bytes)) return NULL;
+    reserved = _head->capacity - _head->size;
+    return static_cast<char*>(allocInHead(reserved));
+  }
+
+  // Gives back the end of the last allocation, from end to reservedEnd.
+  void release(char* end, char* reservedEnd) {
+    if (!_head) return;
+    char* data = reinterpret_cast<char*>(_head->data);
+    if (data + _head->size == reservedEnd)
+      _head->size = static_cast<size_t>(end - data);
+  }
+
+  // Takes a free block that can hold the specified number of bytes, or
+  // allocates one.
+  bool addNewBlock(size_t bytes) {
+    Block** link = &_free;
+    while (*link && (*link)->capacity < bytes) link = &(*link)->next;
+    Block* block = *link;
+    if (block) {
+      *link = block->next;
+    } else {
+      size_t capacity = _nextBlockCapacity;
+      if (bytes > capacity) capacity = bytes;
+      block = static_cast<Block*>(
+          _allocator.allocate(sizeof(EmptyBlock) + capacity));
+      if (block == NULL) return false;
+      block->capacity = capacity;
+      block->size = 0;
+      if (_nextBlockCapacity < ARDUINOJSON_DYNAMIC_BLOCK_MAX_CAPACITY / 2)
+        _nextBlockCapacity *= 2;
+      else
+        _nextBlockCapacity = ARDUINOJSON_DYNAMIC_BLOCK_MAX_CAPACITY;
+    }
     block->next = _head;
     _head = block;
     return true;
   }
 
+  void freeBlocks(Block* block) {
+    while (block != NULL) {
+      Block* nextBlock = block->next;
+      _allocator.deallocate(block);
+      block = nextBlock;
+    }
+  }
+
   TAllocator _allocator;
   Block* _head;
+  // the blocks that reset() kept
+  Block* _free;
   size_t _nextBlockCapacity;
 };
 
@@ -17,6 +17,7 @@
 #include "TypeTraits/EnableIf.hpp"
 #include "TypeTraits/IsArray.hpp"
 #include "TypeTraits/IsFloatingPoint.hpp"
+#include "TypeTraits/IsIntegral.hpp"
 #include "TypeTraits/IsSame.hpp"
 
 // Returns the size (in bytes) of an array with n elements.
@@ -112,6 +113,11 @@ class JsonArray : public Internals::JsonPrintable<JsonArray>,
   template <typename T>
   typename Internals::JsonVariantAs<T>::type get(size_t index) const {
     node_type *node = findNode(index);
+#if ARDUINOJSON_ENABLE_NUMBER_CACHE
+    if (node && (TypeTraits::IsIntegral<T>::value ||
+                 TypeTraits::IsFloatingPoint<T>::value))
+      node->content.cacheInteger();
+#endif
     return node ? node->content.as<T>()
                 : Internals::JsonVariantDefault<T>::get();
   }
@@ -8,6 +8,8 @@
 #pragma once
 
 #include "Deserialization/JsonParser.hpp"
+#include "Deserialization/MsgPackParser.hpp"
+#include "TypeTraits/IsChar.hpp"
 
 #if defined(__clang__)
 #pragma clang diagnostic push
@@ -61,6 +63,74 @@ class JsonBufferBase : public JsonBuffer {
     return Internals::makeParser(that(), json, nestingLimit).parseArray();
   }
 
+  // Allocates and populate a JsonArray with the values of a JSON string that
+  // match a JsonFilter.
+  //
+  // The other values are skipped without using the JsonBuffer, so its size
+  // depends on the filter, not on the document.
+  //
+  // JsonArray& parseArray(TString, const JsonFilter&);
+  // TString = const std::string&, const String&
+  template <typename TString>
+  typename TypeTraits::EnableIf<!TypeTraits::IsArray<TString>::value,
+                                JsonArray &>::type
+  parseArray(const TString &json, const JsonFilter &filter,
+             uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::makeParser(that(), json, nestingLimit)
+        .parseArray(filter);
+  }
+  //
+  // JsonArray& parseArray(TString, const JsonFilter&);
+  // TString = const char*, const char[N], const FlashStringHelper*
+  template <typename TString>
+  JsonArray &parseArray(
+      TString *json, const JsonFilter &filter,
+      uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::makeParser(that(), json, nestingLimit)
+        .parseArray(filter);
+  }
+  //
+  // JsonArray& parseArray(TString, const JsonFilter&);
+  // TString = std::istream&, Stream&
+  template <typename TString>
+  JsonArray &parseArray(
+      TString &json, const JsonFilter &filter,
+      uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::makeParser(that(), json, nestingLimit)
+        .parseArray(filter);
+  }
+
+  // Allocates and populate a JsonArray from a JSON string that isn't
+  // terminated by a zero, like the payload of a network packet.
+  //
+  // The parser doesn't read beyond json + length.
+  // A writable string is modified in place, as above, without copying the
+  // strings in the JsonBuffer; a const string is copied.
+  // It has its own name because the second argument of parseArray() is the
+  // nesting limit.
+  //
+  // JsonArray& parseArrayN(TChar*, size_t);
+  // TChar = char, unsigned char, const char, const unsigned char
+  template <typename TChar>
+  typename TypeTraits::EnableIf<TypeTraits::IsChar<TChar>::value,
+                                JsonArray &>::type
+  parseArrayN(TChar *json, size_t length,
+              uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::makeParser(that(), json, length, nestingLimit)
+        .parseArray();
+  }
+  //
+  // JsonArray& parseArrayN(TChar*, size_t, const JsonFilter&);
+  // TChar = char, unsigned char, const char, const unsigned char
+  template <typename TChar>
+  typename TypeTraits::EnableIf<TypeTraits::IsChar<TChar>::value,
+                                JsonArray &>::type
+  parseArrayN(TChar *json, size_t length, const JsonFilter &filter,
+              uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::makeParser(that(), json, length, nestingLimit)
+        .parseArray(filter);
+  }
+
   // Allocates and populate a JsonObject from a JSON string.
   //
   // The First argument is a pointer to the JSON string, the memory must be
@@ -98,6 +168,74 @@ class JsonBufferBase : public JsonBuffer {
     return Internals::makeParser(that(), json, nestingLimit).parseObject();
   }
 
+  // Allocates and populate a JsonObject with the values of a JSON string that
+  // match a JsonFilter.
+  //
+  // The other values are skipped without using the JsonBuffer, so its size
+  // depends on the filter, not on the document.
+  //
+  // JsonObject& parseObject(TString, const JsonFilter&);
+  // TString = const std::string&, const String&
+  template <typename TString>
+  typename TypeTraits::EnableIf<!TypeTraits::IsArray<TString>::value,
+                                JsonObject &>::type
+  parseObject(const TString &json, const JsonFilter &filter,
+              uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::makeParser(that(), json, nestingLimit)
+        .parseObject(filter);
+  }
+  //
+  // JsonObject& parseObject(TString, const JsonFilter&);
+  // TString = const char*, const char[N], const FlashStringHelper*
+  template <typename TString>
+  JsonObject &parseObject(
+      TString *json, const JsonFilter &filter,
+      uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::makeParser(that(), json, nestingLimit)
+        .parseObject(filter);
+  }
+  //
+  // JsonObject& parseObject(TString, const JsonFilter&);
+  // TString = std::istream&, Stream&
+  template <typename TString>
+  JsonObject &parseObject(
+      TString &json, const JsonFilter &filter,
+      uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::makeParser(that(), json, nestingLimit)
+        .parseObject(filter);
+  }
+
+  // Allocates and populate a JsonObject from a JSON string that isn't
+  // terminated by a zero, like the payload of a network packet.
+  //
+  // The parser doesn't read beyond json + length.
+  // A writable string is modified in place, as above, without copying the
+  // strings in the JsonBuffer; a const string is copied.
+  // It has its own name because the second argument of parseObject() is the
+  // nesting limit.
+  //
+  // JsonObject& parseObjectN(TChar*, size_t);
+  // TChar = char, unsigned char, const char, const unsigned char
+  template <typename TChar>
+  typename TypeTraits::EnableIf<TypeTraits::IsChar<TChar>::value,
+                                JsonObject &>::type
+  parseObjectN(TChar *json, size_t length,
+               uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::makeParser(that(), json, length, nestingLimit)
+        .parseObject();
+  }
+  //
+  // JsonObject& parseObjectN(TChar*, size_t, const JsonFilter&);
+  // TChar = char, unsigned char, const char, const unsigned char
+  template <typename TChar>
+  typename TypeTraits::EnableIf<TypeTraits::IsChar<TChar>::value,
+                                JsonObject &>::type
+  parseObjectN(TChar *json, size_t length, const JsonFilter &filter,
+               uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::makeParser(that(), json, length, nestingLimit)
+        .parseObject(filter);
+  }
+
   // Generalized version of parseArray() and parseObject(), also works for
   // integral types.
   //
@@ -126,6 +264,39 @@ class JsonBufferBase : public JsonBuffer {
                     uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
     return Internals::makeParser(that(), json, nestingLimit).parseVariant();
   }
+  //
+  // JsonVariant parseN(TChar*, size_t);
+  // TChar = char, unsigned char, const char, const unsigned char
+  // Like parseObjectN(), for a string that isn't terminated by a zero.
+  // A value that is neither an object nor an array is copied in the
+  // JsonBuffer, since its terminating zero may not fit in the string.
+  template <typename TChar>
+  typename TypeTraits::EnableIf<TypeTraits::IsChar<TChar>::value,
+                                JsonVariant>::type
+  parseN(TChar *json, size_t length,
+         uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::parseBoundedVariant(that(), json, length, nestingLimit);
+  }
+
+  // Allocates and populate a JsonVariant from MessagePack
+  // (https://msgpack.org), like the payload of a network packet.
+  //
+  // Like with parseN(), a writable buffer is modified in place
+  // and a const buffer is copied in the JsonBuffer.
+  // The strings end at their first zero byte, and the nil values are read
+  // like a JSON null. The bin and ext types aren't supported and fail the
+  // parsing.
+  //
+  // JsonVariant parseMsgPack(TChar*, size_t);
+  // TChar = char, unsigned char, const char, const unsigned char
+  template <typename TChar>
+  typename TypeTraits::EnableIf<TypeTraits::IsChar<TChar>::value,
+                                JsonVariant>::type
+  parseMsgPack(TChar *data, size_t length,
+               uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::makeMsgPackParser(that(), data, length, nestingLimit)
+        .parseVariant();
+  }
 
  private:
   TDerived *that() {
@@ -0,0 +1,53 @@
+// Copyright Benoit Blanchon 2014-2017
+// MIT License
+//
+// Arduino JSON library
+// https://github.com/bblanchon/ArduinoJson
+// If you like this project, please add a star!
+
+#pragma once
+
+#include <stddef.h>  // for size_t
+
+#include "Configuration.hpp"
+
+namespace ArduinoJson {
+
+// The paths of the values that JsonBuffer::parseObject() and parseArray()
+// keep when they get a filter. Everything else is skipped by the parser,
+// without allocating nodes or copying strings in the JsonBuffer.
+//
+// A path is a list of keys separated by dots, "*" matches any key and any
+// element of an array:
+//
+//   const char* paths[] = {"state.move", "state.height", "sensors.*.value"};
+//   JsonObject& root = jsonBuffer.parseObject(json, JsonFilter(paths));
+//
+// A path selects the whole value at its end. The objects and arrays on the
+// way to it are kept, with only the selected members.
+// Keys with a '.' can only be matched by "*".
+// The filter doesn't copy the paths, they must live until the parsing is done.
+// Only the first ARDUINOJSON_FILTER_MAX_PATHS paths are used.
+class JsonFilter {
+ public:
+  template <size_t N>
+  explicit JsonFilter(const char* const (&paths)[N])
+      : _paths(paths), _count(N) {}
+
+  JsonFilter(const char* const* paths, size_t count)
+      : _paths(paths), _count(count) {}
+
+  size_t count() const {
+    return _count < ARDUINOJSON_FILTER_MAX_PATHS ? _count
+                                                 : ARDUINOJSON_FILTER_MAX_PATHS;
+  }
+
+  const char* path(size_t index) const {
+    return _paths[index];
+  }
+
+ private:
+  const char* const* _paths;
+  size_t _count;
+};
+}
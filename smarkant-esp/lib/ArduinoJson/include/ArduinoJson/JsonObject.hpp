@@ -8,6 +8,7 @@
 #pragma once
 
 #include "Data/JsonBufferAllocated.hpp"
+#include "Data/JsonObjectIndex.hpp"
 #include "Data/List.hpp"
 #include "Data/ReferenceType.hpp"
 #include "Data/ValueSetter.hpp"
@@ -17,6 +18,7 @@
 #include "TypeTraits/EnableIf.hpp"
 #include "TypeTraits/IsArray.hpp"
 #include "TypeTraits/IsFloatingPoint.hpp"
+#include "TypeTraits/IsIntegral.hpp"
 #include "TypeTraits/IsSame.hpp"
 
 // Returns the size (in bytes) of an object with n elements.
@@ -44,7 +46,14 @@ class JsonObject : public Internals::JsonPrintable<JsonObject>,
   // Create an empty JsonArray attached to the specified JsonBuffer.
   // You should not use this constructor directly.
   // Instead, use JsonBuffer::createObject() or JsonBuffer.parseObject().
-  explicit JsonObject(JsonBuffer* buffer) : Internals::List<JsonPair>(buffer) {}
+  explicit JsonObject(JsonBuffer* buffer)
+      : Internals::List<JsonPair>(buffer)
+#if ARDUINOJSON_ENABLE_OBJECT_INDEX
+        ,
+        _index(NULL)
+#endif
+  {
+  }
 
   // Gets or sets the value associated with the specified key.
   //
@@ -287,6 +296,9 @@ class JsonObject : public Internals::JsonPrintable<JsonObject>,
   // Returns the list node that matches the specified key.
   template <typename TStringRef>
   node_type* findNode(TStringRef key) const {
+#if ARDUINOJSON_ENABLE_OBJECT_INDEX
+    if (_index) return _index->find<TStringRef>(key);
+#endif
     for (node_type* node = _firstNode; node; node = node->next) {
       if (Internals::StringTraits<TStringRef>::equals(key, node->content.key))
         return node;
@@ -298,6 +310,11 @@ class JsonObject : public Internals::JsonPrintable<JsonObject>,
   typename Internals::JsonVariantAs<TValue>::type get_impl(
       TStringRef key) const {
     node_type* node = findNode<TStringRef>(key);
+#if ARDUINOJSON_ENABLE_NUMBER_CACHE
+    if (node && (TypeTraits::IsIntegral<TValue>::value ||
+                 TypeTraits::IsFloatingPoint<TValue>::value))
+      node->content.value.cacheInteger();
+#endif
     return node ? node->content.value.as<TValue>()
                 : Internals::JsonVariantDefault<TValue>::get();
   }
@@ -312,11 +329,36 @@ class JsonObject : public Internals::JsonPrintable<JsonObject>,
       bool key_ok = Internals::ValueSetter<TStringRef>::set(
           _buffer, node->content.key, key);
       if (!key_ok) return false;
+#if ARDUINOJSON_ENABLE_OBJECT_INDEX
+      indexNode(node);
+#endif
     }
     return Internals::ValueSetter<TValueRef>::set(_buffer, node->content.value,
                                                   value);
   }
 
+  void removeNode(node_type* node) {
+    if (!node) return;
+    Internals::List<JsonPair>::removeNode(node);
+#if ARDUINOJSON_ENABLE_OBJECT_INDEX
+    // the index is rebuilt by the next insertion
+    _index = NULL;
+#endif
+  }
+
+#if ARDUINOJSON_ENABLE_OBJECT_INDEX
+  // Adds a new node to the index, creates the index once the object has
+  // enough keys, or rebuilds it when it is full.
+  // If the JsonBuffer is too small for the index, the object has none and
+  // findNode() walks the list.
+  void indexNode(node_type* node) {
+    if (_index && _index->insert(node)) return;
+    size_t count = size();
+    if (count < ARDUINOJSON_OBJECT_INDEX_THRESHOLD) return;
+    _index = Internals::JsonObjectIndex::create(_buffer, _firstNode, count);
+  }
+#endif
+
   template <typename TStringRef, typename TValue>
   bool is_impl(TStringRef key) const {
     node_type* node = findNode<TStringRef>(key);
@@ -328,6 +370,10 @@ class JsonObject : public Internals::JsonPrintable<JsonObject>,
 
   template <typename TStringRef>
   JsonObject& createNestedObject_impl(TStringRef key);
+
+#if ARDUINOJSON_ENABLE_OBJECT_INDEX
+  Internals::JsonObjectIndex* _index;
+#endif
 };
 
 namespace Internals {
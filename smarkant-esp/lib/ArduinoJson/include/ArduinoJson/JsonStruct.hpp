@@ -0,0 +1,112 @@
+// Copyright Benoit Blanchon 2014-2017
+// MIT License
+//
+// Arduino JSON library
+// https://github.com/bblanchon/ArduinoJson
+// If you like this project, please add a star!
+
+#pragma once
+
+#include "Deserialization/JsonParser.hpp"
+#include "Serialization/JsonPrintable.hpp"
+#include "TypeTraits/EnableIf.hpp"
+#include "TypeTraits/IsArray.hpp"
+#include "TypeTraits/IsChar.hpp"
+
+namespace ArduinoJson {
+
+// Binds the keys of a JSON object to the members of a struct, so that the
+// object is parsed straight into the struct, and the struct printed as the
+// object, without a JsonBuffer.
+//
+// The struct lists its fields, with the key and the member of each, in a
+// static function template:
+//
+//   struct MoveRequest {
+//     char move[10];
+//     int height;
+//     bool hasHeight;
+//
+//     template <typename TFields>
+//     static void jsonFields(TFields& fields) {
+//       fields("move", &MoveRequest::move);
+//       fields("height", &MoveRequest::height, &MoveRequest::hasHeight);
+//     }
+//   };
+//
+//   MoveRequest request = MoveRequest();
+//   JsonStruct<MoveRequest> json(request);
+//   if (json.parse(payload)) ...
+//   json.printTo(Serial);
+//
+// A field is a bool, an integer, a float, a char array, or another struct
+// with a jsonFields() for a nested object. A const char* can only be printed,
+// parsing it, or using a field of another type, fails the compilation.
+// The optional bool member tells if the key was in the object, printTo()
+// skips the field when it's false.
+//
+// The keys without a field are skipped, and a field whose key isn't in the
+// object keeps its value. The values are converted like JsonVariant::as<T>()
+// converts them, but a string that doesn't fit in its char array, an object
+// or an array for a field that isn't a struct, a value for a struct, or a
+// missing value, fail the parsing.
+template <typename T>
+class JsonStruct : public Internals::JsonPrintable<JsonStruct<T> > {
+ public:
+  explicit JsonStruct(T &value) : _value(value) {}
+
+  // Parses a JSON object in the fields of the struct.
+  // Returns false if the JSON is invalid, the fields can then have been
+  // partially written.
+  //
+  // bool parse(TString);
+  // TString = const std::string&, const String&
+  template <typename TString>
+  typename TypeTraits::EnableIf<!TypeTraits::IsArray<TString>::value,
+                                bool>::type
+  parse(const TString &json,
+        uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::makeStructParser(json, nestingLimit).parseStruct(_value);
+  }
+  //
+  // bool parse(TString);
+  // TString = const char*, const char[N], const FlashStringHelper*
+  template <typename TString>
+  bool parse(TString *json,
+             uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::makeStructParser(json, nestingLimit).parseStruct(_value);
+  }
+  //
+  // bool parse(TString);
+  // TString = std::istream&, Stream&
+  template <typename TString>
+  bool parse(TString &json,
+             uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::makeStructParser(json, nestingLimit).parseStruct(_value);
+  }
+
+  // Parses a string that isn't terminated by a zero, without reading beyond
+  // json + length. The string isn't modified.
+  // Like JsonBuffer::parseObjectN(), it has its own name because the second
+  // argument of parse() is the nesting limit.
+  //
+  // bool parseN(TChar*, size_t);
+  // TChar = char, unsigned char, const char, const unsigned char
+  template <typename TChar>
+  typename TypeTraits::EnableIf<TypeTraits::IsChar<TChar>::value, bool>::type
+  parseN(TChar *json, size_t length,
+         uint8_t nestingLimit = ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
+    return Internals::makeStructParser(json, length, nestingLimit)
+        .parseStruct(_value);
+  }
+
+  const T &value() const {
+    return _value;
+  }
+
+ private:
+  JsonStruct &operator=(const JsonStruct &);
+
+  T &_value;
+};
+}
@@ -42,6 +42,10 @@ class JsonObject;
 class JsonVariant : public JsonVariantBase<JsonVariant> {
   friend void Internals::JsonSerializer::serialize(const JsonVariant &,
                                                    JsonWriter &);
+  friend void Internals::MsgPackSerializer::serialize(const JsonVariant &,
+                                                      MsgPackWriter &);
+  friend class JsonArray;
+  friend class JsonObject;
 
  public:
   // Creates an uninitialized JsonVariant
@@ -57,11 +61,12 @@ class JsonVariant : public JsonVariantBase<JsonVariant> {
 
   // Create a JsonVariant containing a floating point value.
   // The second argument specifies the number of decimal digits to write in
-  // the JSON string.
+  // the JSON string. By default, it's the shortest number that reads back as
+  // the same value.
   // JsonVariant(double value, uint8_t decimals);
   // JsonVariant(float value, uint8_t decimals);
   template <typename T>
-  JsonVariant(T value, uint8_t decimals = 2,
+  JsonVariant(T value, uint8_t decimals = Internals::JSON_FLOAT_SHORTEST,
               typename TypeTraits::EnableIf<
                   TypeTraits::IsFloatingPoint<T>::value>::type * = 0) {
     using namespace Internals;
@@ -85,6 +90,9 @@ class JsonVariant : public JsonVariantBase<JsonVariant> {
       _type = JSON_NEGATIVE_INTEGER;
       _content.asInteger = static_cast<JsonUInt>(-value);
     }
+#if ARDUINOJSON_ENABLE_NUMBER_CACHE
+    _cachedText = NULL;
+#endif
   }
   // JsonVariant(unsigned short)
   // JsonVariant(unsigned int)
@@ -96,6 +104,9 @@ class JsonVariant : public JsonVariantBase<JsonVariant> {
     using namespace Internals;
     _type = JSON_POSITIVE_INTEGER;
     _content.asInteger = static_cast<JsonUInt>(value);
+#if ARDUINOJSON_ENABLE_NUMBER_CACHE
+    _cachedText = NULL;
+#endif
   }
 
   // Create a JsonVariant containing a string.
@@ -328,6 +339,9 @@ class JsonVariant : public JsonVariantBase<JsonVariant> {
   bool isBoolean() const;
   bool isFloat() const;
   bool isInteger() const;
+#if ARDUINOJSON_ENABLE_NUMBER_CACHE
+  void cacheInteger();
+#endif
   bool isArray() const {
     return _type == Internals::JSON_ARRAY;
   }
@@ -345,6 +359,12 @@ class JsonVariant : public JsonVariantBase<JsonVariant> {
 
   // The various alternatives for the value of the variant.
   Internals::JsonVariantContent _content;
+
+#if ARDUINOJSON_ENABLE_NUMBER_CACHE
+  // The text of an integer replaced by cacheInteger(), NULL for an integer
+  // that was set as a number (only read while _type is an integer)
+  const char *_cachedText;
+#endif
 };
 
 inline JsonVariant float_with_n_digits(float value, uint8_t digits) {
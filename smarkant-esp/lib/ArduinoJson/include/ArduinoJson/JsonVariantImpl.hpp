@@ -92,6 +92,10 @@ inline const char *JsonVariant::variantAsString() const {
       !strcmp("null", _content.asString))
     return NULL;
   if (_type == JSON_STRING || _type == JSON_UNPARSED) return _content.asString;
+#if ARDUINOJSON_ENABLE_NUMBER_CACHE
+  if (_type == JSON_POSITIVE_INTEGER || _type == JSON_NEGATIVE_INTEGER)
+    return _cachedText;
+#endif
   return NULL;
 }
 
@@ -150,6 +154,23 @@ inline bool JsonVariant::isFloat() const {
   return *end == '\0' && errno == 0 && !is<long>();
 }
 
+#if ARDUINOJSON_ENABLE_NUMBER_CACHE
+// Replaces an unparsed integer with its value, so that the next reads don't
+// parse it again. The text is kept for as<const char*>().
+// Only the integers that JsonWriter writes as they were are replaced, a float
+// would be written with other digits.
+inline void JsonVariant::cacheInteger() {
+  using namespace Internals;
+  if (_type != JSON_UNPARSED || !_content.asString) return;
+  JsonUInt value;
+  bool negative;
+  if (!parseCanonicalInteger(_content.asString, value, negative)) return;
+  _cachedText = _content.asString;
+  _type = negative ? JSON_NEGATIVE_INTEGER : JSON_POSITIVE_INTEGER;
+  _content.asInteger = value;
+}
+#endif
+
 #if ARDUINOJSON_ENABLE_STD_STREAM
 inline std::ostream &operator<<(std::ostream &os, const JsonVariant &source) {
   return source.printTo(os);
@@ -0,0 +1,18 @@
+// Copyright Benoit Blanchon 2014-2017
+// MIT License
+//
+// Arduino JSON library
+// https://github.com/bblanchon/ArduinoJson
+// If you like this project, please add a star!
+
+#pragma once
+
+// static_assert() when it's available, otherwise an array of negative size,
+// whose name gives the message
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+#define ARDUINOJSON_STATIC_ASSERT(condition, name, message) \
+  static_assert(condition, message)
+#else
+#define ARDUINOJSON_STATIC_ASSERT(condition, name, message) \
+  typedef char name[(condition) ? 1 : -1]
+#endif
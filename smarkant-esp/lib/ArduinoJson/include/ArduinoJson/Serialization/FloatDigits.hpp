@@ -0,0 +1,301 @@
+// Copyright Benoit Blanchon 2014-2017
+// MIT License
+//
+// Arduino JSON library
+// https://github.com/bblanchon/ArduinoJson
+// If you like this project, please add a star!
+
+#pragma once
+
+#include <stdint.h>  // for uint32_t, uint64_t
+#include <string.h>  // for memcpy
+
+namespace ArduinoJson {
+namespace Internals {
+
+// A power of ten, with a 64-bit significand: 10^k ~= f * 2^e
+struct CachedPower {
+  uint64_t f;
+  int16_t e;
+  int16_t k;
+};
+
+// The layout of a floating point type, and the powers of ten that its
+// exponents need.
+// The powers are a step of 8 apart, index i is 10^(8 * i - 300).
+template <typename TFloat>
+struct FloatBits;
+
+template <>
+struct FloatBits<float> {
+  typedef uint32_t bits_type;
+  static const int precision = 24;  // including the hidden bit
+  static const int bias = 150;
+
+  static const CachedPower &cachedPower(int index) {
+    static const CachedPower powers[] = {
+      {0xAA242499697392D3ULL, -183, -36},
+      {0xFD87B5F28300CA0EULL, -157, -28},
+      {0xBCE5086492111AEBULL, -130, -20},
+      {0x8CBCCC096F5088CCULL, -103, -12},
+      {0xD1B71758E219652CULL, -77, -4},
+      {0x9C40000000000000ULL, -50, 4},
+      {0xE8D4A51000000000ULL, -24, 12},
+      {0xAD78EBC5AC620000ULL, 3, 20},
+      {0x813F3978F8940984ULL, 30, 28},
+      {0xC097CE7BC90715B3ULL, 56, 36},
+      {0x8F7E32CE7BEA5C70ULL, 83, 44},
+      {0xD5D238A4ABE98068ULL, 109, 52},
+    };
+    return powers[index - 33];
+  }
+};
+
+template <>
+struct FloatBits<double> {
+  typedef uint64_t bits_type;
+  static const int precision = 53;  // including the hidden bit
+  static const int bias = 1075;
+
+  static const CachedPower &cachedPower(int index) {
+    static const CachedPower powers[] = {
+      {0xAB70FE17C79AC6CAULL, -1060, -300},
+      {0xFF77B1FCBEBCDC4FULL, -1034, -292},
+      {0xBE5691EF416BD60CULL, -1007, -284},
+      {0x8DD01FAD907FFC3CULL, -980, -276},
+      {0xD3515C2831559A83ULL, -954, -268},
+      {0x9D71AC8FADA6C9B5ULL, -927, -260},
+      {0xEA9C227723EE8BCBULL, -901, -252},
+      {0xAECC49914078536DULL, -874, -244},
+      {0x823C12795DB6CE57ULL, -847, -236},
+      {0xC21094364DFB5637ULL, -821, -228},
+      {0x9096EA6F3848984FULL, -794, -220},
+      {0xD77485CB25823AC7ULL, -768, -212},
+      {0xA086CFCD97BF97F4ULL, -741, -204},
+      {0xEF340A98172AACE5ULL, -715, -196},
+      {0xB23867FB2A35B28EULL, -688, -188},
+      {0x84C8D4DFD2C63F3BULL, -661, -180},
+      {0xC5DD44271AD3CDBAULL, -635, -172},
+      {0x936B9FCEBB25C996ULL, -608, -164},
+      {0xDBAC6C247D62A584ULL, -582, -156},
+      {0xA3AB66580D5FDAF6ULL, -555, -148},
+      {0xF3E2F893DEC3F126ULL, -529, -140},
+      {0xB5B5ADA8AAFF80B8ULL, -502, -132},
+      {0x87625F056C7C4A8BULL, -475, -124},
+      {0xC9BCFF6034C13053ULL, -449, -116},
+      {0x964E858C91BA2655ULL, -422, -108},
+      {0xDFF9772470297EBDULL, -396, -100},
+      {0xA6DFBD9FB8E5B88FULL, -369, -92},
+      {0xF8A95FCF88747D94ULL, -343, -84},
+      {0xB94470938FA89BCFULL, -316, -76},
+      {0x8A08F0F8BF0F156BULL, -289, -68},
+      {0xCDB02555653131B6ULL, -263, -60},
+      {0x993FE2C6D07B7FACULL, -236, -52},
+      {0xE45C10C42A2B3B06ULL, -210, -44},
+      {0xAA242499697392D3ULL, -183, -36},
+      {0xFD87B5F28300CA0EULL, -157, -28},
+      {0xBCE5086492111AEBULL, -130, -20},
+      {0x8CBCCC096F5088CCULL, -103, -12},
+      {0xD1B71758E219652CULL, -77, -4},
+      {0x9C40000000000000ULL, -50, 4},
+      {0xE8D4A51000000000ULL, -24, 12},
+      {0xAD78EBC5AC620000ULL, 3, 20},
+      {0x813F3978F8940984ULL, 30, 28},
+      {0xC097CE7BC90715B3ULL, 56, 36},
+      {0x8F7E32CE7BEA5C70ULL, 83, 44},
+      {0xD5D238A4ABE98068ULL, 109, 52},
+      {0x9F4F2726179A2245ULL, 136, 60},
+      {0xED63A231D4C4FB27ULL, 162, 68},
+      {0xB0DE65388CC8ADA8ULL, 189, 76},
+      {0x83C7088E1AAB65DBULL, 216, 84},
+      {0xC45D1DF942711D9AULL, 242, 92},
+      {0x924D692CA61BE758ULL, 269, 100},
+      {0xDA01EE641A708DEAULL, 295, 108},
+      {0xA26DA3999AEF774AULL, 322, 116},
+      {0xF209787BB47D6B85ULL, 348, 124},
+      {0xB454E4A179DD1877ULL, 375, 132},
+      {0x865B86925B9BC5C2ULL, 402, 140},
+      {0xC83553C5C8965D3DULL, 428, 148},
+      {0x952AB45CFA97A0B3ULL, 455, 156},
+      {0xDE469FBD99A05FE3ULL, 481, 164},
+      {0xA59BC234DB398C25ULL, 508, 172},
+      {0xF6C69A72A3989F5CULL, 534, 180},
+      {0xB7DCBF5354E9BECEULL, 561, 188},
+      {0x88FCF317F22241E2ULL, 588, 196},
+      {0xCC20CE9BD35C78A5ULL, 614, 204},
+      {0x98165AF37B2153DFULL, 641, 212},
+      {0xE2A0B5DC971F303AULL, 667, 220},
+      {0xA8D9D1535CE3B396ULL, 694, 228},
+      {0xFB9B7CD9A4A7443CULL, 720, 236},
+      {0xBB764C4CA7A44410ULL, 747, 244},
+      {0x8BAB8EEFB6409C1AULL, 774, 252},
+      {0xD01FEF10A657842CULL, 800, 260},
+      {0x9B10A4E5E9913129ULL, 827, 268},
+      {0xE7109BFBA19C0C9DULL, 853, 276},
+      {0xAC2820D9623BF429ULL, 880, 284},
+      {0x80444B5E7AA7CF85ULL, 907, 292},
+      {0xBF21E44003ACDD2DULL, 933, 300},
+      {0x8E679C2F5E44FF8FULL, 960, 308},
+      {0xD433179D9C8CB841ULL, 986, 316},
+      {0x9E19DB92B4E31BA9ULL, 1013, 324},
+    };
+    return powers[index];
+  }
+};
+
+// The shortest decimal digits of a positive and finite number that read back
+// as the same number: value = digits * 10^exponent.
+//
+// This is the Grisu2 algorithm from Florian Loitsch, "Printing Floating-Point
+// Numbers Quickly and Accurately with Integers" (PLDI 2010). It only uses
+// integers, which is much faster on a chip without an FPU, like the ESP8266.
+// The digits always round-trip, and for a few numbers there is one more than
+// the shortest.
+template <typename TFloat>
+class FloatDigits {
+ public:
+  explicit FloatDigits(TFloat value) : _length(0) {
+    typedef FloatBits<TFloat> traits;
+    typename traits::bits_type bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint64_t hiddenBit = uint64_t(1) << (traits::precision - 1);
+    const uint64_t fraction = bits & (hiddenBit - 1);
+    const int exponent = static_cast<int>(bits >> (traits::precision - 1));
+
+    // the number and the middles between it and its neighbors
+    DiyFp v = exponent == 0 ? DiyFp(fraction, 1 - traits::bias)
+                            : DiyFp(fraction + hiddenBit,
+                                    exponent - traits::bias);
+    DiyFp plus = normalize(DiyFp(2 * v.f + 1, v.e - 1));
+    // the lower neighbor is closer at a power of two
+    DiyFp minus = fraction == 0 && exponent > 1
+                      ? DiyFp(4 * v.f - 1, v.e - 2)
+                      : DiyFp(2 * v.f - 1, v.e - 1);
+    minus = DiyFp(minus.f << (minus.e - plus.e), plus.e);
+    v = normalize(v);
+
+    // scale by a power of ten, so that the exponent is in [-60, -32]
+    const int f = -61 - plus.e;
+    const int k = (f * 78913) / (1 << 18) + (f > 0 ? 1 : 0);
+    const CachedPower &cached = traits::cachedPower((300 + k + 7) / 8);
+    const DiyFp c(cached.f, cached.e);
+    _exponent = -cached.k;
+
+    DiyFp w = multiply(v, c);
+    DiyFp lower = multiply(minus, c);
+    DiyFp upper = multiply(plus, c);
+    // the products are off by one at most, stay inside of the interval
+    lower.f++;
+    upper.f--;
+    generate(lower, w, upper);
+  }
+
+  const char *digits() const {
+    return _digits;
+  }
+
+  int length() const {
+    return _length;
+  }
+
+  int exponent() const {
+    return _exponent;
+  }
+
+ private:
+  // a number f * 2^e
+  struct DiyFp {
+    DiyFp(uint64_t f_, int e_) : f(f_), e(e_) {}
+    uint64_t f;
+    int e;
+  };
+
+  // shifts the highest bit to bit 63, f must not be 0
+  static DiyFp normalize(DiyFp x) {
+    for (int shift = 32; shift > 0; shift /= 2) {
+      if ((x.f >> (64 - shift)) == 0) {
+        x.f <<= shift;
+        x.e -= shift;
+      }
+    }
+    return x;
+  }
+
+  // the upper 64 bits of the product, rounded
+  static DiyFp multiply(const DiyFp &x, const DiyFp &y) {
+    const uint64_t xLow = x.f & 0xffffffff;
+    const uint64_t xHigh = x.f >> 32;
+    const uint64_t yLow = y.f & 0xffffffff;
+    const uint64_t yHigh = y.f >> 32;
+
+    const uint64_t lowLow = xLow * yLow;
+    const uint64_t lowHigh = xLow * yHigh;
+    const uint64_t highLow = xHigh * yLow;
+    const uint64_t highHigh = xHigh * yHigh;
+
+    uint64_t middle = (lowLow >> 32) + (lowHigh & 0xffffffff) +
+                      (highLow & 0xffffffff) + (uint64_t(1) << 31);
+    return DiyFp(highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32),
+                 x.e + y.e + 64);
+  }
+
+  // Writes the digits of upper until the rest is within the interval, then
+  // moves the last one closer to w.
+  void generate(const DiyFp &lower, const DiyFp &w, const DiyFp &upper) {
+    uint64_t delta = upper.f - lower.f;
+    uint64_t distance = upper.f - w.f;
+
+    const int shift = -upper.e;
+    const uint64_t one = uint64_t(1) << shift;
+    uint32_t integral = static_cast<uint32_t>(upper.f >> shift);
+    uint64_t fractional = upper.f & (one - 1);
+
+    uint32_t divisor = 1;
+    int n = 1;
+    while (n < 10 && integral >= divisor * 10) {
+      divisor *= 10;
+      n++;
+    }
+
+    while (n > 0) {
+      _digits[_length++] = static_cast<char>('0' + integral / divisor);
+      integral %= divisor;
+      n--;
+      uint64_t rest = (static_cast<uint64_t>(integral) << shift) + fractional;
+      if (rest <= delta) {
+        _exponent += n;
+        round(distance, delta, rest, static_cast<uint64_t>(divisor) << shift);
+        return;
+      }
+      divisor /= 10;
+    }
+
+    for (;;) {
+      fractional *= 10;
+      delta *= 10;
+      distance *= 10;
+      _digits[_length++] = static_cast<char>('0' + (fractional >> shift));
+      fractional &= one - 1;
+      _exponent--;
+      if (fractional <= delta) break;
+    }
+    round(distance, delta, fractional, one);
+  }
+
+  void round(uint64_t distance, uint64_t delta, uint64_t rest,
+             uint64_t unit) {
+    while (rest < distance && delta - rest >= unit &&
+           (rest + unit < distance ||
+            distance - rest > rest + unit - distance)) {
+      _digits[_length - 1]--;
+      rest += unit;
+    }
+  }
+
+  char _digits[18];
+  int _length;
+  int _exponent;
+};
+}
+}
@@ -14,6 +14,8 @@
 #include "IndentedPrint.hpp"
 #include "JsonSerializer.hpp"
 #include "JsonWriter.hpp"
+#include "MsgPackSerializer.hpp"
+#include "MsgPackWriter.hpp"
 #include "Prettyfier.hpp"
 #include "StaticStringBuilder.hpp"
 
@@ -99,6 +101,29 @@ class JsonPrintable {
     return prettyPrintTo(dp);
   }
 
+  // Writes the value in MessagePack instead of JSON.
+  // There is no overload for String, because the output has zero bytes.
+  size_t printMsgPackTo(Print &print) const {
+    MsgPackWriter writer(print);
+    MsgPackSerializer::serialize(downcast(), writer);
+    return writer.bytesWritten();
+  }
+
+  size_t printMsgPackTo(char *buffer, size_t bufferSize) const {
+    StaticStringBuilder sb(buffer, bufferSize);
+    return printMsgPackTo(sb);
+  }
+
+  template <size_t N>
+  size_t printMsgPackTo(char (&buffer)[N]) const {
+    return printMsgPackTo(buffer, N);
+  }
+
+  size_t measureMsgPackLength() const {
+    DummyPrint dp;
+    return printMsgPackTo(dp);
+  }
+
  private:
   const T &downcast() const {
     return *static_cast<const T *>(this);
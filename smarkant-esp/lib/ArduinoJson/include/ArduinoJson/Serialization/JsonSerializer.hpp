@@ -7,6 +7,11 @@
 
 #pragma once
 
+#include "../TypeTraits/EnableIf.hpp"
+#include "../TypeTraits/IsFloatingPoint.hpp"
+#include "../TypeTraits/IsIntegral.hpp"
+#include "../TypeTraits/IsJsonStruct.hpp"
+#include "../TypeTraits/IsSignedIntegral.hpp"
 #include "JsonWriter.hpp"
 
 namespace ArduinoJson {
@@ -16,6 +21,8 @@ class JsonArraySubscript;
 class JsonObject;
 template <typename TKey>
 class JsonObjectSubscript;
+template <typename T>
+class JsonStruct;
 class JsonVariant;
 
 namespace Internals {
@@ -27,7 +34,42 @@ class JsonSerializer {
   static void serialize(const JsonObject &, JsonWriter &);
   template <typename TKey>
   static void serialize(const JsonObjectSubscript<TKey> &, JsonWriter &);
+  template <typename T>
+  static void serialize(const JsonStruct<T> &, JsonWriter &);
   static void serialize(const JsonVariant &, JsonWriter &);
+
+ private:
+  // Called with each field of a struct, writes the key and the value.
+  template <typename TStruct>
+  class StructFieldWriter;
+
+  template <typename TStruct>
+  static void serializeStruct(const TStruct &, JsonWriter &);
+
+  static void serializeStructValue(bool, JsonWriter &);
+  static void serializeStructValue(const char *, JsonWriter &);
+  template <typename T>
+  static typename TypeTraits::EnableIf<
+      TypeTraits::IsSignedIntegral<T>::value>::type
+  serializeStructValue(T, JsonWriter &);
+  template <typename T>
+  static typename TypeTraits::EnableIf<
+      TypeTraits::IsIntegral<T>::value &&
+      !TypeTraits::IsSignedIntegral<T>::value>::type
+  serializeStructValue(T, JsonWriter &);
+  template <typename T>
+  static typename TypeTraits::EnableIf<
+      TypeTraits::IsFloatingPoint<T>::value>::type
+  serializeStructValue(T, JsonWriter &);
+  template <typename T>
+  static typename TypeTraits::EnableIf<TypeTraits::IsJsonStruct<T>::value>::type
+  serializeStructValue(const T &, JsonWriter &);
+  template <typename T>
+  static typename TypeTraits::EnableIf<
+      !TypeTraits::IsIntegral<T>::value &&
+      !TypeTraits::IsFloatingPoint<T>::value &&
+      !TypeTraits::IsJsonStruct<T>::value>::type
+  serializeStructValue(const T &, JsonWriter &);
 };
 }
 }
@@ -11,7 +11,9 @@
 #include "../JsonArraySubscript.hpp"
 #include "../JsonObject.hpp"
 #include "../JsonObjectSubscript.hpp"
+#include "../JsonStruct.hpp"
 #include "../JsonVariant.hpp"
+#include "../Polyfills/staticAssert.hpp"
 #include "JsonSerializer.hpp"
 
 inline void ArduinoJson::Internals::JsonSerializer::serialize(
@@ -61,6 +63,12 @@ inline void ArduinoJson::Internals::JsonSerializer::serialize(
   serialize(objectSubscript.template as<JsonVariant>(), writer);
 }
 
+template <typename T>
+inline void ArduinoJson::Internals::JsonSerializer::serialize(
+    const JsonStruct<T>& jsonStruct, JsonWriter& writer) {
+  serializeStruct(jsonStruct.value(), writer);
+}
+
 inline void ArduinoJson::Internals::JsonSerializer::serialize(
     const JsonVariant& variant, JsonWriter& writer) {
   switch (variant._type) {
@@ -99,3 +107,102 @@ inline void ArduinoJson::Internals::JsonSerializer::serialize(
       writer.writeFloat(variant._content.asFloat, decimals);
   }
 }
+
+template <typename TStruct>
+class ArduinoJson::Internals::JsonSerializer::StructFieldWriter {
+ public:
+  StructFieldWriter(const TStruct& object, JsonWriter& writer)
+      : _object(object), _writer(writer), _first(true) {}
+
+  template <typename TValue>
+  void operator()(const char* key, TValue TStruct::*member) {
+    if (!_first) _writer.writeComma();
+    _first = false;
+    _writer.writeString(key);
+    _writer.writeColon();
+    serializeStructValue(_object.*member, _writer);
+  }
+
+  template <typename TValue>
+  void operator()(const char* key, TValue TStruct::*member,
+                  bool TStruct::*present) {
+    if (_object.*present) (*this)(key, member);
+  }
+
+ private:
+  StructFieldWriter& operator=(const StructFieldWriter&);
+
+  const TStruct& _object;
+  JsonWriter& _writer;
+  bool _first;
+};
+
+template <typename TStruct>
+inline void ArduinoJson::Internals::JsonSerializer::serializeStruct(
+    const TStruct& object, JsonWriter& writer) {
+  writer.beginObject();
+  StructFieldWriter<TStruct> fields(object, writer);
+  TStruct::jsonFields(fields);
+  writer.endObject();
+}
+
+inline void ArduinoJson::Internals::JsonSerializer::serializeStructValue(
+    bool value, JsonWriter& writer) {
+  writer.writeBoolean(value);
+}
+
+inline void ArduinoJson::Internals::JsonSerializer::serializeStructValue(
+    const char* value, JsonWriter& writer) {
+  writer.writeString(value);
+}
+
+template <typename T>
+inline typename ArduinoJson::TypeTraits::EnableIf<
+    ArduinoJson::TypeTraits::IsSignedIntegral<T>::value>::type
+ArduinoJson::Internals::JsonSerializer::serializeStructValue(
+    T value, JsonWriter& writer) {
+  if (value < 0) {
+    writer.writeRaw('-');
+    writer.writeInteger(JsonUInt(0) - static_cast<JsonUInt>(value));
+  } else {
+    writer.writeInteger(static_cast<JsonUInt>(value));
+  }
+}
+
+template <typename T>
+inline typename ArduinoJson::TypeTraits::EnableIf<
+    ArduinoJson::TypeTraits::IsIntegral<T>::value &&
+    !ArduinoJson::TypeTraits::IsSignedIntegral<T>::value>::type
+ArduinoJson::Internals::JsonSerializer::serializeStructValue(
+    T value, JsonWriter& writer) {
+  writer.writeInteger(static_cast<JsonUInt>(value));
+}
+
+template <typename T>
+inline typename ArduinoJson::TypeTraits::EnableIf<
+    ArduinoJson::TypeTraits::IsFloatingPoint<T>::value>::type
+ArduinoJson::Internals::JsonSerializer::serializeStructValue(
+    T value, JsonWriter& writer) {
+  writer.writeFloat(static_cast<JsonFloat>(value));
+}
+
+template <typename T>
+inline typename ArduinoJson::TypeTraits::EnableIf<
+    ArduinoJson::TypeTraits::IsJsonStruct<T>::value>::type
+ArduinoJson::Internals::JsonSerializer::serializeStructValue(
+    const T& value, JsonWriter& writer) {
+  serializeStruct(value, writer);
+}
+
+template <typename T>
+inline typename ArduinoJson::TypeTraits::EnableIf<
+    !ArduinoJson::TypeTraits::IsIntegral<T>::value &&
+    !ArduinoJson::TypeTraits::IsFloatingPoint<T>::value &&
+    !ArduinoJson::TypeTraits::IsJsonStruct<T>::value>::type
+ArduinoJson::Internals::JsonSerializer::serializeStructValue(const T&,
+                                                             JsonWriter&) {
+  ARDUINOJSON_STATIC_ASSERT(
+      TypeTraits::IsJsonStruct<T>::value, JsonStruct_field_cannot_be_printed,
+      "JsonStruct can only print a bool, an integer, a float, a string or a "
+      "struct with jsonFields()");
+}
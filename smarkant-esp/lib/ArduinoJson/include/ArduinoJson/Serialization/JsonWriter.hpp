@@ -14,6 +14,7 @@
 #include "../Polyfills/math.hpp"
 #include "../Polyfills/normalize.hpp"
 #include "../Print.hpp"
+#include "FloatDigits.hpp"
 
 namespace ArduinoJson {
 namespace Internals {
@@ -81,7 +82,10 @@ class JsonWriter {
     }
   }
 
-  void writeFloat(JsonFloat value, uint8_t digits = 2) {
+  // Writes a float with the specified number of decimals, or with the
+  // shortest digits that read back as the same value if digits is
+  // JSON_FLOAT_SHORTEST.
+  void writeFloat(JsonFloat value, uint8_t digits = JSON_FLOAT_SHORTEST) {
     if (Polyfills::isNaN(value)) return writeRaw("NaN");
 
     if (value < 0.0) {
@@ -91,6 +95,8 @@ class JsonWriter {
 
     if (Polyfills::isInfinity(value)) return writeRaw("Infinity");
 
+    if (digits == JSON_FLOAT_SHORTEST) return writeShortestFloat(value);
+
     short powersOf10;
     if (value > 1000 || value < 0.001) {
       powersOf10 = Polyfills::normalize(value);
@@ -160,6 +166,55 @@ class JsonWriter {
  private:
   JsonWriter &operator=(const JsonWriter &);  // cannot be assigned
 
+  // Writes a positive and finite float with the fewest digits, without an
+  // exponent from 0.0001 to 999999999.
+  void writeShortestFloat(JsonFloat value) {
+    // an integer that a float holds exactly has no shorter form
+    if (value < 16777216) {
+      JsonUInt integer = static_cast<JsonUInt>(value);
+      if (static_cast<JsonFloat>(integer) == value)
+        return writeInteger(integer);
+    }
+
+    FloatDigits<JsonFloat> number(value);
+    const char *digits = number.digits();
+    int length = number.length();
+    // the position of the decimal point in the digits
+    int point = length + number.exponent();
+
+    char buffer[32];
+    char *ptr = buffer;
+    if (point > 0 && point <= 9) {
+      for (int i = 0; i < length; i++) {
+        if (i == point) *ptr++ = '.';
+        *ptr++ = digits[i];
+      }
+      for (int i = length; i < point; i++) *ptr++ = '0';
+    } else if (point > -4 && point <= 0) {
+      *ptr++ = '0';
+      *ptr++ = '.';
+      for (int i = point; i < 0; i++) *ptr++ = '0';
+      for (int i = 0; i < length; i++) *ptr++ = digits[i];
+    } else {
+      *ptr++ = digits[0];
+      if (length > 1) {
+        *ptr++ = '.';
+        for (int i = 1; i < length; i++) *ptr++ = digits[i];
+      }
+      *ptr++ = 'e';
+      int exponent = point - 1;
+      if (exponent < 0) {
+        *ptr++ = '-';
+        exponent = -exponent;
+      }
+      if (exponent >= 100) *ptr++ = static_cast<char>('0' + exponent / 100);
+      if (exponent >= 10) *ptr++ = static_cast<char>('0' + exponent / 10 % 10);
+      *ptr++ = static_cast<char>('0' + exponent % 10);
+    }
+    *ptr = 0;
+    writeRaw(buffer);
+  }
+
   static JsonFloat getLastDigit(uint8_t digits) {
     // Designed as a compromise between code size and speed
     switch (digits) {
@@ -0,0 +1,39 @@
+// Copyright Benoit Blanchon 2014-2017
+// MIT License
+//
+// Arduino JSON library
+// https://github.com/bblanchon/ArduinoJson
+// If you like this project, please add a star!
+
+#pragma once
+
+#include "MsgPackWriter.hpp"
+
+namespace ArduinoJson {
+
+class JsonArray;
+class JsonArraySubscript;
+class JsonObject;
+template <typename TKey>
+class JsonObjectSubscript;
+class JsonVariant;
+
+namespace Internals {
+
+// Writes the values of a JsonBuffer in MessagePack.
+// The unparsed values, from JsonBuffer::parse(), are written like their JSON
+// text reads: "null", "true", "false", an integer or a float.
+class MsgPackSerializer {
+ public:
+  static void serialize(const JsonArray &, MsgPackWriter &);
+  static void serialize(const JsonArraySubscript &, MsgPackWriter &);
+  static void serialize(const JsonObject &, MsgPackWriter &);
+  template <typename TKey>
+  static void serialize(const JsonObjectSubscript<TKey> &, MsgPackWriter &);
+  static void serialize(const JsonVariant &, MsgPackWriter &);
+
+ private:
+  static void serializeUnparsed(const char *, MsgPackWriter &);
+};
+}
+}
@@ -0,0 +1,112 @@
+// Copyright Benoit Blanchon 2014-2017
+// MIT License
+//
+// Arduino JSON library
+// https://github.com/bblanchon/ArduinoJson
+// If you like this project, please add a star!
+
+#pragma once
+
+#include <string.h>  // for strcmp
+
+#include "../Data/Parse.hpp"
+#include "../JsonArray.hpp"
+#include "../JsonArraySubscript.hpp"
+#include "../JsonObject.hpp"
+#include "../JsonObjectSubscript.hpp"
+#include "../JsonVariant.hpp"
+#include "MsgPackSerializer.hpp"
+
+inline void ArduinoJson::Internals::MsgPackSerializer::serialize(
+    const JsonArray& array, MsgPackWriter& writer) {
+  writer.beginArray(array.size());
+  for (JsonArray::const_iterator it = array.begin(); it != array.end(); ++it)
+    serialize(*it, writer);
+}
+
+inline void ArduinoJson::Internals::MsgPackSerializer::serialize(
+    const JsonArraySubscript& arraySubscript, MsgPackWriter& writer) {
+  serialize(arraySubscript.as<JsonVariant>(), writer);
+}
+
+inline void ArduinoJson::Internals::MsgPackSerializer::serialize(
+    const JsonObject& object, MsgPackWriter& writer) {
+  writer.beginObject(object.size());
+  for (JsonObject::const_iterator it = object.begin(); it != object.end();
+       ++it) {
+    writer.writeString(it->key);
+    serialize(it->value, writer);
+  }
+}
+
+template <typename TKey>
+inline void ArduinoJson::Internals::MsgPackSerializer::serialize(
+    const JsonObjectSubscript<TKey>& objectSubscript, MsgPackWriter& writer) {
+  serialize(objectSubscript.template as<JsonVariant>(), writer);
+}
+
+inline void ArduinoJson::Internals::MsgPackSerializer::serialize(
+    const JsonVariant& variant, MsgPackWriter& writer) {
+  switch (variant._type) {
+    case JSON_UNDEFINED:
+      writer.writeNil();
+      return;
+
+    case JSON_ARRAY:
+      serialize(*variant._content.asArray, writer);
+      return;
+
+    case JSON_OBJECT:
+      serialize(*variant._content.asObject, writer);
+      return;
+
+    case JSON_STRING:
+      writer.writeString(variant._content.asString);
+      return;
+
+    case JSON_UNPARSED:
+      serializeUnparsed(variant._content.asString, writer);
+      return;
+
+    case JSON_NEGATIVE_INTEGER:
+      writer.writeNegativeInteger(variant._content.asInteger);
+      return;
+
+    case JSON_POSITIVE_INTEGER:
+      writer.writeInteger(variant._content.asInteger);
+      return;
+
+    case JSON_BOOLEAN:
+      writer.writeBoolean(variant._content.asInteger != 0);
+      return;
+
+    default:
+      writer.writeFloat(variant._content.asFloat);
+  }
+}
+
+inline void ArduinoJson::Internals::MsgPackSerializer::serializeUnparsed(
+    const char* value, MsgPackWriter& writer) {
+  if (!value || !strcmp(value, "null")) return writer.writeNil();
+  if (!strcmp(value, "true")) return writer.writeBoolean(true);
+  if (!strcmp(value, "false")) return writer.writeBoolean(false);
+
+  JsonUInt integer;
+  bool negative;
+  if (parseCanonicalInteger(value, integer, negative)) {
+    if (negative)
+      writer.writeNegativeInteger(integer);
+    else
+      writer.writeInteger(integer);
+    return;
+  }
+
+  // the other unparsed values are numbers, or words that the JsonParser
+  // accepted without quotes
+  char first = value[0];
+  if (isDecimalDigit(first) || first == '-' || first == '+' || first == '.' ||
+      !strcmp(value, "NaN") || !strcmp(value, "Infinity"))
+    writer.writeFloat(parse<JsonFloat>(value));
+  else
+    writer.writeString(value);
+}
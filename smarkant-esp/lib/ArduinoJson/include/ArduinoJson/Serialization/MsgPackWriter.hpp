@@ -0,0 +1,138 @@
+// Copyright Benoit Blanchon 2014-2017
+// MIT License
+//
+// Arduino JSON library
+// https://github.com/bblanchon/ArduinoJson
+// If you like this project, please add a star!
+
+#pragma once
+
+#include <stdint.h>  // for uint8_t, uint32_t, uint64_t
+#include <string.h>  // for memcpy, strlen
+
+#include "../Data/JsonFloat.hpp"
+#include "../Data/JsonInteger.hpp"
+#include "../Print.hpp"
+
+namespace ArduinoJson {
+namespace Internals {
+
+// Writes the values of MessagePack (https://msgpack.org) to a Print, each in
+// its shortest form.
+// This class is used by:
+// - JsonArray::printMsgPackTo()
+// - JsonObject::printMsgPackTo()
+// - JsonVariant::printMsgPackTo()
+class MsgPackWriter {
+ public:
+  explicit MsgPackWriter(Print &sink) : _sink(sink), _length(0) {}
+
+  // Returns the number of bytes sent to the Print implementation.
+  size_t bytesWritten() const {
+    return _length;
+  }
+
+  void beginArray(size_t size) {
+    writeHeader(size, 0x90, 15, 0xdc);
+  }
+
+  void beginObject(size_t size) {
+    writeHeader(size, 0x80, 15, 0xde);
+  }
+
+  void writeNil() {
+    writeByte(0xc0);
+  }
+
+  void writeBoolean(bool value) {
+    writeByte(value ? 0xc3 : 0xc2);
+  }
+
+  void writeString(const char *value) {
+    if (!value) return writeNil();
+    size_t length = strlen(value);
+    if (length <= 31)
+      writeByte(static_cast<uint8_t>(0xa0 | length));
+    else if (length <= 0xff)
+      writeBigEndian(0xd9, length, 1);
+    else
+      writeHeader(length, 0xa0, 31, 0xda);
+    _length += _sink.print(value);
+  }
+
+  void writeInteger(JsonUInt value) {
+    uint64_t integer = value;
+    if (integer <= 0x7f)
+      writeByte(static_cast<uint8_t>(integer));
+    else if (integer <= 0xff)
+      writeBigEndian(0xcc, integer, 1);
+    else if (integer <= 0xffff)
+      writeBigEndian(0xcd, integer, 2);
+    else if (integer <= 0xffffffff)
+      writeBigEndian(0xce, integer, 4);
+    else
+      writeBigEndian(0xcf, integer, 8);
+  }
+
+  // Writes the negative integer whose absolute value is magnitude.
+  void writeNegativeInteger(JsonUInt magnitude) {
+    uint64_t integer = magnitude;
+    // the bytes of a negative integer are the ones of its two's complement
+    uint64_t complement = 0 - integer;
+    if (integer <= 32)
+      writeByte(static_cast<uint8_t>(complement));
+    else if (integer <= 0x80)
+      writeBigEndian(0xd0, complement, 1);
+    else if (integer <= 0x8000)
+      writeBigEndian(0xd1, complement, 2);
+    else if (integer <= 0x80000000)
+      writeBigEndian(0xd2, complement, 4);
+    else
+      writeBigEndian(0xd3, complement, 8);
+  }
+
+  // Writes a float32 if it holds the value, else a float64.
+  void writeFloat(JsonFloat value) {
+    float single = static_cast<float>(value);
+    if (static_cast<JsonFloat>(single) == value || value != value) {
+      uint32_t bits;
+      memcpy(&bits, &single, sizeof(bits));
+      writeBigEndian(0xca, bits, 4);
+    } else {
+      double number = static_cast<double>(value);
+      uint64_t bits;
+      memcpy(&bits, &number, sizeof(bits));
+      writeBigEndian(0xcb, bits, 8);
+    }
+  }
+
+ private:
+  MsgPackWriter &operator=(const MsgPackWriter &);  // cannot be assigned
+
+  // The header of a string, an array or a map: the size is in the fix code
+  // up to fixMax, then it follows code on 16 bits, or code + 1 on 32 bits.
+  void writeHeader(size_t size, uint8_t fixCode, size_t fixMax, uint8_t code) {
+    if (size <= fixMax)
+      writeByte(static_cast<uint8_t>(fixCode | size));
+    else if (size <= 0xffff)
+      writeBigEndian(code, size, 2);
+    else
+      writeBigEndian(static_cast<uint8_t>(code + 1), size, 4);
+  }
+
+  // Writes a code followed by the last bytes of value, big-endian.
+  void writeBigEndian(uint8_t code, uint64_t value, int bytes) {
+    writeByte(code);
+    for (int shift = 8 * (bytes - 1); shift >= 0; shift -= 8)
+      writeByte(static_cast<uint8_t>(value >> shift));
+  }
+
+  void writeByte(uint8_t c) {
+    _length += _sink.write(c);
+  }
+
+  Print &_sink;
+  size_t _length;
+};
+}
+}
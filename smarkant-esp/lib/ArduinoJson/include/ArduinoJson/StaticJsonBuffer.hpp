@@ -36,6 +36,13 @@ class StaticJsonBufferBase : public JsonBufferBase<StaticJsonBufferBase> {
       }
     }
 
+    // Like append(char) for each char, the ones that don't fit are dropped.
+    void append(const char* chars, size_t length) {
+      size_t room = _parent->_capacity - _parent->_size;
+      if (length > room) length = room;
+      memcpy(_parent->doAlloc(length), chars, length);
+    }
+
     const char* c_str() const {
       if (_parent->canAlloc(1)) {
         char* last = static_cast<char*>(_parent->doAlloc(1));
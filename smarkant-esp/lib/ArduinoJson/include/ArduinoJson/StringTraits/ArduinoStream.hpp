@@ -40,6 +40,11 @@ struct ArduinoStreamTraits {
       return _next;
     }
 
+    // There is no run of plain chars, the chars come one at a time.
+    size_t skipPlainChars(char, const char*&) {
+      return 0;
+    }
+
    private:
     char read() {
       // don't use _stream.read() as it ignores the timeout
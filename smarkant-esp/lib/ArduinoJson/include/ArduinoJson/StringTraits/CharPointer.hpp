@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include "../Data/PlainChars.hpp"
+#include "../Data/StringHash.hpp"
 #include "../TypeTraits/EnableIf.hpp"
 #include "../TypeTraits/IsChar.hpp"
 
@@ -17,10 +19,14 @@ template <typename TChar>
 struct CharPointerTraits {
   class Reader {
     const TChar* _ptr;
+    const TChar* _end;
 
    public:
-    Reader(const TChar* ptr)
-        : _ptr(ptr ? ptr : reinterpret_cast<const TChar*>("")) {}
+    // The end is optional, it's the terminating zero of a string whose length
+    // is known, like a std::string.
+    Reader(const TChar* ptr, const TChar* end = NULL)
+        : _ptr(ptr ? ptr : reinterpret_cast<const TChar*>("")),
+          _end(ptr ? end : NULL) {}
 
     void move() {
       ++_ptr;
@@ -33,12 +39,62 @@ struct CharPointerTraits {
     TChar next() const {
       return _ptr[1];
     }
+
+    // Skips the chars of a string up to the next stopChar, backslash or zero.
+    // Returns their number, run points to the first one.
+    // They are read a word at a time if the end is known.
+    FORCE_INLINE size_t skipPlainChars(char stopChar, const char*& run) {
+      run = reinterpret_cast<const char*>(_ptr);
+      const char* end =
+          _end ? Internals::skipPlainChars(
+                     run, reinterpret_cast<const char*>(_end), stopChar)
+               : Internals::skipPlainChars(run, stopChar);
+      _ptr += end - run;
+      return static_cast<size_t>(end - run);
+    }
+  };
+
+  // Reads a string that isn't terminated by a zero, like the payload of a
+  // network packet. It never reads beyond ptr + length and gives a zero there,
+  // as if the string was terminated.
+  class BoundedReader {
+    const TChar* _ptr;
+    const TChar* _end;
+
+   public:
+    BoundedReader(const TChar* ptr, size_t length)
+        : _ptr(ptr), _end(ptr + length) {}
+
+    void move() {
+      if (_ptr < _end) ++_ptr;
+    }
+
+    TChar current() const {
+      return _ptr < _end ? _ptr[0] : 0;
+    }
+
+    TChar next() const {
+      return _ptr + 1 < _end ? _ptr[1] : 0;
+    }
+
+    // Like Reader::skipPlainChars() with an end.
+    FORCE_INLINE size_t skipPlainChars(char stopChar, const char*& run) {
+      run = reinterpret_cast<const char*>(_ptr);
+      const char* end = Internals::skipPlainChars(
+          run, reinterpret_cast<const char*>(_end), stopChar);
+      _ptr += end - run;
+      return static_cast<size_t>(end - run);
+    }
   };
 
   static bool equals(const TChar* str, const char* expected) {
     return strcmp(reinterpret_cast<const char*>(str), expected) == 0;
   }
 
+  static uint16_t hash(const TChar* str) {
+    return StringHash::compute(reinterpret_cast<const char*>(str));
+  }
+
   template <typename Buffer>
   static char* duplicate(const TChar* str, Buffer* buffer) {
     if (!str) return NULL;
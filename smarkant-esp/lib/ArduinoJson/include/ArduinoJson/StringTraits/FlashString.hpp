@@ -29,12 +29,25 @@ struct StringTraits<const __FlashStringHelper*, void> {
     char next() const {
       return pgm_read_byte_near(_ptr + 1);
     }
+
+    // There is no run of plain chars, the flash is read one char at a time.
+    size_t skipPlainChars(char, const char*&) {
+      return 0;
+    }
   };
 
   static bool equals(const __FlashStringHelper* str, const char* expected) {
     return strcmp_P(expected, (PGM_P)str) == 0;
   }
 
+  static uint16_t hash(const __FlashStringHelper* str) {
+    StringHash hash;
+    const char* ptr = reinterpret_cast<const char*>(str);
+    for (char c = pgm_read_byte_near(ptr); c; c = pgm_read_byte_near(++ptr))
+      hash.update(c);
+    return hash.value();
+  }
+
   template <typename Buffer>
   static char* duplicate(const __FlashStringHelper* str, Buffer* buffer) {
     if (!str) return NULL;
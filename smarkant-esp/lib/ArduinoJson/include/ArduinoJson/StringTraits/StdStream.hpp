@@ -39,6 +39,11 @@ struct StdStreamTraits {
       return _next;
     }
 
+    // There is no run of plain chars, the chars come one at a time.
+    size_t skipPlainChars(char, const char*&) {
+      return 0;
+    }
+
    private:
     Reader& operator=(const Reader&);  // Visual Studio C4512
 
@@ -30,13 +30,19 @@ struct StdStringTraits {
   }
 
   struct Reader : CharPointerTraits<char>::Reader {
-    Reader(const TString& str) : CharPointerTraits<char>::Reader(str.c_str()) {}
+    Reader(const TString& str)
+        : CharPointerTraits<char>::Reader(str.c_str(),
+                                          str.c_str() + str.length()) {}
   };
 
   static bool equals(const TString& str, const char* expected) {
     return 0 == strcmp(str.c_str(), expected);
   }
 
+  static uint16_t hash(const TString& str) {
+    return StringHash::compute(str.c_str());
+  }
+
   static void append(TString& str, char c) {
     str += c;
   }
@@ -0,0 +1,42 @@
+// Copyright Benoit Blanchon 2014-2017
+// MIT License
+//
+// Arduino JSON library
+// https://github.com/bblanchon/ArduinoJson
+// If you like this project, please add a star!
+
+#pragma once
+
+namespace ArduinoJson {
+namespace TypeTraits {
+
+// A meta-function that returns true if T lists its fields in a static
+// jsonFields() function template, see JsonStruct.
+template <typename T>
+class IsJsonStruct {
+ protected:  // <- to avoid GCC's "all member functions in class are private"
+  typedef char Yes[1];
+  typedef char No[2];
+
+  // takes the fields without doing anything, since the probe instantiates
+  // jsonFields()
+  struct Fields {
+    template <typename TMember>
+    void operator()(const char *, TMember) {}
+    template <typename TMember, typename TPresent>
+    void operator()(const char *, TMember, TPresent) {}
+  };
+
+  template <void (*)(Fields &)>
+  struct Function {};
+
+  template <typename U>
+  static Yes &probe(Function<&U::template jsonFields<Fields> > *);
+  template <typename U>
+  static No &probe(...);
+
+ public:
+  enum { value = sizeof(probe<T>(0)) == sizeof(Yes) };
+};
+}
+}
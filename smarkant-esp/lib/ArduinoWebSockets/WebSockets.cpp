@@ -394,7 +394,7 @@ void WebSockets::handleWebsocketCb(WSclient_t * client) {
 
     if(header->payloadLen > 0) {
         // if text data we need one more
-        payload = (uint8_t *) malloc(header->payloadLen + 1);
+        payload = reserveRXBuffer(client, header->payloadLen + 1);
 
         if(!payload) {
             DEBUG_WEBSOCKETS("[WS][%d][handleWebsocket] to less memory to handle payload %d!\n", client->num, header->payloadLen);
@@ -460,10 +460,6 @@ void WebSockets::handleWebsocketPayloadCb(WSclient_t * client, bool ok, uint8_t
                 break;
         }
 
-        if(payload) {
-            free(payload);
-        }
-
         // reset input
         client->cWsRXsize = 0;
 #if (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266_ASYNC)
@@ -473,11 +469,47 @@ void WebSockets::handleWebsocketPayloadCb(WSclient_t * client, bool ok, uint8_t
 
     } else {
         DEBUG_WEBSOCKETS("[WS][%d][handleWebsocket] missing data!\n", client->num);
-        free(payload);
         clientDisconnect(client, 1002);
     }
 }
 
+/**
+ * get the RX payload buffer of the client with at least size bytes
+ * the buffer is kept for the next messages, so the payload passed to
+ * messageReceived() stays valid until the next message is read
+ * a buffer grown beyond WEBSOCKETS_MAX_KEPT_RX_BUFFER_SIZE by a large message
+ * is replaced by a smaller one with the next message that fits into that size
+ * @param client WSclient_t *
+ * @param size size_t
+ * @return uint8_t * buffer or NULL if out of memory
+ */
+uint8_t * WebSockets::reserveRXBuffer(WSclient_t * client, size_t size) {
+    if(client->cWsRXBuffer && client->cWsRXBufferSize >= size) {
+        if(client->cWsRXBufferSize <= WEBSOCKETS_MAX_KEPT_RX_BUFFER_SIZE || size > WEBSOCKETS_MAX_KEPT_RX_BUFFER_SIZE) {
+            return client->cWsRXBuffer;
+        }
+    }
+
+    freeRXBuffer(client);
+    client->cWsRXBuffer = (uint8_t *) malloc(size);
+    if(client->cWsRXBuffer) {
+        client->cWsRXBufferSize = size;
+    }
+    return client->cWsRXBuffer;
+}
+
+/**
+ * release the RX payload buffer of the client
+ * @param client WSclient_t *
+ */
+void WebSockets::freeRXBuffer(WSclient_t * client) {
+    if(client->cWsRXBuffer) {
+        free(client->cWsRXBuffer);
+        client->cWsRXBuffer = NULL;
+    }
+    client->cWsRXBufferSize = 0;
+}
+
 /**
  * generate the key for Sec-WebSocket-Accept
  * @param clientKey String
@@ -56,6 +56,16 @@
 
 #define WEBSOCKETS_TCP_TIMEOUT    (2000)
 
+// largest RX payload buffer that is kept for the next messages, a larger one
+// is shrunk again by the next message that fits into this size
+#ifndef WEBSOCKETS_MAX_KEPT_RX_BUFFER_SIZE
+#define WEBSOCKETS_MAX_KEPT_RX_BUFFER_SIZE  (1024)
+#endif
+
+// TLS session resumption for the client, needs the BearSSL based WiFiClientSecure
+// of the ESP8266 core (2.5.0 or later)
+//#define WEBSOCKETS_SSL_SESSION
+
 #define NETWORK_ESP8266_ASYNC   (0)
 #define NETWORK_ESP8266         (1)
 #define NETWORK_W5100           (2)
@@ -201,6 +211,8 @@ typedef struct {
         uint8_t cWsRXsize;  ///< State of the RX
         uint8_t cWsHeader[WEBSOCKETS_MAX_HEADER_SIZE]; ///< RX WS Message buffer
         WSMessageHeader_t cWsHeaderDecode;
+        uint8_t * cWsRXBuffer;      ///< RX payload buffer (reused for all messages)
+        size_t cWsRXBufferSize;     ///< size of the RX payload buffer
 
         String base64Authorization; ///< Base64 encoded Auth request
         String plainAuthorization; ///< Base64 encoded Auth request
@@ -224,10 +236,10 @@ class WebSockets {
         typedef std::function<void(WSclient_t * client, bool ok)> WSreadWaitCb;
 #endif
 
-        virtual void clientDisconnect(WSclient_t * client);
-        virtual bool clientIsConnected(WSclient_t * client);
+        virtual void clientDisconnect(WSclient_t * client) = 0;
+        virtual bool clientIsConnected(WSclient_t * client) = 0;
 
-        virtual void messageReceived(WSclient_t * client, WSopcode_t opcode, uint8_t * payload, size_t length);
+        virtual void messageReceived(WSclient_t * client, WSopcode_t opcode, uint8_t * payload, size_t length) = 0;
 
         void clientDisconnect(WSclient_t * client, uint16_t code, char * reason = NULL, size_t reasonLen = 0);
         bool sendFrame(WSclient_t * client, WSopcode_t opcode, uint8_t * payload = NULL, size_t length = 0, bool mask = false, bool fin = true, bool headerToPayload = false);
@@ -240,6 +252,9 @@ class WebSockets {
         void handleWebsocketCb(WSclient_t * client);
         void handleWebsocketPayloadCb(WSclient_t * client, bool ok, uint8_t * payload);
 
+        uint8_t * reserveRXBuffer(WSclient_t * client, size_t size);
+        void freeRXBuffer(WSclient_t * client);
+
         String acceptKey(String & clientKey);
         String base64_encode(uint8_t * data, size_t length);
 
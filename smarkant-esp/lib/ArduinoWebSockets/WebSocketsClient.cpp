@@ -29,6 +29,11 @@
 WebSocketsClient::WebSocketsClient() {
     _cbEvent = NULL;
     _client.num = 0;
+    _client.cWsRXBuffer = NULL;
+    _client.cWsRXBufferSize = 0;
+#if (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266) && defined(WEBSOCKETS_SSL_SESSION)
+    _sslSession = NULL;
+#endif
 }
 
 WebSocketsClient::~WebSocketsClient() {
@@ -118,6 +123,11 @@ void WebSocketsClient::loop(void) {
             }
             _client.ssl = new WiFiClientSecure();
             _client.tcp = _client.ssl;
+#ifdef WEBSOCKETS_SSL_SESSION
+            if(_sslSession) {
+                _client.ssl->setSession(_sslSession);
+            }
+#endif
         } else {
             DEBUG_WEBSOCKETS("[WS-Client] connect ws...\n");
             if(_client.tcp) {
@@ -261,6 +271,17 @@ void WebSocketsClient::setAuthorization(const char * auth) {
     }
 }
 
+#if (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266) && defined(WEBSOCKETS_SSL_SESSION)
+/**
+ * set the TLS session that is resumed by the next SSL connections
+ * and updated after each handshake (must stay valid while the client is used)
+ * @param session BearSSL::Session *
+ */
+void WebSocketsClient::setSSLSession(BearSSL::Session * session) {
+    _sslSession = session;
+}
+#endif
+
 //#################################################################################
 //#################################################################################
 //#################################################################################
@@ -334,6 +355,8 @@ void WebSocketsClient::clientDisconnect(WSclient_t * client) {
     client->cIsWebsocket = false;
     client->cSessionId = "";
 
+    freeRXBuffer(client);
+
     client->status = WSC_NOT_CONNECTED;
 
     DEBUG_WEBSOCKETS("[WS-Client] client disconnected.\n");
@@ -76,12 +76,19 @@ class WebSocketsClient: private WebSockets {
         void setAuthorization(const char * user, const char * password);
         void setAuthorization(const char * auth);
 
+#if (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266) && defined(WEBSOCKETS_SSL_SESSION)
+        void setSSLSession(BearSSL::Session * session);
+#endif
+
     protected:
         String _host;
         uint16_t _port;
 
 #if (WEBSOCKETS_NETWORK_TYPE == NETWORK_ESP8266)
         String _fingerprint;
+#ifdef WEBSOCKETS_SSL_SESSION
+        BearSSL::Session * _sslSession; ///< tls session reused by all connections
+#endif
 #endif
         WSclient_t _client;
 
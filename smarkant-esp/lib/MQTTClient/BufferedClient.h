@@ -0,0 +1,37 @@
+/*******************************************************************************
+ * A Client that lends out the bytes it has already received, so that the MQTT
+ * client can parse packets which arrived completely in one buffer in place
+ * instead of copying them into its read buffer.
+ *******************************************************************************/
+
+#if !defined(BUFFEREDCLIENT_H)
+#define BUFFEREDCLIENT_H
+
+#include <Client.h>
+
+class BufferedClient : public Client
+{
+public:
+    /** Get the received bytes that are contiguous in memory, without copying them
+     *  @param buffer - set to the first unread byte
+     *  @return the number of bytes at buffer, valid until the next read, available or consume call
+     */
+    virtual int peekBuffer(unsigned char** buffer) = 0;
+
+    /** Mark bytes returned by peekBuffer as read
+     *  @param len - the number of bytes to drop
+     */
+    virtual void consume(int len) = 0;
+
+    /** Number of bytes in front of a buffer that writeInPlace may use, e.g. for a frame header
+     */
+    virtual int writeHeadroom() { return 0; }
+
+    /** Write a buffer that is preceded by writeHeadroom() bytes which the client may overwrite,
+     *  so that it can be sent without copying it
+     *  @return the number of bytes written
+     */
+    virtual size_t writeInPlace(uint8_t* buffer, size_t size) { return write(buffer, size); }
+};
+
+#endif
@@ -21,11 +21,17 @@
 #include <SPI.h>
 
 #include <Client.h>
+#include "BufferedClient.h"
 
 class IPStack 
 {
 public:    
-    IPStack(Client& client) : client(&client)
+    IPStack(Client& client) : client(&client), buffered(NULL)
+    {
+
+    }
+
+    IPStack(BufferedClient& client) : client(&client), buffered(&client)
     {
 
     }
@@ -40,21 +46,42 @@ public:
         return client->connect(hostname, port);
     }
 
+    /* Read len bytes: what is buffered is taken right away, the rest is waited for until the
+       timeout (in milliseconds) expires. A timeout of 0 polls the client once and never blocks.
+       Returns the number of bytes read. */
     int read(unsigned char* buffer, int len, int timeout)
     {
-        int interval = 10;  // all times are in milliseconds
-		int total = 0, rc = -1;
-
-		if (timeout < 30)
-			interval = 2;
-		while (client->available() < len && total < timeout)
-		{
-			delay(interval);
-			total += interval;
-		}
-		if (client->available() >= len)
-			rc = client->readBytes((char*)buffer, len);
-		return rc;
+        unsigned long start = millis();
+        int total = 0;
+
+        while (total < len)
+        {
+            if (client->available() > 0)
+            {
+                int rc = client->read(buffer + total, len - total);
+                if (rc <= 0)
+                    break;
+                total += rc;
+            }
+            else if (timeout <= 0 || (long) (millis() - start) >= timeout || !client->connected())
+                break;
+            else
+                yield();    // let the network stack run instead of sleeping
+        }
+        return total;
+    }
+    
+    int peek(unsigned char** buffer)
+    {
+        if (buffered == NULL)
+            return 0;
+        return buffered->peekBuffer(buffer);
+    }
+
+    void consume(int len)
+    {
+        if (buffered != NULL)
+            buffered->consume(len);
     }
     
     int write(unsigned char* buffer, int len, int timeout)
@@ -62,6 +89,15 @@ public:
         client->setTimeout(timeout);  
 		return client->write((uint8_t*)buffer, len);
     }
+
+    /* Write a buffer that is preceded by headroom bytes, which the client may use to send it in place */
+    int write(unsigned char* buffer, int len, int timeout, int headroom)
+    {
+        if (buffered == NULL || headroom < buffered->writeHeadroom())
+            return write(buffer, len, timeout);
+        client->setTimeout(timeout);
+        return buffered->writeInPlace((uint8_t*)buffer, len);
+    }
     
     int disconnect()
     {
@@ -72,6 +108,7 @@ public:
 private:
 
     Client* client;
+    BufferedClient* buffered;
 };
 
 #endif
@@ -22,6 +22,7 @@
 #include "FP.h"
 #include "MQTTPacket.h"
 #include "stdio.h"
+#include "string.h"
 #include "MQTTLogging.h"
 
 #if !defined(MQTTCLIENT_QOS1)
@@ -30,6 +31,12 @@
 #if !defined(MQTTCLIENT_QOS2)
     #define MQTTCLIENT_QOS2 0
 #endif
+#if !defined(MQTTCLIENT_MAX_TOPIC_LEVELS)
+    #define MQTTCLIENT_MAX_TOPIC_LEVELS 8       // levels of a subscribed topic filter, sizes the topic trie
+#endif
+#if !defined(MQTTCLIENT_SEND_HEADROOM)
+    #define MQTTCLIENT_SEND_HEADROOM 14     // bytes in front of each sent packet for the header of the transport (websocket frame)
+#endif
 
 namespace MQTT
 {
@@ -38,7 +45,8 @@ namespace MQTT
 enum QoS { QOS0, QOS1, QOS2 };
 
 // all failure return codes must be negative
-enum returnCode { BUFFER_OVERFLOW = -2, FAILURE = -1, SUCCESS = 0 };
+// IN_PROGRESS is above any connack or suback return code
+enum returnCode { BUFFER_OVERFLOW = -2, FAILURE = -1, SUCCESS = 0, IN_PROGRESS = 0x100 };
 
 
 struct Message
@@ -86,17 +94,26 @@ private:
  * @brief blocking, non-threaded MQTT client API
  *
  * This version of the API blocks on all method calls, until they are complete.  This means that only one
- * MQTT request can be in process at any one time.
+ * MQTT request can be in process at any one time.  The exception is publishAsync, which keeps up to
+ * MAX_INFLIGHT_PUBLISHES QoS1 publishes in flight while their pubacks are received by yield, and the
+ * connect and subscribe that are started by beginConnect/beginSubscribe and polled for their acks.
  * @param Network a network class which supports send, receive
  * @param Timer a timer class with the methods:
+ * @param MAX_MQTT_PACKET_SIZE the largest packet that can be received (size of the read buffer)
+ * @param MAX_MESSAGE_HANDLERS the number of subscriptions
+ * @param MAX_INFLIGHT_PUBLISHES the number of QoS1/QoS2 publishes that can wait for their acks
+ * @param MAX_TX_PACKET_SIZE the largest packet that can be sent (size of the send buffer)
+ * @param MAX_PUB_PACKET_SIZE the largest QoS1/QoS2 publish (kept for a resend in each in-flight slot)
  */
-template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE = 100, int MAX_MESSAGE_HANDLERS = 5>
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE = 100, int MAX_MESSAGE_HANDLERS = 5, int MAX_INFLIGHT_PUBLISHES = 1,
+         int MAX_TX_PACKET_SIZE = MAX_MQTT_PACKET_SIZE, int MAX_PUB_PACKET_SIZE = MAX_TX_PACKET_SIZE>
 class Client
 {
 
 public:
 
     typedef void (*messageHandler)(MessageData&);
+    typedef void (*publishCompleteHandler)(unsigned short);
 
     /** Construct the client
      *  @param network - pointer to an instance of the Network class - must be connected to the endpoint
@@ -127,6 +144,17 @@ public:
      */
     int connect(MQTTPacket_connectData& options);
 
+    /** MQTT Connect without blocking - send an MQTT connect packet, pollConnect then waits for the Connack
+     *  @param options - connect options
+     *  @return success code - SUCCESS if the connect packet was sent
+     */
+    int beginConnect(MQTTPacket_connectData& options);
+
+    /** Handle what has arrived for the connect started by beginConnect, without blocking
+     *  @return IN_PROGRESS while the Connack is awaited, then the return code of connect
+     */
+    int pollConnect();
+
     /** MQTT Publish - send an MQTT publish packet and wait for all acks to complete for all QoSs
      *  @param topic - the topic to publish to
      *  @param message - the message to send
@@ -155,6 +183,45 @@ public:
      */
     int publish(const char* topicName, void* payload, size_t payloadlen, unsigned short& id, enum QoS qos = QOS1, bool retained = false);
 
+    /** MQTT Publish at QoS1 without waiting for the puback - the publish is kept in the in-flight window
+     *  (and resent on reconnect) until its puback is received by yield, which then calls the publish
+     *  complete handler with its id
+     *  @param topicName - the topic to publish to
+     *  @param payload - the data to send
+     *  @param payloadlen - the length of the data
+     *  @param id - the packet id used - returned, 0 if the publish was not put in flight
+     *  @param retained - whether the message should be retained
+     *  @return success code - FAILURE also if MAX_INFLIGHT_PUBLISHES publishes are in flight, or if the
+     *      publish was put in flight but could not be sent (the client is then disconnected, id is set and
+     *      the publish is resent on reconnect)
+     */
+    int publishAsync(const char* topicName, void* payload, size_t payloadlen, unsigned short& id, bool retained = false);
+
+    /** Set the callback that is invoked with the packet id of each completed QoS1/QoS2 publish
+     *  @param handler - pointer to the callback function
+     */
+    void setPublishCompleteHandler(publishCompleteHandler handler)
+    {
+        publishCompleteFP.attach(handler);
+    }
+
+    /** Lend out the read buffer, e.g. to build an outgoing message in it instead of in a buffer of its own.
+     *  It is only free between MQTT calls: it must not be used from a message handler (the payload may be
+     *  in it) and its content is overwritten by the next yield, connect, subscribe or publish
+     *  @param size - set to the size of the buffer
+     *  @return the read buffer
+     */
+    unsigned char* lendReadBuffer(int& size)
+    {
+        size = MAX_MQTT_PACKET_SIZE;
+        return readbuf;
+    }
+
+    /** The number of QoS1/QoS2 publishes that wait for their acknowledgement
+     *  @return the number of used slots of the in-flight window
+     */
+    int inflightCount();
+
     /** MQTT Subscribe - send an MQTT subscribe packet and wait for the suback
      *  @param topicFilter - a topic pattern which can include wildcards
      *  @param qos - the MQTT QoS to subscribe at
@@ -163,6 +230,19 @@ public:
      */
     int subscribe(const char* topicFilter, enum QoS qos, messageHandler mh);
 
+    /** MQTT Subscribe without blocking - send an MQTT subscribe packet, pollSubscribe then waits for the suback
+     *  @param topicFilter - a topic pattern which can include wildcards, must stay valid
+     *  @param qos - the MQTT QoS to subscribe at
+     *  @param mh - the callback function to be invoked when a message is received for this subscription
+     *  @return success code - SUCCESS if the subscribe packet was sent
+     */
+    int beginSubscribe(const char* topicFilter, enum QoS qos, messageHandler mh);
+
+    /** Handle what has arrived for the subscribe started by beginSubscribe, without blocking
+     *  @return IN_PROGRESS while the suback is awaited, then the return code of subscribe
+     */
+    int pollSubscribe();
+
     /** MQTT Unsubscribe - send an MQTT unsubscribe packet and wait for the unsuback
      *  @param topicFilter - a topic pattern which can include wildcards
      *  @return success code -
@@ -177,7 +257,7 @@ public:
     /** A call to this API must be made within the keepAlive interval to keep the MQTT connection alive
      *  yield can be called if no other MQTT operation is needed.  This will also allow messages to be
      *  received.
-     *  @param timeout_ms the time to wait, in milliseconds
+     *  @param timeout_ms the time to wait, in milliseconds (0 handles what has arrived without blocking)
      *  @return success code - on failure, this means the client has disconnected
      */
     int yield(unsigned long timeout_ms = 1000L);
@@ -194,20 +274,33 @@ private:
 
     int cycle(Timer& timer);
     int waitfor(int packet_type, Timer& timer);
+    int pollFor(int packet_type);
+    int connackReceived(Timer& timer);
+    int subackReceived(const char* topicFilter, messageHandler mh);
     int keepalive();
-    int publish(int len, Timer& timer, enum QoS qos);
+    int publish(int len, Timer& timer, enum QoS qos, unsigned short id);
+    bool isInflight(unsigned short id);
+    bool storeInflight(unsigned short id, enum QoS qos, int len);
+    void completeInflight(unsigned short id);
 
     int decodePacket(int* value, int timeout);
+    int readPacketInPlace();
     int readPacket(Timer& timer);
     int sendPacket(int length, Timer& timer);
     int deliverMessage(MQTTString& topicName, Message& message);
-    bool isTopicMatched(char* topicFilter, MQTTString& topicName);
+    void deliverToTopicNodes(unsigned char first, const char* level, const char* end, bool top, MessageData& md, int& rc);
+    void callMessageHandler(unsigned char handler, MessageData& md, int& rc);
+    bool buildTopicTrie();
+    unsigned char addTopicFilter(const char* topicFilter);
 
     Network& ipstack;
     unsigned long command_timeout_ms;
 
-    unsigned char sendbuf[MAX_MQTT_PACKET_SIZE];
+    unsigned char sendspace[MQTTCLIENT_SEND_HEADROOM + MAX_TX_PACKET_SIZE];
+    unsigned char* sendbuf;     // after the headroom in sendspace, the network may put its frame header in front
     unsigned char readbuf[MAX_MQTT_PACKET_SIZE];
+    unsigned char* rxbuf;   // the last packet read: readbuf, or the network buffer it was parsed from in place
+    int rxlen;
 
     Timer last_sent, last_received;
     unsigned int keepAliveInterval;
@@ -216,25 +309,51 @@ private:
 
     PacketId packetid;
 
+    // the command started by beginConnect or beginSubscribe
+    int pending_type;           // the awaited ack (CONNACK or SUBACK), 0 if none
+    Timer pending_timer;
+    const char* pending_filter;
+    messageHandler pending_handler;
+
     struct MessageHandlers
     {
         const char* topicFilter;
         FP<void, MessageData&> fp;
     } messageHandlers[MAX_MESSAGE_HANDLERS];      // Message handlers are indexed by subscription topic
 
+    // prefix trie of the subscribed topic filters with one node per topic level, so that a message
+    // is dispatched by walking its topic once instead of matching it against every filter
+    struct TopicNode
+    {
+        const char* level;      // the level in the topic filter of the handler, not terminated
+        unsigned char len;
+        unsigned char child;    // index + 1 of the first node of the next level, 0 if none
+        unsigned char sibling;  // index + 1 of the next node of the same level, 0 if none
+        unsigned char handler;  // index + 1 of the message handler of a filter that ends here, 0 if none
+    } topicNodes[MAX_MESSAGE_HANDLERS * MQTTCLIENT_MAX_TOPIC_LEVELS];
+    static_assert(MAX_MESSAGE_HANDLERS * MQTTCLIENT_MAX_TOPIC_LEVELS <= 255,
+                  "the topic trie links its nodes and handlers by unsigned char, "
+                  "MAX_MESSAGE_HANDLERS * MQTTCLIENT_MAX_TOPIC_LEVELS must not exceed 255");
+    int topicNodeCount;
+    unsigned char topicRoot;    // index + 1 of the first top level node
+
     FP<void, MessageData&> defaultMessageHandler;
 
     bool isconnected;
 
 #if MQTTCLIENT_QOS1 || MQTTCLIENT_QOS2
-    unsigned char pubbuf[MAX_MQTT_PACKET_SIZE];  // store the last publish for sending on reconnect
-    int inflightLen;
-    unsigned short inflightMsgid;
-    enum QoS inflightQoS;
+    struct InflightPublish
+    {
+        unsigned short msgid;   // 0 if the slot is free
+        enum QoS qos;
+        int len;
+        unsigned char pubbuf[MAX_PUB_PACKET_SIZE];  // store the publish for sending on reconnect
+    } inflight[MAX_INFLIGHT_PUBLISHES];
 #endif
 
+    FP<void, unsigned short> publishCompleteFP;
+
 #if MQTTCLIENT_QOS2
-    bool pubrel;
     #if !defined(MAX_INCOMING_QOS2_MESSAGES)
         #define MAX_INCOMING_QOS2_MESSAGES 10
     #endif
@@ -249,33 +368,40 @@ private:
 }
 
 
-template<class Network, class Timer, int a, int MAX_MESSAGE_HANDLERS>
-MQTT::Client<Network, Timer, a, MAX_MESSAGE_HANDLERS>::Client(Network& network, unsigned int command_timeout_ms)  : ipstack(network), packetid()
+template<class Network, class Timer, int a, int MAX_MESSAGE_HANDLERS, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+MQTT::Client<Network, Timer, a, MAX_MESSAGE_HANDLERS, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::Client(Network& network, unsigned int command_timeout_ms)  : ipstack(network), packetid()
 {
     last_sent = Timer();
     last_received = Timer();
     ping_outstanding = false;
     for (int i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
         messageHandlers[i].topicFilter = 0;
+    topicNodeCount = 0;
+    topicRoot = 0;
     this->command_timeout_ms = command_timeout_ms;
     isconnected = false;
+    sendbuf = sendspace + MQTTCLIENT_SEND_HEADROOM;
+    rxbuf = readbuf;
+    rxlen = 0;
+    pending_type = 0;
+    pending_filter = 0;
+    pending_handler = 0;
 
 #if MQTTCLIENT_QOS1 || MQTTCLIENT_QOS2
-    inflightMsgid = 0;
-    inflightQoS = QOS0;
+    for (int i = 0; i < MAX_INFLIGHT_PUBLISHES; ++i)
+        inflight[i].msgid = 0;
 #endif
 
 
 #if MQTTCLIENT_QOS2
-    pubrel = false;
     for (int i = 0; i < MAX_INCOMING_QOS2_MESSAGES; ++i)
         incomingQoS2messages[i] = 0;
 #endif
 }
 
 #if MQTTCLIENT_QOS2
-template<class Network, class Timer, int a, int b>
-bool MQTT::Client<Network, Timer, a, b>::isQoS2msgidFree(unsigned short id)
+template<class Network, class Timer, int a, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+bool MQTT::Client<Network, Timer, a, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::isQoS2msgidFree(unsigned short id)
 {
     for (int i = 0; i < MAX_INCOMING_QOS2_MESSAGES; ++i)
     {
@@ -286,8 +412,8 @@ bool MQTT::Client<Network, Timer, a, b>::isQoS2msgidFree(unsigned short id)
 }
 
 
-template<class Network, class Timer, int a, int b>
-bool MQTT::Client<Network, Timer, a, b>::useQoS2msgid(unsigned short id)
+template<class Network, class Timer, int a, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+bool MQTT::Client<Network, Timer, a, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::useQoS2msgid(unsigned short id)
 {
     for (int i = 0; i < MAX_INCOMING_QOS2_MESSAGES; ++i)
     {
@@ -301,8 +427,8 @@ bool MQTT::Client<Network, Timer, a, b>::useQoS2msgid(unsigned short id)
 }
 
 
-template<class Network, class Timer, int a, int b>
-void MQTT::Client<Network, Timer, a, b>::freeQoS2msgid(unsigned short id)
+template<class Network, class Timer, int a, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+void MQTT::Client<Network, Timer, a, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::freeQoS2msgid(unsigned short id)
 {
     for (int i = 0; i < MAX_INCOMING_QOS2_MESSAGES; ++i)
     {
@@ -316,15 +442,18 @@ void MQTT::Client<Network, Timer, a, b>::freeQoS2msgid(unsigned short id)
 #endif
 
 
-template<class Network, class Timer, int a, int b>
-int MQTT::Client<Network, Timer, a, b>::sendPacket(int length, Timer& timer)
+template<class Network, class Timer, int a, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, a, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::sendPacket(int length, Timer& timer)
 {
     int rc = FAILURE,
         sent = 0;
 
     while (sent < length && !timer.expired())
     {
-        rc = ipstack.write(&sendbuf[sent], length - sent, timer.left_ms());
+        if (sent == 0)  /* the whole packet, which the network can send from sendbuf without copying it */
+            rc = ipstack.write(sendbuf, length, timer.left_ms(), MQTTCLIENT_SEND_HEADROOM);
+        else
+            rc = ipstack.write(&sendbuf[sent], length - sent, timer.left_ms());
         if (rc < 0)  // there was an error writing the data
             break;
         sent += rc;
@@ -346,8 +475,8 @@ int MQTT::Client<Network, Timer, a, b>::sendPacket(int length, Timer& timer)
 }
 
 
-template<class Network, class Timer, int a, int b>
-int MQTT::Client<Network, Timer, a, b>::decodePacket(int* value, int timeout)
+template<class Network, class Timer, int a, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, a, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::decodePacket(int* value, int timeout)
 {
     unsigned char c;
     int multiplier = 1;
@@ -375,14 +504,54 @@ exit:
 }
 
 
+/**
+ * Take the next packet directly from the network buffer, if the network holds all of it
+ * in one contiguous buffer (e.g. a complete packet in a websocket frame).
+ * Packets larger than MAX_MQTT_PACKET_SIZE are left to readPacket, which rejects them.
+ * @return the length of the packet, which is then in rxbuf, or 0 if it has to be read
+ */
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::readPacketInPlace()
+{
+    unsigned char* buf;
+    unsigned char c;
+    int avail = ipstack.peek(&buf);
+    int multiplier = 1;
+    int rem_len = 0;
+    int len = 1;
+    const int MAX_NO_OF_REMAINING_LENGTH_BYTES = 4;
+
+    do
+    {
+        if (len > MAX_NO_OF_REMAINING_LENGTH_BYTES || len >= avail)
+            return 0;   /* incomplete or bad remaining length, left to readPacket */
+        c = buf[len++];
+        rem_len += (c & 127) * multiplier;
+        multiplier *= 128;
+    } while ((c & 128) != 0);
+
+    if (rem_len > (MAX_MQTT_PACKET_SIZE - len))
+        return 0;       /* too large, readPacket returns BUFFER_OVERFLOW */
+    if (rem_len > avail - len)
+        return 0;       /* the packet continues in the next buffer */
+
+    len += rem_len;
+    ipstack.consume(len);
+    rxbuf = buf;
+    rxlen = len;
+    return len;
+}
+
+
 /**
  * If any read fails in this method, then we should disconnect from the network, as on reconnect
  * the packets can be retried.
- * @param timeout the max time to wait for the packet read to complete, in milliseconds
- * @return the MQTT packet type, or -1 if none
+ * @param timer the max time to wait for the start of a packet, a packet that has started
+ *        is given the command timeout to complete
+ * @return the MQTT packet type, 0 if nothing arrived, or -1 on failure
  */
-template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b>
-int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b>::readPacket(Timer& timer)
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::readPacket(Timer& timer)
 {
     int rc = FAILURE;
     MQTTHeader header = {0};
@@ -390,98 +559,180 @@ int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b>::readPacket(Timer& tim
     int rem_len = 0;
 	int read = 0;
 
-    /* 1. read the header byte.  This has the packet type in it */
-    if (ipstack.read(readbuf, 1, timer.left_ms()) != 1)
-        goto exit;
+    /* 0. a packet that is complete in the network buffer is parsed there, without copying it */
+    if ((len = readPacketInPlace()) == 0)
+    {
+        rxbuf = readbuf;
+
+        /* 1. read the header byte.  This has the packet type in it */
+        if (ipstack.read(readbuf, 1, timer.left_ms()) != 1)
+        {
+            rc = 0;     /* nothing arrived */
+            goto exit;
+        }
 
-    len = 1;
-    /* 2. read the remaining length.  This is variable in itself */
-    decodePacket(&rem_len, timer.left_ms());
-    len += MQTTPacket_encode(readbuf + 1, rem_len); /* put the original remaining length into the buffer */
+        len = 1;
+        /* 2. read the remaining length.  This is variable in itself */
+        decodePacket(&rem_len, command_timeout_ms);
+        len += MQTTPacket_encode(readbuf + 1, rem_len); /* put the original remaining length into the buffer */
 
-	if (rem_len > (MAX_MQTT_PACKET_SIZE - len))
-	{
-		rc = BUFFER_OVERFLOW;
-		goto exit;
-	}
+        if (rem_len > (MAX_MQTT_PACKET_SIZE - len))
+        {
+            rc = BUFFER_OVERFLOW;
+            goto exit;
+        }
 
-    /* 3. read the rest of the buffer using a callback to supply the rest of the data */
-    if (rem_len > 0 && (ipstack.read(readbuf + len, rem_len, timer.left_ms()) != rem_len))
-        goto exit;
+        /* 3. read the rest of the buffer using a callback to supply the rest of the data */
+        if (rem_len > 0 && (ipstack.read(readbuf + len, rem_len, command_timeout_ms) != rem_len))
+            goto exit;
+        rxlen = len + rem_len;
+    }
 
-    header.byte = readbuf[0];
+    header.byte = rxbuf[0];
     rc = header.bits.type;
     if (this->keepAliveInterval > 0)
         last_received.countdown(this->keepAliveInterval); // record the fact that we have successfully received a packet
 exit:
         
 #if defined(MQTT_DEBUG)
-	if (rc >= 0)
+	if (rc > 0)
 	{
 		char printbuf[50];
-		DEBUG("Rc %d from receiving packet %s\n", rc, MQTTFormat_toClientString(printbuf, sizeof(printbuf), readbuf, len));
+		DEBUG("Rc %d from receiving packet %s\n", rc, MQTTFormat_toClientString(printbuf, sizeof(printbuf), rxbuf, rxlen));
 	}
 #endif
     return rc;
 }
 
 
-// assume topic filter and name is in correct format
-// # can only be at end
-// + and # can only be next to separator
-template<class Network, class Timer, int a, int b>
-bool MQTT::Client<Network, Timer, a, b>::isTopicMatched(char* topicFilter, MQTTString& topicName)
+template<class Network, class Timer, int a, int MAX_MESSAGE_HANDLERS, int c, int d, int e>
+unsigned char MQTT::Client<Network, Timer, a, MAX_MESSAGE_HANDLERS, c, d, e>::addTopicFilter(const char* topicFilter)
 {
-    char* curf = topicFilter;
-    char* curn = topicName.lenstring.data;
-    char* curn_end = curn + topicName.lenstring.len;
+    unsigned char* link = &topicRoot;
+    const char* level = topicFilter;
 
-    while (*curf && curn < curn_end)
+    while (true)
     {
-        if (*curn == '/' && *curf != '/')
-            break;
-        if (*curf != '+' && *curf != '#' && *curf != *curn)
-            break;
-        if (*curf == '+')
-        {   // skip until we meet the next separator, or end of string
-            char* nextpos = curn + 1;
-            while (nextpos < curn_end && *nextpos != '/')
-                nextpos = ++curn + 1;
+        const char* next = level;
+        while (*next && *next != '/')
+            ++next;
+        int len = next - level;
+        if (len > 255)
+            return 0;
+
+        unsigned char node = *link;
+        while (node != 0 && (topicNodes[node - 1].len != len || memcmp(topicNodes[node - 1].level, level, len) != 0))
+            node = topicNodes[node - 1].sibling;
+        if (node == 0)
+        {
+            if (topicNodeCount == MAX_MESSAGE_HANDLERS * MQTTCLIENT_MAX_TOPIC_LEVELS)
+                return 0;   // too many levels
+            TopicNode& added = topicNodes[topicNodeCount];
+            added.level = level;
+            added.len = len;
+            added.child = 0;
+            added.handler = 0;
+            added.sibling = *link;
+            node = *link = ++topicNodeCount;
         }
-        else if (*curf == '#')
-            curn = curn_end - 1;    // skip until end of string
-        curf++;
-        curn++;
-    };
 
-    return (curn == curn_end) && (*curf == '\0');
+        if (*next == '\0')
+            return node;
+        link = &topicNodes[node - 1].child;
+        level = next + 1;
+    }
 }
 
 
-
-template<class Network, class Timer, int a, int MAX_MESSAGE_HANDLERS>
-int MQTT::Client<Network, Timer, a, MAX_MESSAGE_HANDLERS>::deliverMessage(MQTTString& topicName, Message& message)
+// the trie only points into the filters of the current subscriptions, so it is rebuilt on each change
+template<class Network, class Timer, int a, int MAX_MESSAGE_HANDLERS, int c, int d, int e>
+bool MQTT::Client<Network, Timer, a, MAX_MESSAGE_HANDLERS, c, d, e>::buildTopicTrie()
 {
-    int rc = FAILURE;
+    bool rc = true;
 
-    // we have to find the right message handler - indexed by topic
+    topicNodeCount = 0;
+    topicRoot = 0;
     for (int i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
     {
-        if (messageHandlers[i].topicFilter != 0 && (MQTTPacket_equals(&topicName, (char*)messageHandlers[i].topicFilter) ||
-                isTopicMatched((char*)messageHandlers[i].topicFilter, topicName)))
+        if (messageHandlers[i].topicFilter == 0)
+            continue;
+        unsigned char node = addTopicFilter(messageHandlers[i].topicFilter);
+        if (node == 0)
         {
-            if (messageHandlers[i].fp.attached())
-            {
-                MessageData md(topicName, message);
-                messageHandlers[i].fp(md);
-                rc = SUCCESS;
-            }
+            messageHandlers[i].topicFilter = 0;
+            rc = false;
         }
+        else
+            topicNodes[node - 1].handler = i + 1;
     }
+    return rc;
+}
+
+
+template<class Network, class Timer, int a, int MAX_MESSAGE_HANDLERS, int c, int d, int e>
+void MQTT::Client<Network, Timer, a, MAX_MESSAGE_HANDLERS, c, d, e>::callMessageHandler(unsigned char handler, MessageData& md, int& rc)
+{
+    if (handler != 0 && messageHandlers[handler - 1].fp.attached())
+    {
+        messageHandlers[handler - 1].fp(md);
+        rc = SUCCESS;
+    }
+}
+
+
+// call the handlers of the filters that match the topic from level on, starting at the trie node first
+// + matches one level and # the rest of the topic, but not topics starting with $ on the top level
+template<class Network, class Timer, int a, int MAX_MESSAGE_HANDLERS, int c, int d, int e>
+void MQTT::Client<Network, Timer, a, MAX_MESSAGE_HANDLERS, c, d, e>::deliverToTopicNodes(unsigned char first, const char* level, const char* end, bool top, MessageData& md, int& rc)
+{
+    const char* next = level;
+    while (next < end && *next != '/')
+        ++next;
+    bool wildcards = !(top && level < end && *level == '$');
+
+    for (unsigned char i = first; i != 0; i = topicNodes[i - 1].sibling)
+    {
+        TopicNode& node = topicNodes[i - 1];
+        if (node.len == 1 && node.level[0] == '#')
+        {
+            if (wildcards)
+                callMessageHandler(node.handler, md, rc);
+            continue;
+        }
+        if (node.len == 1 && node.level[0] == '+')
+        {
+            if (!wildcards)
+                continue;
+        }
+        else if (node.len != next - level || memcmp(node.level, level, node.len) != 0)
+            continue;
+
+        if (next < end)
+            deliverToTopicNodes(node.child, next + 1, end, false, md, rc);
+        else
+        {
+            callMessageHandler(node.handler, md, rc);
+            // a/# also matches a
+            for (unsigned char child = node.child; child != 0; child = topicNodes[child - 1].sibling)
+                if (topicNodes[child - 1].len == 1 && topicNodes[child - 1].level[0] == '#')
+                    callMessageHandler(topicNodes[child - 1].handler, md, rc);
+        }
+    }
+}
+
+
+template<class Network, class Timer, int a, int MAX_MESSAGE_HANDLERS, int c, int d, int e>
+int MQTT::Client<Network, Timer, a, MAX_MESSAGE_HANDLERS, c, d, e>::deliverMessage(MQTTString& topicName, Message& message)
+{
+    int rc = FAILURE;
+    MessageData md(topicName, message);
+    const char* topic = topicName.lenstring.data;
+
+    // we have to find the right message handlers - by walking the topic through the trie of subscriptions
+    deliverToTopicNodes(topicRoot, topic, topic + topicName.lenstring.len, true, md, rc);
 
     if (rc == FAILURE && defaultMessageHandler.attached())
     {
-        MessageData md(topicName, message);
         defaultMessageHandler(md);
         rc = SUCCESS;
     }
@@ -491,28 +742,28 @@ int MQTT::Client<Network, Timer, a, MAX_MESSAGE_HANDLERS>::deliverMessage(MQTTSt
 
 
 
-template<class Network, class Timer, int a, int b>
-int MQTT::Client<Network, Timer, a, b>::yield(unsigned long timeout_ms)
+template<class Network, class Timer, int a, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, a, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::yield(unsigned long timeout_ms)
 {
     int rc = SUCCESS;
     Timer timer = Timer();
 
     timer.countdown_ms(timeout_ms);
-    while (!timer.expired())
+    do
     {
         if (cycle(timer) < 0)
         {
             rc = FAILURE;
             break;
         }
-    }
+    } while (!timer.expired());
 
     return rc;
 }
 
 
-template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b>
-int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b>::cycle(Timer& timer)
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::cycle(Timer& timer)
 {
     /* get one piece of work off the wire and one pass through */
 
@@ -529,16 +780,34 @@ int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b>::cycle(Timer& timer)
 			rc = packet_type;
 			break;
         case CONNACK:
-        case PUBACK:
         case SUBACK:
             break;
+#if MQTTCLIENT_QOS1 || MQTTCLIENT_QOS2
+        case PUBACK:
+#if MQTTCLIENT_QOS2
+        case PUBCOMP:
+#endif
+        {
+            unsigned short mypacketid;
+            unsigned char dup, type;
+            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, rxbuf, rxlen) != 1)
+            {
+                rc = FAILURE;
+                goto exit;
+            }
+            completeInflight(mypacketid);
+            break;
+        }
+#endif
         case PUBLISH:
 		{
             MQTTString topicName = MQTTString_initializer;
             Message msg;
+            int payloadlen;     // size_t is wider than int on 64 bit hosts
             if (MQTTDeserialize_publish((unsigned char*)&msg.dup, (int*)&msg.qos, (unsigned char*)&msg.retained, (unsigned short*)&msg.id, &topicName,
-                                 (unsigned char**)&msg.payload, (int*)&msg.payloadlen, readbuf, MAX_MQTT_PACKET_SIZE) != 1)
+                                 (unsigned char**)&msg.payload, &payloadlen, rxbuf, rxlen) != 1)
                 goto exit;
+            msg.payloadlen = payloadlen;
 #if MQTTCLIENT_QOS2
             if (msg.qos != QOS2)
 #endif
@@ -556,13 +825,14 @@ int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b>::cycle(Timer& timer)
             if (msg.qos != QOS0)
             {
                 if (msg.qos == QOS1)
-                    len = MQTTSerialize_ack(sendbuf, MAX_MQTT_PACKET_SIZE, PUBACK, 0, msg.id);
+                    len = MQTTSerialize_ack(sendbuf, MAX_TX_PACKET_SIZE, PUBACK, 0, msg.id);
                 else if (msg.qos == QOS2)
-                    len = MQTTSerialize_ack(sendbuf, MAX_MQTT_PACKET_SIZE, PUBREC, 0, msg.id);
+                    len = MQTTSerialize_ack(sendbuf, MAX_TX_PACKET_SIZE, PUBREC, 0, msg.id);
+                Timer ack_timer = Timer(command_timeout_ms);    // the yield timer may already be expired
                 if (len <= 0)
                     rc = FAILURE;
                 else
-                    rc = sendPacket(len, timer);
+                    rc = sendPacket(len, ack_timer);
                 if (rc == FAILURE)
                     goto exit; // there was a problem
             }
@@ -572,23 +842,23 @@ int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b>::cycle(Timer& timer)
 #if MQTTCLIENT_QOS2
         case PUBREC:
 		case PUBREL:
+		{
             unsigned short mypacketid;
             unsigned char dup, type;
-            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, readbuf, MAX_MQTT_PACKET_SIZE) != 1)
+            Timer ack_timer = Timer(command_timeout_ms);    // the yield timer may already be expired
+            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, rxbuf, rxlen) != 1)
                 rc = FAILURE;
-            else if ((len = MQTTSerialize_ack(sendbuf, MAX_MQTT_PACKET_SIZE, 
+            else if ((len = MQTTSerialize_ack(sendbuf, MAX_TX_PACKET_SIZE, 
 						(packet_type == PUBREC) ? PUBREL : PUBCOMP, 0, mypacketid)) <= 0)
                 rc = FAILURE;
-            else if ((rc = sendPacket(len, timer)) != SUCCESS) // send the PUBREL packet
+            else if ((rc = sendPacket(len, ack_timer)) != SUCCESS) // send the PUBREL packet
                 rc = FAILURE; // there was a problem
             if (rc == FAILURE)
                 goto exit; // there was a problem
 			if (packet_type == PUBREL)
 				freeQoS2msgid(mypacketid);
             break;
-			
-        case PUBCOMP:
-            break;
+		}
 #endif
         case PINGRESP:
             ping_outstanding = false;
@@ -602,8 +872,8 @@ exit:
 }
 
 
-template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b>
-int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b>::keepalive()
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::keepalive()
 {
     int rc = FAILURE;
 
@@ -618,7 +888,7 @@ int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b>::keepalive()
         if (!ping_outstanding)
         {
             Timer timer = Timer(1000);
-            int len = MQTTSerialize_pingreq(sendbuf, MAX_MQTT_PACKET_SIZE);
+            int len = MQTTSerialize_pingreq(sendbuf, MAX_TX_PACKET_SIZE);
             if (len > 0 && (rc = sendPacket(len, timer)) == SUCCESS) // send the ping packet
                 ping_outstanding = true;
         }
@@ -630,8 +900,8 @@ exit:
 
 
 // only used in single-threaded mode where one command at a time is in process
-template<class Network, class Timer, int a, int b>
-int MQTT::Client<Network, Timer, a, b>::waitfor(int packet_type, Timer& timer)
+template<class Network, class Timer, int a, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, a, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::waitfor(int packet_type, Timer& timer)
 {
     int rc = FAILURE;
 
@@ -646,121 +916,219 @@ int MQTT::Client<Network, Timer, a, b>::waitfor(int packet_type, Timer& timer)
 }
 
 
-template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b>
-int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b>::connect(MQTTPacket_connectData& options)
+// one pass through the packets that have arrived for the command started by beginConnect or beginSubscribe,
+// without blocking: the awaited packet type once its ack is in rxbuf, IN_PROGRESS, or FAILURE if it timed out
+template<class Network, class Timer, int a, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, a, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::pollFor(int packet_type)
+{
+    int rc = FAILURE;
+    Timer timer = Timer();
+
+    timer.countdown_ms(0);
+    if ((rc = cycle(timer)) == packet_type)
+        pending_type = 0;
+    else if (rc < 0 || pending_timer.expired())
+    {
+        pending_type = 0;
+        rc = FAILURE;
+    }
+    else
+        rc = IN_PROGRESS;
+    return rc;
+}
+
+
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::connect(MQTTPacket_connectData& options)
+{
+    int rc = beginConnect(options);
+
+    // this will be a blocking call, wait for the connack
+    if (rc == SUCCESS)
+    {
+        pending_type = 0;
+        if (waitfor(CONNACK, pending_timer) == CONNACK)
+            rc = connackReceived(pending_timer);
+        else
+            rc = FAILURE;
+    }
+    return rc;
+}
+
+
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::beginConnect(MQTTPacket_connectData& options)
 {
-    Timer connect_timer = Timer(command_timeout_ms);
     int rc = FAILURE;
     int len = 0;
 
+    pending_type = 0;
     if (isconnected) // don't send connect packet again if we are already connected
         goto exit;
 
+    pending_timer.countdown_ms(command_timeout_ms);
     this->keepAliveInterval = options.keepAliveInterval;
     this->cleansession = options.cleansession;
-    if ((len = MQTTSerialize_connect(sendbuf, MAX_MQTT_PACKET_SIZE, &options)) <= 0)
+    if ((len = MQTTSerialize_connect(sendbuf, MAX_TX_PACKET_SIZE, &options)) <= 0)
         goto exit;
-    if ((rc = sendPacket(len, connect_timer)) != SUCCESS)  // send the connect packet
+    if ((rc = sendPacket(len, pending_timer)) != SUCCESS)  // send the connect packet
         goto exit; // there was a problem
 
     if (this->keepAliveInterval > 0)
         last_received.countdown(this->keepAliveInterval);
-    // this will be a blocking call, wait for the connack
-    if (waitfor(CONNACK, connect_timer) == CONNACK)
-    {
-        unsigned char connack_rc = 255;
-        bool sessionPresent = false;
-        if (MQTTDeserialize_connack((unsigned char*)&sessionPresent, &connack_rc, readbuf, MAX_MQTT_PACKET_SIZE) == 1)
-            rc = connack_rc;
-        else
-            rc = FAILURE;
-    }
-    else
-        rc = FAILURE;
+    pending_type = CONNACK;
+
+exit:
+    return rc;
+}
+
+
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::pollConnect()
+{
+    int rc = FAILURE;
+
+    if (pending_type != CONNACK)
+        return rc;      // nothing was started
+    if ((rc = pollFor(CONNACK)) == CONNACK)
+        rc = connackReceived(pending_timer);
+    return rc;
+}
+
+
+// the connack is in rxbuf, the connection is accepted if its return code is 0
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::connackReceived(Timer& timer)
+{
+    int rc = FAILURE;
+    unsigned char connack_rc = 255;
+    bool sessionPresent = false;
+
+    if (MQTTDeserialize_connack((unsigned char*)&sessionPresent, &connack_rc, rxbuf, rxlen) == 1)
+        rc = connack_rc;
 
-#if MQTTCLIENT_QOS2
-    // resend an inflight publish
-    if (inflightMsgid >0 && inflightQoS == QOS2 && pubrel)
-    {
-        if ((len = MQTTSerialize_ack(sendbuf, MAX_MQTT_PACKET_SIZE, PUBREL, 0, inflightMsgid)) <= 0)
-            rc = FAILURE;
-        else
-            rc = publish(len, connect_timer, inflightQoS);
-    }
-    else
-#endif
 #if MQTTCLIENT_QOS1 || MQTTCLIENT_QOS2
-    if (inflightMsgid > 0)
+    // resend the inflight publishes, their acks are received by the following cycles
+    for (int i = 0; i < MAX_INFLIGHT_PUBLISHES && rc == SUCCESS; ++i)
     {
-        memcpy(sendbuf, pubbuf, MAX_MQTT_PACKET_SIZE);
-        rc = publish(inflightLen, connect_timer, inflightQoS);
+        if (inflight[i].msgid == 0)
+            continue;
+        MQTTHeader header = {0};
+        memcpy(sendbuf, inflight[i].pubbuf, inflight[i].len);
+        header.byte = sendbuf[0];
+        header.bits.dup = 1;
+        sendbuf[0] = header.byte;
+        rc = sendPacket(inflight[i].len, timer);
     }
 #endif
 
-exit:
     if (rc == SUCCESS)
         isconnected = true;
     return rc;
 }
 
 
-template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b>
-int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b>::connect()
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::connect()
 {
     MQTTPacket_connectData default_options = MQTTPacket_connectData_initializer;
     return connect(default_options);
 }
 
 
-template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int MAX_MESSAGE_HANDLERS>
-int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, MAX_MESSAGE_HANDLERS>::subscribe(const char* topicFilter, enum QoS qos, messageHandler messageHandler)
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int MAX_MESSAGE_HANDLERS, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, MAX_MESSAGE_HANDLERS, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::subscribe(const char* topicFilter, enum QoS qos, messageHandler messageHandler)
+{
+    int rc = beginSubscribe(topicFilter, qos, messageHandler);
+
+    if (rc == SUCCESS)
+    {
+        pending_type = 0;
+        if (waitfor(SUBACK, pending_timer) == SUBACK)      // wait for suback
+            rc = subackReceived(topicFilter, messageHandler);
+        else
+            rc = FAILURE;
+    }
+    if (rc != SUCCESS)
+        isconnected = false;
+    return rc;
+}
+
+
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int MAX_MESSAGE_HANDLERS, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, MAX_MESSAGE_HANDLERS, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::beginSubscribe(const char* topicFilter, enum QoS qos, messageHandler messageHandler)
 {
     int rc = FAILURE;
-    Timer timer = Timer(command_timeout_ms);
     int len = 0;
     MQTTString topic = {(char*)topicFilter, 0, 0};
 
+    pending_type = 0;
     if (!isconnected)
         goto exit;
 
-    len = MQTTSerialize_subscribe(sendbuf, MAX_MQTT_PACKET_SIZE, 0, packetid.getNext(), 1, &topic, (int*)&qos);
+    pending_timer.countdown_ms(command_timeout_ms);
+    len = MQTTSerialize_subscribe(sendbuf, MAX_TX_PACKET_SIZE, 0, packetid.getNext(), 1, &topic, (int*)&qos);
     if (len <= 0)
         goto exit;
-    if ((rc = sendPacket(len, timer)) != SUCCESS) // send the subscribe packet
+    if ((rc = sendPacket(len, pending_timer)) != SUCCESS) // send the subscribe packet
         goto exit;             // there was a problem
 
-    if (waitfor(SUBACK, timer) == SUBACK)      // wait for suback
+    pending_type = SUBACK;
+    pending_filter = topicFilter;
+    pending_handler = messageHandler;
+
+exit:
+    if (rc != SUCCESS)
+        isconnected = false;
+    return rc;
+}
+
+
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int MAX_MESSAGE_HANDLERS, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, MAX_MESSAGE_HANDLERS, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::pollSubscribe()
+{
+    int rc = FAILURE;
+
+    if (pending_type != SUBACK)
+        return rc;      // nothing was started
+    if ((rc = pollFor(SUBACK)) == SUBACK)
+        rc = subackReceived(pending_filter, pending_handler);
+    if (rc != SUCCESS && rc != IN_PROGRESS)
+        isconnected = false;
+    return rc;
+}
+
+
+// the suback is in rxbuf, the handler is attached if the subscription was granted
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int MAX_MESSAGE_HANDLERS, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, MAX_MESSAGE_HANDLERS, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::subackReceived(const char* topicFilter, messageHandler messageHandler)
+{
+    int rc = FAILURE;
+    int count = 0, grantedQoS = -1;
+    unsigned short mypacketid;
+
+    if (MQTTDeserialize_suback(&mypacketid, 1, &count, &grantedQoS, rxbuf, rxlen) == 1)
+        rc = grantedQoS; // 0, 1, 2 or 0x80
+    if (rc != 0x80)
     {
-        int count = 0, grantedQoS = -1;
-        unsigned short mypacketid;
-        if (MQTTDeserialize_suback(&mypacketid, 1, &count, &grantedQoS, readbuf, MAX_MQTT_PACKET_SIZE) == 1)
-            rc = grantedQoS; // 0, 1, 2 or 0x80
-        if (rc != 0x80)
+        for (int i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
         {
-            for (int i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
+            // a resubscribe after reconnecting replaces the handler of the same topic
+            if (messageHandlers[i].topicFilter == 0 || strcmp(messageHandlers[i].topicFilter, topicFilter) == 0)
             {
-                if (messageHandlers[i].topicFilter == 0)
-                {
-                    messageHandlers[i].topicFilter = topicFilter;
-                    messageHandlers[i].fp.attach(messageHandler);
-                    rc = 0;
-                    break;
-                }
+                messageHandlers[i].topicFilter = topicFilter;
+                messageHandlers[i].fp.attach(messageHandler);
+                rc = buildTopicTrie() ? 0 : FAILURE;
+                break;
             }
         }
     }
-    else
-        rc = FAILURE;
-
-exit:
-    if (rc != SUCCESS)
-        isconnected = false;
     return rc;
 }
 
 
-template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int MAX_MESSAGE_HANDLERS>
-int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, MAX_MESSAGE_HANDLERS>::unsubscribe(const char* topicFilter)
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int MAX_MESSAGE_HANDLERS, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, MAX_MESSAGE_HANDLERS, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::unsubscribe(const char* topicFilter)
 {
     int rc = FAILURE;
     Timer timer = Timer(command_timeout_ms);
@@ -770,7 +1138,7 @@ int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, MAX_MESSAGE_HANDLERS>::un
     if (!isconnected)
         goto exit;
 
-    if ((len = MQTTSerialize_unsubscribe(sendbuf, MAX_MQTT_PACKET_SIZE, 0, packetid.getNext(), 1, &topic)) <= 0)
+    if ((len = MQTTSerialize_unsubscribe(sendbuf, MAX_TX_PACKET_SIZE, 0, packetid.getNext(), 1, &topic)) <= 0)
         goto exit;
     if ((rc = sendPacket(len, timer)) != SUCCESS) // send the unsubscribe packet
         goto exit; // there was a problem
@@ -778,8 +1146,14 @@ int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, MAX_MESSAGE_HANDLERS>::un
     if (waitfor(UNSUBACK, timer) == UNSUBACK)
     {
         unsigned short mypacketid;  // should be the same as the packetid above
-        if (MQTTDeserialize_unsuback(&mypacketid, readbuf, MAX_MQTT_PACKET_SIZE) == 1)
+        if (MQTTDeserialize_unsuback(&mypacketid, rxbuf, rxlen) == 1)
+        {
+            for (int i = 0; i < MAX_MESSAGE_HANDLERS; ++i)
+                if (messageHandlers[i].topicFilter != 0 && strcmp(messageHandlers[i].topicFilter, topicFilter) == 0)
+                    messageHandlers[i].topicFilter = 0;
+            buildTopicTrie();
             rc = 0;
+        }
     }
     else
         rc = FAILURE;
@@ -791,43 +1165,90 @@ exit:
 }
 
 
-template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b>
-int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b>::publish(int len, Timer& timer, enum QoS qos)
+template<class Network, class Timer, int a, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, a, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::inflightCount()
 {
-    int rc;
+    int count = 0;
+#if MQTTCLIENT_QOS1 || MQTTCLIENT_QOS2
+    for (int i = 0; i < MAX_INFLIGHT_PUBLISHES; ++i)
+        if (inflight[i].msgid != 0)
+            ++count;
+#endif
+    return count;
+}
 
-    if ((rc = sendPacket(len, timer)) != SUCCESS) // send the publish packet
-        goto exit; // there was a problem
 
-#if MQTTCLIENT_QOS1
-    if (qos == QOS1)
+template<class Network, class Timer, int a, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+bool MQTT::Client<Network, Timer, a, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::isInflight(unsigned short id)
+{
+#if MQTTCLIENT_QOS1 || MQTTCLIENT_QOS2
+    for (int i = 0; i < MAX_INFLIGHT_PUBLISHES; ++i)
+        if (inflight[i].msgid == id)
+            return true;
+#endif
+    return false;
+}
+
+
+// keep the publish packet in sendbuf in a free slot of the in-flight window,
+// false if the window is full or the packet is larger than MAX_PUB_PACKET_SIZE
+template<class Network, class Timer, int a, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+bool MQTT::Client<Network, Timer, a, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::storeInflight(unsigned short id, enum QoS qos, int len)
+{
+#if MQTTCLIENT_QOS1 || MQTTCLIENT_QOS2
+    if (len > MAX_PUB_PACKET_SIZE)
+        return false;
+    for (int i = 0; i < MAX_INFLIGHT_PUBLISHES; ++i)
     {
-        if (waitfor(PUBACK, timer) == PUBACK)
+        if (inflight[i].msgid == 0)
         {
-            unsigned short mypacketid;
-            unsigned char dup, type;
-            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, readbuf, MAX_MQTT_PACKET_SIZE) != 1)
-                rc = FAILURE;
-            else if (inflightMsgid == mypacketid)
-                inflightMsgid = 0;
+            memcpy(inflight[i].pubbuf, sendbuf, len);
+            inflight[i].msgid = id;
+            inflight[i].len = len;
+            inflight[i].qos = qos;
+            return true;
         }
-        else
-            rc = FAILURE;
     }
-#elif MQTTCLIENT_QOS2
-    else if (qos == QOS2)
+#endif
+    return false;
+}
+
+
+template<class Network, class Timer, int a, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+void MQTT::Client<Network, Timer, a, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::completeInflight(unsigned short id)
+{
+#if MQTTCLIENT_QOS1 || MQTTCLIENT_QOS2
+    for (int i = 0; i < MAX_INFLIGHT_PUBLISHES; ++i)
     {
-        if (waitfor(PUBCOMP, timer) == PUBCOMP)
+        if (inflight[i].msgid == id)
         {
-            unsigned short mypacketid;
-            unsigned char dup, type;
-            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, readbuf, MAX_MQTT_PACKET_SIZE) != 1)
-                rc = FAILURE;
-            else if (inflightMsgid == mypacketid)
-                inflightMsgid = 0;
+            inflight[i].msgid = 0;
+            if (publishCompleteFP.attached())
+                publishCompleteFP(id);
+            return;
         }
-        else
+    }
+#endif
+}
+
+
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::publish(int len, Timer& timer, enum QoS qos, unsigned short id)
+{
+    int rc;
+
+    if ((rc = sendPacket(len, timer)) != SUCCESS) // send the publish packet
+        goto exit; // there was a problem
+
+#if MQTTCLIENT_QOS1 || MQTTCLIENT_QOS2
+    // the ack is taken out of the in-flight window by cycle, acks of other publishes may arrive first
+    while (qos != QOS0 && isInflight(id))
+    {
+        if (timer.expired() || cycle(timer) < 0)
+        {
             rc = FAILURE;
+            break;
+        }
     }
 #endif
 
@@ -839,8 +1260,8 @@ exit:
 
 
 
-template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b>
-int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b>::publish(const char* topicName, void* payload, size_t payloadlen, unsigned short& id, enum QoS qos, bool retained)
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::publish(const char* topicName, void* payload, size_t payloadlen, unsigned short& id, enum QoS qos, bool retained)
 {
     int rc = FAILURE;
     Timer timer = Timer(command_timeout_ms);
@@ -854,54 +1275,83 @@ int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b>::publish(const char* t
 
 #if MQTTCLIENT_QOS1 || MQTTCLIENT_QOS2
     if (qos == QOS1 || qos == QOS2)
-        id = packetid.getNext();
+    {
+        do
+            id = packetid.getNext();
+        while (isInflight(id));
+    }
 #endif
 
-    len = MQTTSerialize_publish(sendbuf, MAX_MQTT_PACKET_SIZE, 0, qos, retained, id,
+    len = MQTTSerialize_publish(sendbuf, MAX_TX_PACKET_SIZE, 0, qos, retained, id,
               topicString, (unsigned char*)payload, payloadlen);
     if (len <= 0)
         goto exit;
 
 #if MQTTCLIENT_QOS1 || MQTTCLIENT_QOS2
-    if (!cleansession)
-    {
-        memcpy(pubbuf, sendbuf, len);
-        inflightMsgid = id;
-        inflightLen = len;
-        inflightQoS = qos;
-#if MQTTCLIENT_QOS2
-        pubrel = false;
-#endif
-    }
+    // the window slot is kept until the ack arrives, so a failed publish is resent on reconnect
+    if (qos != QOS0 && !storeInflight(id, qos, len))
+        goto exit;
 #endif
 
-    rc = publish(len, timer, qos);
+    rc = publish(len, timer, qos, id);
+exit:
+    return rc;
+}
+
+
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::publishAsync(const char* topicName, void* payload, size_t payloadlen, unsigned short& id, bool retained)
+{
+    int rc = FAILURE;
+    Timer timer = Timer(command_timeout_ms);
+    MQTTString topicString = MQTTString_initializer;
+    int len = 0;
+    unsigned short next = 0;
+
+    id = 0;
+    if (!isconnected || inflightCount() == MAX_INFLIGHT_PUBLISHES)
+        goto exit;
+
+    topicString.cstring = (char*)topicName;
+
+    do
+        next = packetid.getNext();
+    while (isInflight(next));
+
+    len = MQTTSerialize_publish(sendbuf, MAX_TX_PACKET_SIZE, 0, QOS1, retained, next,
+              topicString, (unsigned char*)payload, payloadlen);
+    if (len <= 0 || !storeInflight(next, QOS1, len))
+        goto exit;
+    id = next;
+
+    if ((rc = sendPacket(len, timer)) != SUCCESS)
+        isconnected = false;    // the publish stays in flight and is resent on reconnect
 exit:
     return rc;
 }
 
 
-template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b>
-int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b>::publish(const char* topicName, void* payload, size_t payloadlen, enum QoS qos, bool retained)
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::publish(const char* topicName, void* payload, size_t payloadlen, enum QoS qos, bool retained)
 {
     unsigned short id = 0;  // dummy - not used for anything
     return publish(topicName, payload, payloadlen, id, qos, retained);
 }
 
 
-template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b>
-int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b>::publish(const char* topicName, Message& message)
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::publish(const char* topicName, Message& message)
 {
     return publish(topicName, message.payload, message.payloadlen, message.qos, message.retained);
 }
 
 
-template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b>
-int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b>::disconnect()
+template<class Network, class Timer, int MAX_MQTT_PACKET_SIZE, int b, int MAX_INFLIGHT_PUBLISHES, int MAX_TX_PACKET_SIZE, int MAX_PUB_PACKET_SIZE>
+int MQTT::Client<Network, Timer, MAX_MQTT_PACKET_SIZE, b, MAX_INFLIGHT_PUBLISHES, MAX_TX_PACKET_SIZE, MAX_PUB_PACKET_SIZE>::disconnect()
 {
     int rc = FAILURE;
     Timer timer = Timer(command_timeout_ms);     // we might wait for incomplete incoming publishes to complete
-    int len = MQTTSerialize_disconnect(sendbuf, MAX_MQTT_PACKET_SIZE);
+    int len = MQTTSerialize_disconnect(sendbuf, MAX_TX_PACKET_SIZE);
     if (len > 0)
         rc = sendPacket(len, timer);            // send the disconnect packet
 
@@ -45,11 +45,25 @@ public:
         return iface.readBytes(buffer, len);
     }
     
+    int peek(unsigned char** buffer)
+    {
+        return 0;   // no in place reads
+    }
+
+    void consume(int len)
+    {
+    }
+    
     int write(char* buffer, int len, int timeout)
     {
         iface.setTimeout(timeout);  
         return iface.write((uint8_t*)buffer, len);
     }
+
+    int write(char* buffer, int len, int timeout, int headroom)
+    {
+        return write(buffer, len, timeout);
+    }
     
     int disconnect()
     {
@@ -11,13 +11,13 @@
 #include <ArduinoOTA.h>
 #include <Wire.h>
 #include <AWSWebSocketClient.h>
+#include <ESP8266AWSImplementations.h>
 #include <IPStack.h>
 #include <Countdown.h>
 #include <MQTTClient.h>
 #include "config.h"
 
 const int PIN_STATUS_LED = 2;
-const int JSON_BUFFER_LENGTH = 512;
 const int NUM_POSITION_BUTTONS = 4;
 const uint16_t HEIGHT_MAX = 6000;
 const uint16_t HEIGHT_MIN = 500;
@@ -26,8 +26,20 @@ const uint8_t I2C_ADDRESS = 0x10;
 const int WEBSOCKET_PORT = 443;
 const int WEBSOCKET_BUFFER_SIZE = 1000;
 const int MQTT_MAX_PACKAGE_SIZE = 512;
-const int MQTT_MAX_MESSAGE_HANDLERS = 1;
-const int MQTT_YIELD_TIMEOUT_MS = 10;
+const int MQTT_MAX_TX_PACKAGE_SIZE = 256;
+const int MQTT_MAX_MESSAGE_HANDLERS = 2;
+const int MQTT_MAX_INFLIGHT_PUBLISHES = 1;
+const int MQTT_YIELD_TIMEOUT_MS = 0;
+const unsigned int MQTT_COMMAND_TIMEOUT_MS = 3000;
+const unsigned long AWS_IOT_BACKOFF_MIN_MS = 1000;
+const unsigned long AWS_IOT_BACKOFF_MAX_MS = 64000;
+const size_t COMMAND_MIN_LENGTH = 4;
+const size_t COMMAND_MAX_LENGTH = 8;
+const unsigned long COMMAND_DUPLICATE_WINDOW_MS = 10000;
+const int RTC_SSL_SESSION_OFFSET = 0;
+const int RTC_SHADOW_VERSION_OFFSET = 64;
+const uint32_t RTC_SHADOW_VERSION_MAGIC = 0x56455232;
+const uint32_t SHADOW_VERSION_RESET_DISTANCE = 100;
 const unsigned long SERIAL_BAUD_RATE = 115200;
 
 enum I2CCommand {
@@ -45,11 +57,137 @@ enum I2CCommand {
   I2C_CMD_READ_POSITIONS
 };
 
+// last applied shadow delta, kept in the rtc user memory behind the tls session
+struct ShadowVersionRTC {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t checksum;
+};
+
+// the json bodies of the rest api and of the shadow messages, parsed and printed with
+// JsonStruct, without a json buffer; a has... member tells if the key was in the json
+
+// GET /height
+struct HeightJson {
+  uint16_t value;
+
+  template <typename TFields>
+  static void jsonFields(TFields &fields) {
+    fields("value", &HeightJson::value);
+  }
+};
+
+// PUT /move, the state of a shadow delta and the reported state of a shadow update
+struct MoveJson {
+  char move[10];
+  bool hasMove;
+  int height;
+  bool hasHeight;
+  int position;
+  bool hasPosition;
+
+  template <typename TFields>
+  static void jsonFields(TFields &fields) {
+    fields("move", &MoveJson::move, &MoveJson::hasMove);
+    fields("height", &MoveJson::height, &MoveJson::hasHeight);
+    fields("position", &MoveJson::position, &MoveJson::hasPosition);
+  }
+};
+
+// GET and PUT /config
+struct ConfigJson {
+  int threshold;
+  bool hasThreshold;
+
+  template <typename TFields>
+  static void jsonFields(TFields &fields) {
+    fields("threshold", &ConfigJson::threshold, &ConfigJson::hasThreshold);
+  }
+};
+
+// GET and PUT /positions, the heights of the position buttons
+struct PositionsJson {
+  int position0;
+  bool hasPosition0;
+  int position1;
+  bool hasPosition1;
+  int position2;
+  bool hasPosition2;
+  int position3;
+  bool hasPosition3;
+
+  template <typename TFields>
+  static void jsonFields(TFields &fields) {
+    fields("position0", &PositionsJson::position0, &PositionsJson::hasPosition0);
+    fields("position1", &PositionsJson::position1, &PositionsJson::hasPosition1);
+    fields("position2", &PositionsJson::position2, &PositionsJson::hasPosition2);
+    fields("position3", &PositionsJson::position3, &PositionsJson::hasPosition3);
+  }
+};
+
+// the delta of the shadow, its version is read by shadowDeltaVersion()
+struct ShadowDeltaJson {
+  MoveJson state;
+
+  template <typename TFields>
+  static void jsonFields(TFields &fields) {
+    fields("state", &ShadowDeltaJson::state);
+  }
+};
+
+struct ShadowUpdateStateJson {
+  // always NULL, which clears the desired state; a const char* field can
+  // only be printed, so this struct is never parsed
+  const char *desired;
+  MoveJson reported;
+
+  template <typename TFields>
+  static void jsonFields(TFields &fields) {
+    fields("desired", &ShadowUpdateStateJson::desired);
+    fields("reported", &ShadowUpdateStateJson::reported);
+  }
+};
+
+struct ShadowUpdateJson {
+  ShadowUpdateStateJson state;
+
+  template <typename TFields>
+  static void jsonFields(TFields &fields) {
+    fields("state", &ShadowUpdateJson::state);
+  }
+};
+
+enum AwsIotState {
+  AWS_IOT_BACKOFF,
+  AWS_IOT_TIME,
+  AWS_IOT_SIGN,
+  AWS_IOT_WEBSOCKET,
+  AWS_IOT_MQTT_CONNECT,
+  AWS_IOT_MQTT_CONNACK,
+  AWS_IOT_SUBSCRIBE_SHADOW,
+  AWS_IOT_SUBSCRIBE_COMMANDS,
+  AWS_IOT_CONNECTED
+};
+
+typedef MQTT::Client<IPStack, Countdown, MQTT_MAX_PACKAGE_SIZE, MQTT_MAX_MESSAGE_HANDLERS,
+    MQTT_MAX_INFLIGHT_PUBLISHES, MQTT_MAX_TX_PACKAGE_SIZE> MqttClient;
+
 MDNSResponder mdns;
 ESP8266WebServer server(80);
+Esp8266SntpDateTimeProvider dateTimeProvider;
 AWSWebSocketClient awsIotClient(WEBSOCKET_BUFFER_SIZE);
 IPStack mqttIpStack(awsIotClient);
-MQTT::Client<IPStack, Countdown, MQTT_MAX_PACKAGE_SIZE, MQTT_MAX_MESSAGE_HANDLERS> *mqttClient = NULL;
+MqttClient mqttClient(mqttIpStack, MQTT_COMMAND_TIMEOUT_MS);
+AwsIotState awsIotState = AWS_IOT_TIME;
+unsigned long awsIotBackoffMs = AWS_IOT_BACKOFF_MIN_MS;
+unsigned long awsIotNextAttemptTime = 0;
+bool awsIotSubscribePending = false;
+uint8_t lastCommandSequence = 0;
+unsigned long lastCommandTime = 0;
+bool lastCommandValid = false;
+uint8_t shadowReportCommand = I2C_CMD_NOOP;
+uint16_t shadowReportArgument = 0;
+uint32_t shadowVersion = 0;
 
 void log(const char *str, ...);
 void logProgress();
@@ -61,9 +199,17 @@ void setupWebServer();
 void setupAwsIot();
 void loop();
 bool waitForI2CBytesAvailable(int waitForNumBytess);
-bool awsIotConnect ();
-void awsIotSubscribeToShadowUpdates();
+void awsIotLoop();
+void awsIotConnectFailed();
+void awsIotConnected();
+bool awsIotMqttConnect();
+int awsIotSubscribe(const char *topic, MqttClient::messageHandler handler);
 void awsIotMessageReceived(MQTT::MessageData& message);
+void awsIotCommandReceived(MQTT::MessageData& message);
+bool awsIotReportShadowState();
+bool shadowDeltaVersion(const char *json, size_t length, uint32_t &version);
+void loadShadowVersion();
+void saveShadowVersion();
 void tableStop();
 void tableMoveUp();
 void tableMoveDown();
@@ -126,13 +272,7 @@ void setupOTA() {
 void loop() {
   ArduinoOTA.handle();
   server.handleClient();
-  if (awsIotClient.connected ()) {
-     mqttClient->yield(MQTT_YIELD_TIMEOUT_MS);
-  } else {
-    if (awsIotConnect()){
-      awsIotSubscribeToShadowUpdates();
-    }
-  }
+  awsIotLoop();
 }
 
 void setupWebServer() {
@@ -146,12 +286,10 @@ void setupWebServer() {
     Wire.endTransmission();
     Wire.requestFrom(I2C_ADDRESS, 2);
     if (waitForI2CBytesAvailable(2)) {
-      uint16_t height = Wire.read() + (Wire.read() << 8);
-      StaticJsonBuffer<JSON_BUFFER_LENGTH> jsonBuffer;
-      JsonObject &json = jsonBuffer.createObject();
-      json["value"] = height;
+      HeightJson height;
+      height.value = Wire.read() + (Wire.read() << 8);
       String responseString;
-      json.printTo(responseString);
+      JsonStruct<HeightJson>(height).printTo(responseString);
       server.send(200, "application/json", responseString);
     } else {
       server.send(500);
@@ -159,14 +297,13 @@ void setupWebServer() {
   });
 
   server.on("/move", HTTP_PUT, [](){
-    StaticJsonBuffer<JSON_BUFFER_LENGTH> jsonBuffer;
-    JsonObject &json = jsonBuffer.parseObject(server.arg("plain"));
-    if (json.success()) {
-      if (json.containsKey("height")) {
-        tableMoveToHeight((int) json["height"]);
+    MoveJson move = MoveJson();
+    if (JsonStruct<MoveJson>(move).parse(server.arg("plain"))) {
+      if (move.hasHeight) {
+        tableMoveToHeight(move.height);
       }
-      else if (json.containsKey("position")) {
-        tableMoveToPosition((int) json["position"]);
+      else if (move.hasPosition) {
+        tableMoveToPosition(move.position);
       }
       server.send(204);
     } else {
@@ -175,27 +312,25 @@ void setupWebServer() {
   });
 
   server.on("/config", HTTP_GET, [](){
-    StaticJsonBuffer<JSON_BUFFER_LENGTH> jsonBuffer;
-    JsonObject &json = jsonBuffer.createObject();
+    ConfigJson config = ConfigJson();
     Wire.beginTransmission(I2C_ADDRESS);
     Wire.write(I2C_CMD_READ_HEIGHT_THRESHOLD);
     Wire.endTransmission();
     Wire.requestFrom(I2C_ADDRESS, 2);
     if (waitForI2CBytesAvailable(2)) {
-      uint16_t threshold = Wire.read() + (Wire.read() << 8);
-      json["threshold"] = threshold;
+      config.threshold = (uint16_t) (Wire.read() + (Wire.read() << 8));
+      config.hasThreshold = true;
     }
     String responseString;
-    json.printTo(responseString);
+    JsonStruct<ConfigJson>(config).printTo(responseString);
     server.send(200, "application/json", responseString);
   });
 
   server.on("/config", HTTP_PUT, [](){
-    StaticJsonBuffer<JSON_BUFFER_LENGTH> jsonBuffer;
-    JsonObject &json = jsonBuffer.parseObject(server.arg("plain"));
-    if (json.success()) {
-      if (json.containsKey("threshold")) {
-        int threshold = json["threshold"];
+    ConfigJson config = ConfigJson();
+    if (JsonStruct<ConfigJson>(config).parse(server.arg("plain"))) {
+      if (config.hasThreshold) {
+        int threshold = config.threshold;
         uint8_t data[] = {I2C_CMD_STORE_THRESHOLD, (uint8_t) (threshold & 0xff), (uint8_t) (threshold >> 8)};
         Wire.beginTransmission(I2C_ADDRESS);
         Wire.write(data, 3);
@@ -228,18 +363,14 @@ void setupWebServer() {
     Wire.endTransmission();
     Wire.requestFrom(I2C_ADDRESS, 2 * NUM_POSITION_BUTTONS);
     if (waitForI2CBytesAvailable(2)) {
-      StaticJsonBuffer<JSON_BUFFER_LENGTH> jsonBuffer;
-      JsonObject &json = jsonBuffer.createObject();
-      uint16_t position = Wire.read() + (Wire.read() << 8);
-      json["position0"] = position;
-      position = Wire.read() + (Wire.read() << 8);
-      json["position1"] = position;
-      position = Wire.read() + (Wire.read() << 8);
-      json["position2"] = position;
-      position = Wire.read() + (Wire.read() << 8);
-      json["position3"] = position;
+      PositionsJson positions;
+      positions.position0 = (uint16_t) (Wire.read() + (Wire.read() << 8));
+      positions.position1 = (uint16_t) (Wire.read() + (Wire.read() << 8));
+      positions.position2 = (uint16_t) (Wire.read() + (Wire.read() << 8));
+      positions.position3 = (uint16_t) (Wire.read() + (Wire.read() << 8));
+      positions.hasPosition0 = positions.hasPosition1 = positions.hasPosition2 = positions.hasPosition3 = true;
       String responseString;
-      json.printTo(responseString);
+      JsonStruct<PositionsJson>(positions).printTo(responseString);
       server.send(200, "application/json", responseString);
     } else {
       server.send(500);
@@ -247,14 +378,15 @@ void setupWebServer() {
   });
 
   server.on("/positions", HTTP_PUT, [](){
-    StaticJsonBuffer<JSON_BUFFER_LENGTH> jsonBuffer;
-    JsonObject &json = jsonBuffer.parseObject(server.arg("plain"));
-    if (json.success()) {
-      char * attrName = "positionX";
+    PositionsJson positions = PositionsJson();
+    if (JsonStruct<PositionsJson>(positions).parse(server.arg("plain"))) {
+      const bool present[NUM_POSITION_BUTTONS] = {positions.hasPosition0, positions.hasPosition1,
+          positions.hasPosition2, positions.hasPosition3};
+      const int values[NUM_POSITION_BUTTONS] = {positions.position0, positions.position1,
+          positions.position2, positions.position3};
       for (int i = 0; i < NUM_POSITION_BUTTONS; ++i) {
-        sprintf(attrName, "position%1d", i);
-        if (json.containsKey(attrName)) {
-          int position = json[attrName];
+        if (present[i]) {
+          int position = values[i];
           uint8_t data[] = {I2C_CMD_STORE_POSITION, i, (uint8_t) (position & 0xff), (uint8_t) (position >> 8)};
           Wire.beginTransmission(I2C_ADDRESS);
           Wire.write(data, 3);
@@ -275,11 +407,17 @@ void setupWebServer() {
 }
 
 void setupAwsIot() {
+  dateTimeProvider.begin();
+  awsIotClient.setDateTimeProvider(&dateTimeProvider);
   awsIotClient.setAWSDomain(AWS_ENDPOINT);
   awsIotClient.setAWSRegion(AWS_REGION);
   awsIotClient.setAWSKeyID(AWS_ACCESS_KEY_ID);
   awsIotClient.setAWSSecretKey(AWS_SECRET_ACCESS_KEY);
   awsIotClient.setUseSSL(true);
+#ifdef WEBSOCKETS_SSL_SESSION
+  awsIotClient.setSSLSessionRTCOffset(RTC_SSL_SESSION_OFFSET);
+#endif
+  loadShadowVersion();
 }
 
 bool waitForI2CBytesAvailable(int waitForNumBytess) {
@@ -292,77 +430,388 @@ bool waitForI2CBytesAvailable(int waitForNumBytess) {
   return true;
 }
 
-bool awsIotConnect () {
-  if (mqttClient == NULL) {
-    mqttClient = new MQTT::Client<IPStack, Countdown, MQTT_MAX_PACKAGE_SIZE, MQTT_MAX_MESSAGE_HANDLERS>(mqttIpStack);
-  } else {
-    if (mqttClient->isConnected ()) {
-      mqttClient->disconnect ();
-    }
-    delete mqttClient;
-    mqttClient = new MQTT::Client<IPStack, Countdown, MQTT_MAX_PACKAGE_SIZE, MQTT_MAX_MESSAGE_HANDLERS>(mqttIpStack);
+/**
+ * Advances the AWS IoT connection by at most one step per call, so that the web server and OTA
+ * stay responsive while the cloud is unreachable. Failed attempts are retried with an exponential
+ * backoff and random jitter.
+ * The MQTT connect and subscribes are sent by one call and their acks polled by the following ones.
+ * The only step that still blocks is the first poll of the WebSocket connection, which resolves the
+ * endpoint (unless its address is cached) and opens the TCP and TLS connection, the ESP8266 has no
+ * non-blocking API for these. It takes up to a few seconds on a slow network.
+ */
+void awsIotLoop() {
+  switch (awsIotState) {
+    case AWS_IOT_BACKOFF:
+      if ((long) (millis() - awsIotNextAttemptTime) >= 0) {
+        awsIotState = AWS_IOT_TIME;
+      }
+      break;
+
+    case AWS_IOT_TIME:
+      if (dateTimeProvider.isSynced()) {
+        awsIotState = AWS_IOT_SIGN;
+      }
+      break;
+
+    case AWS_IOT_SIGN:
+      log("Connecting to AWS IOT WebSocket...");
+      if (awsIotClient.beginConnect(AWS_ENDPOINT, WEBSOCKET_PORT) == 1) {
+        awsIotState = AWS_IOT_WEBSOCKET;
+      } else {
+        awsIotConnectFailed();
+      }
+      break;
+
+    case AWS_IOT_WEBSOCKET:
+      switch (awsIotClient.pollConnect()) {
+        case 1:
+          log("AWS IOT WebSocket connection established");
+          awsIotState = AWS_IOT_MQTT_CONNECT;
+          break;
+        case -1:
+          log("Unable to connect to AWS IOT WebSocket");
+          awsIotConnectFailed();
+          break;
+      }
+      break;
+
+    case AWS_IOT_MQTT_CONNECT:
+      if (awsIotMqttConnect()) {
+        awsIotState = AWS_IOT_MQTT_CONNACK;
+      } else {
+        awsIotConnectFailed();
+      }
+      break;
+
+    case AWS_IOT_MQTT_CONNACK:
+      switch (mqttClient.pollConnect()) {
+        case MQTT::IN_PROGRESS:
+          break;
+        case MQTT::SUCCESS:
+          log("AWS IOT MQTT broker connection established");
+          awsIotState = AWS_IOT_SUBSCRIBE_SHADOW;
+          break;
+        default:
+          log("Unable to connect to AWS IOT MQTT broker");
+          awsIotConnectFailed();
+          break;
+      }
+      break;
+
+    case AWS_IOT_SUBSCRIBE_SHADOW:
+      switch (awsIotSubscribe(AWS_DELTA_TOPIC, awsIotMessageReceived)) {
+        case MQTT::IN_PROGRESS:
+          break;
+        case MQTT::SUCCESS:
+          log("Subscribed to MQTT topic");
+          awsIotState = AWS_IOT_SUBSCRIBE_COMMANDS;
+          break;
+        default:
+          log("Unable to subscribe to MQTT topic");
+          awsIotConnectFailed();
+          break;
+      }
+      break;
+
+    // the command topic is optional, it is only subscribed if AWS_COMMAND_TOPIC is not empty
+    case AWS_IOT_SUBSCRIBE_COMMANDS:
+      if (AWS_COMMAND_TOPIC == NULL || AWS_COMMAND_TOPIC[0] == '\0') {
+        awsIotConnected();
+        break;
+      }
+      switch (awsIotSubscribe(AWS_COMMAND_TOPIC, awsIotCommandReceived)) {
+        case MQTT::IN_PROGRESS:
+          break;
+        case MQTT::SUCCESS:
+          log("Subscribed to MQTT command topic");
+          awsIotConnected();
+          break;
+        default:
+          log("Unable to subscribe to MQTT command topic");
+          awsIotConnectFailed();
+          break;
+      }
+      break;
+
+    case AWS_IOT_CONNECTED:
+      if (!awsIotClient.connected()) {
+        log("AWS IOT connection lost");
+        awsIotConnectFailed();
+      } else if (!mqttClient.isConnected()) {
+        // a publish that could not be sent disconnects the client, it is resent on reconnect
+        log("AWS IOT MQTT send failed");
+        awsIotConnectFailed();
+      } else if (mqttClient.yield(MQTT_YIELD_TIMEOUT_MS) != MQTT::SUCCESS) {
+        log("AWS IOT MQTT read failed");
+        awsIotConnectFailed();
+      } else if (shadowReportCommand != I2C_CMD_NOOP && awsIotReportShadowState()) {
+        shadowReportCommand = I2C_CMD_NOOP;
+      }
+      break;
   }
+}
 
-  log("Connecting to AWS IOT WebSocket...");
-  if (mqttIpStack.connect((char *) AWS_ENDPOINT, WEBSOCKET_PORT) != 1) {
-    log("Unable to connect to AWS IOT WebSocket");
-    return false;
-  } else {
-    log("AWS IOT WebSocket connection established");
+void awsIotConnected() {
+  awsIotBackoffMs = AWS_IOT_BACKOFF_MIN_MS;
+  awsIotState = AWS_IOT_CONNECTED;
+}
+
+void awsIotConnectFailed() {
+  awsIotSubscribePending = false;
+  if (mqttClient.isConnected()) {
+    mqttClient.disconnect();
   }
+  awsIotClient.stop();
+  unsigned long jitter = random(awsIotBackoffMs / 2 + 1);
+  awsIotNextAttemptTime = millis() + awsIotBackoffMs / 2 + jitter;
+  awsIotBackoffMs = min(awsIotBackoffMs * 2, AWS_IOT_BACKOFF_MAX_MS);
+  awsIotState = AWS_IOT_BACKOFF;
+}
 
+/**
+ * Sends the MQTT connect packet, the connack is polled by awsIotLoop().
+ */
+bool awsIotMqttConnect() {
   log("Connecting to AWS IOT MQTT broker...");
   MQTTPacket_connectData data = MQTTPacket_connectData_initializer;
   data.MQTTVersion = 3;
-  char* clientID = new char[23];
-  for (int i = 0; i < 22; ++i)
-    clientID[i]=(char) random(1, 256);
+  char clientID[23];
+  for (int i = 0; i < 22; ++i) {
+    clientID[i] = (char) random(1, 256);
+  }
+  clientID[22] = '\0';
   data.clientID.cstring = clientID;
-  if (mqttClient->connect(data) != 0) {
-    delete[] clientID;
+  if (mqttClient.beginConnect(data) != MQTT::SUCCESS) {
     log("Unable to connect to AWS IOT MQTT broker");
     return false;
   }
-  delete[] clientID;
-  log("AWS IOT MQTT broker connection established");
   return true;
 }
 
-void awsIotSubscribeToShadowUpdates() {
-  if (mqttClient->subscribe(AWS_DELTA_TOPIC, MQTT::QOS0, awsIotMessageReceived) != 0) {
-    log("Unable to subscribe to MQTT topic");
-    return;
+/**
+ * Subscribes to a topic over several calls without blocking: the first call sends the subscribe
+ * packet, the following ones poll for the suback.
+ * Returns MQTT::IN_PROGRESS until the suback has arrived, then MQTT::SUCCESS or a failure.
+ */
+int awsIotSubscribe(const char *topic, MqttClient::messageHandler handler) {
+  if (!awsIotSubscribePending) {
+    if (mqttClient.beginSubscribe(topic, MQTT::QOS0, handler) != MQTT::SUCCESS) {
+      return MQTT::FAILURE;
+    }
+    awsIotSubscribePending = true;
+    return MQTT::IN_PROGRESS;
   }
-  log("Subscribed to MQTT topic");
+  int rc = mqttClient.pollSubscribe();
+  if (rc != MQTT::IN_PROGRESS) {
+    awsIotSubscribePending = false;
+  }
+  return rc;
 }
 
 void awsIotMessageReceived(MQTT::MessageData& data)
 {
   MQTT::Message &message = data.message;
-  log("Message %s", message.payload);
-  StaticJsonBuffer<JSON_BUFFER_LENGTH> jsonBuffer;
-  JsonObject &json = jsonBuffer.parseObject((const char *) message.payload);
-  if (json.success()) {
-    if (json.containsKey("state")) {
-      JsonObject &state = json["state"];
-      if (state.containsKey("move")) {
-        const char *move = (const char *) state["move"];
-        if (strcmp("stop", move) == 0) {
-          tableStop();
-        } else if (strcmp("up", move) == 0) {
-          tableMoveUp();
-        } else if (strcmp("down", move) == 0) {
-          tableMoveDown();
-        } else if (strcmp("position", move) == 0) {
-          tableMoveToPosition((int) state["position"]);
-        } else if (strcmp("height", move) == 0) {
-          tableMoveToHeight((int) state["height"]);
-        }
+  uint32_t version;
+  if (!shadowDeltaVersion((const char *) message.payload, message.payloadlen, version)) {
+    log("Shadow delta without version");
+    return;
+  }
+  // a redelivered or stale delta has an old version, however recent its timestamp; a version far
+  // below the last one can't be a redelivery, the shadow was recreated and counts from 1 again
+  if (version <= shadowVersion && shadowVersion - version <= SHADOW_VERSION_RESET_DISTANCE) {
+    return;
+  }
+  if (version < shadowVersion) {
+    log("Shadow version reset from %u to %u", (unsigned) shadowVersion, (unsigned) version);
+  }
+  shadowVersion = version;
+  saveShadowVersion();
+  log("Message %.*s", (int) message.payloadlen, (const char *) message.payload);
+  // the payload isn't terminated by a zero, it is parsed within its length; the metadata and
+  // the other fields are skipped without being stored
+  ShadowDeltaJson delta = ShadowDeltaJson();
+  if (JsonStruct<ShadowDeltaJson>(delta).parseN((const char *) message.payload, message.payloadlen)) {
+    const MoveJson &state = delta.state;
+    if (state.hasMove) {
+      if (strcmp("stop", state.move) == 0) {
+        tableStop();
+      } else if (strcmp("up", state.move) == 0) {
+        tableMoveUp();
+      } else if (strcmp("down", state.move) == 0) {
+        tableMoveDown();
+      } else if (strcmp("position", state.move) == 0) {
+        tableMoveToPosition(state.position);
+      } else if (strcmp("height", state.move) == 0) {
+        tableMoveToHeight(state.height);
       }
     }
   }
 }
 
+/**
+ * Executes a binary command without the detour over the shadow service and without JSON parsing.
+ * A command has 4 to 8 bytes (the bytes after the 4th are reserved and ignored):
+ *
+ *   0    opcode, one of I2C_CMD_MOVE_STOP, _UP, _DOWN, _HEIGHT or _POSITION
+ *   1-2  argument, little endian: the height for I2C_CMD_MOVE_HEIGHT, the position (1 - 4)
+ *        for I2C_CMD_MOVE_POSITION
+ *   3    sequence number, a command that repeats the previous sequence number within
+ *        COMMAND_DUPLICATE_WINDOW_MS is a duplicate and ignored
+ *
+ * The executed command is reported to the shadow afterwards by awsIotReportShadowState().
+ */
+void awsIotCommandReceived(MQTT::MessageData& data)
+{
+  MQTT::Message &message = data.message;
+  if (message.payloadlen < COMMAND_MIN_LENGTH || message.payloadlen > COMMAND_MAX_LENGTH) {
+    log("Invalid command length %d", (int) message.payloadlen);
+    return;
+  }
+  const uint8_t *command = (const uint8_t *) message.payload;
+  uint16_t argument = command[1] + (command[2] << 8);
+  uint8_t sequence = command[3];
+  if (lastCommandValid && sequence == lastCommandSequence &&
+      millis() - lastCommandTime < COMMAND_DUPLICATE_WINDOW_MS) {
+    return;
+  }
+  lastCommandSequence = sequence;
+  lastCommandTime = millis();
+  lastCommandValid = true;
+  switch (command[0]) {
+    case I2C_CMD_MOVE_STOP:
+      tableStop();
+      break;
+    case I2C_CMD_MOVE_UP:
+      tableMoveUp();
+      break;
+    case I2C_CMD_MOVE_DOWN:
+      tableMoveDown();
+      break;
+    case I2C_CMD_MOVE_HEIGHT:
+      tableMoveToHeight(argument);
+      break;
+    case I2C_CMD_MOVE_POSITION:
+      tableMoveToPosition(argument);
+      break;
+    default:
+      log("Invalid command %d", command[0]);
+      return;
+  }
+  shadowReportCommand = command[0];
+  shadowReportArgument = argument;
+}
+
+/**
+ * Reports the last direct command as the reported state of the shadow and clears its desired
+ * state, so that an older desired state doesn't produce a delta that overrides the command.
+ * The message is built in the lent MQTT read buffer, which is why this must not be called from
+ * a message handler.
+ * Returns true once the report is in the in-flight window of the MQTT client, also if it could not
+ * be sent yet: it is then resent on reconnect and must not be published again.
+ */
+bool awsIotReportShadowState() {
+  ShadowUpdateJson update = ShadowUpdateJson();
+  MoveJson &reported = update.state.reported;
+  switch (shadowReportCommand) {
+    case I2C_CMD_MOVE_STOP:
+      strcpy(reported.move, "stop");
+      break;
+    case I2C_CMD_MOVE_UP:
+      strcpy(reported.move, "up");
+      break;
+    case I2C_CMD_MOVE_DOWN:
+      strcpy(reported.move, "down");
+      break;
+    case I2C_CMD_MOVE_HEIGHT:
+      strcpy(reported.move, "height");
+      reported.height = shadowReportArgument;
+      reported.hasHeight = true;
+      break;
+    case I2C_CMD_MOVE_POSITION:
+      strcpy(reported.move, "position");
+      reported.position = shadowReportArgument;
+      reported.hasPosition = true;
+      break;
+  }
+  reported.hasMove = reported.move[0] != 0;
+  int bufferSize;
+  char *buffer = (char *) mqttClient.lendReadBuffer(bufferSize);
+  size_t length = JsonStruct<ShadowUpdateJson>(update).printTo(buffer, bufferSize);
+  unsigned short id;
+  mqttClient.publishAsync(AWS_UPDATE_TOPIC, buffer, length, id);
+  return id != 0;
+}
+
+/**
+ * Reads the top level "version" of a shadow delta without parsing the whole document, so that a
+ * replayed delta is dropped after a scan of its bytes and a compare.
+ * The versions of a shadow increase with each update and are not reset if the shadow is
+ * deleted. Only a recreated thing starts again at 1, which awsIotMessageReceived() detects by a
+ * version more than SHADOW_VERSION_RESET_DISTANCE below the last one. A smaller step back is
+ * taken for a replay, as long as the last version is kept in the rtc memory, i.e. until the next
+ * power cycle.
+ */
+bool shadowDeltaVersion(const char *json, size_t length, uint32_t &version) {
+  bool hasVersion = false;
+  int depth = 0;
+  for (size_t i = 0; i < length && !hasVersion; ++i) {
+    char c = json[i];
+    if (c == '{' || c == '[') {
+      ++depth;
+    } else if (c == '}' || c == ']') {
+      --depth;
+    } else if (c == '"') {
+      size_t keyStart = ++i;
+      while (i < length && json[i] != '"') {
+        i += json[i] == '\\' ? 2 : 1;
+      }
+      if (depth != 1 || i >= length) {
+        continue;
+      }
+      size_t keyLength = i - keyStart;
+      size_t j = i + 1;
+      while (j < length && isspace(json[j])) {
+        ++j;
+      }
+      if (j >= length || json[j] != ':') {
+        continue;
+      }
+      if (keyLength != 7 || strncmp(json + keyStart, "version", 7) != 0) {
+        continue;
+      }
+      hasVersion = true;
+      for (++j; j < length && isspace(json[j]); ++j) {
+      }
+      version = 0;
+      for (; j < length && isdigit(json[j]); ++j) {
+        version = version * 10 + (json[j] - '0');
+      }
+      i = j - 1;
+    }
+  }
+  return hasVersion;
+}
+
+uint32_t shadowVersionChecksum(const ShadowVersionRTC &data) {
+  return data.magic ^ (data.version * 31);
+}
+
+void loadShadowVersion() {
+  ShadowVersionRTC data;
+  if (ESP.rtcUserMemoryRead(RTC_SHADOW_VERSION_OFFSET, (uint32_t *) &data, sizeof(data)) &&
+      data.magic == RTC_SHADOW_VERSION_MAGIC && data.checksum == shadowVersionChecksum(data)) {
+    shadowVersion = data.version;
+  }
+}
+
+void saveShadowVersion() {
+  ShadowVersionRTC data;
+  data.magic = RTC_SHADOW_VERSION_MAGIC;
+  data.version = shadowVersion;
+  data.checksum = shadowVersionChecksum(data);
+  ESP.rtcUserMemoryWrite(RTC_SHADOW_VERSION_OFFSET, (uint32_t *) &data, sizeof(data));
+}
+
 void tableStop() {
   log("Table stop");
   Wire.beginTransmission(I2C_ADDRESS);
@@ -438,6 +887,9 @@ void log(const char *str, ...)
         case 'd':
           Serial.print(va_arg(argv, int));
           break;
+        case 'u':
+          Serial.print(va_arg(argv, unsigned int));
+          break;
         case 'l':
           Serial.print(va_arg(argv, long));
           break;
@@ -450,6 +902,14 @@ void log(const char *str, ...)
         case 's':
           Serial.print(va_arg(argv, char *));
           break;
+        case '.':
+          // %.*s prints a string that isn't terminated by a zero
+          if (str[i + 1] == '*' && str[i + 2] == 's') {
+            int length = va_arg(argv, int);
+            Serial.write((const uint8_t *) va_arg(argv, char *), length);
+            i += 2;
+          }
+          break;
         default:
           break;
       };